@@ -5,6 +5,7 @@ Diffuse lighting shader
 */
 
 #include "common/glutils.h"
+#include "common/vertexformat.h"
 #include <iostream>
 #include <vector>
 #include <unordered_map>
@@ -150,13 +151,10 @@ void initBuffers()
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
-	// enable and specify vertex format
-	glEnableVertexAttribArray(program.attribs["position"]);
-	glEnableVertexAttribArray(program.attribs["normal"]);
-	glEnableVertexAttribArray(program.attribs["texel"]);
-	glVertexAttribPointer(program.attribs["position"], 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), 0);
-	glVertexAttribPointer(program.attribs["normal"], 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
-	glVertexAttribPointer(program.attribs["texel"], 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (void*)(6 * sizeof(GLfloat)));
+	// enable and specify vertex format, matching the layout of vertices above
+	VertexFormat format;
+	format.add("position", 3).add("normal", 3).add("texel", 2);
+	format.apply(program.attribs);
 
 	// "unbind" vao
 	glBindVertexArray(0);
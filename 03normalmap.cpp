@@ -8,6 +8,8 @@ http://www.opengl-tutorial.org/intermediate-tutorials/tutorial-13-normal-mapping
 
 #include "common/glutils.h"
 #include "common/globj.h"
+#include "common/tangents.h"
+#include "common/vertexpack.h"
 #include <iostream>
 #include <vector>
 #include <unordered_map>
@@ -20,6 +22,7 @@ GLuint baseImage;
 GLuint normalMap;
 GLuint vbo, vao, ibo;
 IndexedVertexArray iva;
+PackedVertexFormat vertexFormat;
 
 mat4 model = mat4(1.0f);
 //mat4 view = translate(0.0f, 0.0f, -3.0f) * rotateX(-0.59f) * rotateY(0.35f);
@@ -30,53 +33,6 @@ vec3 lightPos = vec3(0.0f, 0.0f, 3.0f);
 vec4 lightColor = vec4(0.9f, 0.95f, 1.0f, 1.0f);
 vec4 ambient = vec4(0.2f, 0.2f, 0.38f, 1.0f);
 
-/* Computes an orthogonal tangent space basis from the given vertex data. */
-void computeTangentBasis(
-std::vector<vec3> &positions, std::vector<vec3> &normals, std::vector<vec2> &texels,
-std::vector<vec3> &tangents, std::vector<vec3> &bitangents)
-{
-	tangents.clear();
-	bitangents.clear();
-	// Go through each triangle and calculate the tangent space vectors
-	for(int i = 0; i < positions.size() - 2; i += 3)
-	{
-		vec3 &v0 = positions[i + 0];
-		vec3 &v1 = positions[i + 1];
-		vec3 &v2 = positions[i + 2];
-
-		vec2 &uv0 = texels[i + 0];
-		vec2 &uv1 = texels[i + 1];
-		vec2 &uv2 = texels[i + 2];
-
-		// Edges of triangle
-		vec3 deltaPos1 = v1 - v0;
-		vec3 deltaPos2 = v2 - v0;
-
-		// UV delta
-		vec2 deltaUv1 = uv1 - uv0;
-		vec2 deltaUv2 = uv2 - uv0;
-
-		// Solve for tangent vectors
-		float r = 1.0f / (deltaUv1.x * deltaUv2.y - deltaUv1.y * deltaUv2.x);
-		vec3 tangent = (deltaPos1 * deltaUv2.y - deltaPos2 * deltaUv1.y) * r;
-		vec3 bitangent = (deltaPos2 * deltaUv1.x - deltaPos1 * deltaUv2.x) * r;
-
-		// Orthogonalize basis (by "pushing" the tangent vector to make it orthogonal
-		// to the surface normal) (DOES THIS ACTUALLY WORK?)
-		vec3 t0 = normalize(tangent - normals[i+0] * dot(tangent, normals[i+0]));
-		vec3 t1 = normalize(tangent - normals[i+1] * dot(tangent, normals[i+1]));
-		vec3 t2 = normalize(tangent - normals[i+2] * dot(tangent, normals[i+2]));
-
-		// Store the tangent/bitangents for each vertex
-		tangents.push_back(t0);
-		tangents.push_back(t1);
-		tangents.push_back(t2);
-		bitangents.push_back(bitangent);
-		bitangents.push_back(bitangent);
-		bitangents.push_back(bitangent);
-	}
-}
-
 bool loadTextures()
 {
 	// create 4x4 checkerboard rgba texture
@@ -125,11 +81,12 @@ void initProgram()
 	program.attribs["normal"] = glGetAttribLocation(program.handle, "normal");
 	program.attribs["texel"] = glGetAttribLocation(program.handle, "texel");
 	program.attribs["tangent"] = glGetAttribLocation(program.handle, "tangent");
-	program.attribs["bitangent"] = glGetAttribLocation(program.handle, "bitangent");
 
 	program.uniforms["model"] = glGetUniformLocation(program.handle, "model");
 	program.uniforms["view"] = glGetUniformLocation(program.handle, "view");
 	program.uniforms["projection"] = glGetUniformLocation(program.handle, "projection");
+	program.uniforms["positionScale"] = glGetUniformLocation(program.handle, "positionScale");
+	program.uniforms["positionOffset"] = glGetUniformLocation(program.handle, "positionOffset");
 	program.uniforms["lightPos"] = glGetUniformLocation(program.handle, "lightPos");
 	program.uniforms["lightColor"] = glGetUniformLocation(program.handle, "lightColor");
 	program.uniforms["ambient"] = glGetUniformLocation(program.handle, "ambient");
@@ -160,49 +117,33 @@ void initBuffers()
 	iva.addVertex(-0.5f,  0.5f,  0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f);
 	iva.addTriangle(9, 10, 11);
 
+	// Compute the tangent space of each vertex, this may split vertices so do it before
+	// sizing the buffers
+	std::vector<vec4> tangents;
+	computeTangents(iva, tangents);
+
 	glGenVertexArrays(1, &vao);
 	glBindVertexArray(vao);
 
-	// Compute tangent basis vectors for each vertex
-	std::vector<vec3> tangents;
-	std::vector<vec3> bitangents;
-	computeTangentBasis(iva.positions, iva.normals, iva.texels, tangents, bitangents);
-
-	// Compute byte sizes/offsets
-	GLsizeiptr b0 = iva.positions.size() * sizeof(vec3);
-	GLsizeiptr b1 = iva.normals.size() * sizeof(vec3);
-	GLsizeiptr b2 = iva.texels.size() * sizeof(vec2);
-	GLsizeiptr b3 = tangents.size() * sizeof(vec3);
-	GLsizeiptr b4 = bitangents.size() * sizeof(vec3);
+	// Pack the vertices to 16 bytes each, see common/vertexpack.h
+	vec3 boxMin, boxMax;
+	computeBounds(iva.positions, boxMin, boxMax);
+	vertexFormat = getPackedVertexFormat(boxMin, boxMax, true, true, true, Directions8);
+	std::vector<unsigned char> vertices;
+	packVertices(vertexFormat, iva.positions, &iva.normals, &tangents, &iva.texels, vertices);
 
 	// Create vertex buffer object to hold the vertex data
 	glGenBuffers(1, &vbo);
 	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, b0 + b1 + b2 + b3 + b4, NULL, GL_STATIC_DRAW);
-
-	// Upload vertex data in chunks
-	glBufferSubData(GL_ARRAY_BUFFER, 0,					b0,	&iva.positions[0]);
-	glBufferSubData(GL_ARRAY_BUFFER, b0,				b1,	&iva.normals[0]);
-	glBufferSubData(GL_ARRAY_BUFFER, b0 + b1,			b2,	&iva.texels[0]);
-	glBufferSubData(GL_ARRAY_BUFFER, b0 + b1 + b2,		b3,	&tangents[0]);
-	glBufferSubData(GL_ARRAY_BUFFER, b0 + b1 + b2 + b3, b4, &bitangents[0]);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size(), &vertices[0], GL_STATIC_DRAW);
 
 	// Enable and specify vertex format
-	glEnableVertexAttribArray(program.getAttribLoc("position"));
-	glEnableVertexAttribArray(program.getAttribLoc("normal"));
-	glEnableVertexAttribArray(program.getAttribLoc("texel"));
-	glEnableVertexAttribArray(program.getAttribLoc("tangent"));
-	glEnableVertexAttribArray(program.getAttribLoc("bitangent"));
-	glVertexAttribPointer(program.getAttribLoc("position"),	3,	GL_FLOAT, GL_FALSE, 0, (void*)(0));
-	glVertexAttribPointer(program.getAttribLoc("normal"),	3,	GL_FLOAT, GL_FALSE, 0, (void*)(b0));
-	glVertexAttribPointer(program.getAttribLoc("texel"),	2,	GL_FLOAT, GL_FALSE, 0, (void*)(b0 + b1));
-	glVertexAttribPointer(program.getAttribLoc("tangent"),	3,	GL_FLOAT, GL_FALSE, 0, (void*)(b0 + b1 + b2));
-	glVertexAttribPointer(program.getAttribLoc("bitangent"), 3,	GL_FLOAT, GL_FALSE, 0, (void*)(b0 + b1 + b2 + b3));
+	vertexFormat.getVertexFormat().apply(program.attribs);
 
 	// Create index buffer object to hold the index data
 	glGenBuffers(1, &ibo);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, iva.indices.size() * sizeof(GLushort), &iva.indices[0], GL_STATIC_DRAW);
+	uploadIndices(iva.indices, iva.positions.size(), GL_STATIC_DRAW);
 
 	// "Unbind" vao and buffers
 	glBindVertexArray(0);
@@ -235,6 +176,7 @@ void render()
 	glUniform(program.uniforms["model"], model);
 	glUniform(program.uniforms["view"], view);
 	glUniform(program.uniforms["projection"], projection);
+	vertexFormat.setPositionUniforms(program.uniforms["positionScale"], program.uniforms["positionOffset"]);
 	glUniform(program.uniforms["lightPos"], lightPos);
 	glUniform(program.uniforms["lightColor"], lightColor);
 	glUniform(program.uniforms["ambient"], ambient);
@@ -245,7 +187,7 @@ void render()
 	glBindTexture(GL_TEXTURE_2D, baseImage);
 	glActiveTexture(GL_TEXTURE0 + 1);
 	glBindTexture(GL_TEXTURE_2D, normalMap);
-	glDrawElements(GL_TRIANGLES, iva.indices.size(), GL_UNSIGNED_SHORT, 0);
+	glDrawElements(GL_TRIANGLES, iva.indices.size(), iva.getIndexType(), 0);
 	glBindTexture(GL_TEXTURE_2D, 0);
 
 	glBindVertexArray(0);
@@ -7,11 +7,30 @@ and later smoothed using trilinear interpolation
 http://0fps.wordpress.com/2012/07/10/smooth-voxel-terrain-part-1/
 http://0fps.wordpress.com/2012/07/12/smooth-voxel-terrain-part-2/
 
-This example is unfinished (have not implemented smoothing yet)
+Three meshers are available (see common/isosurface.h): blocky voxels, and the
+smooth naive surface nets and marching cubes, which share their vertices.
+The mesh is built on a worker thread (see common/meshjob.h), first at a coarse preview
+resolution and then at full resolution, while the frame loop keeps running.
+The EditableMesh mode keeps a marching cubes mesh per brick (see common/brickmesh.h)
+and moves a ball through the surface, remeshing only the bricks it touches each frame.
+The surface is read from data/isosurface.field, edit it to change the surface without rebuilding.
+Full resolution meshes are kept in a cache on disk (see common/meshcache.h), so a second
+run with the same surface and parameters maps the stored mesh instead of meshing again.
+Set exportResolution to also stream a marching cubes mesh of any resolution to
+isosurface.mesh (see common/meshfile.h) before the window opens.
 */
 
 #include "common/glutils.h"
 #include "common/globj.h"
+#include "common/isosurface.h"
+#include "common/brickmesh.h"
+#include "common/meshjob.h"
+#include "common/meshfile.h"
+#include "common/expression.h"
+#include "common/meshcache.h"
+#include "common/meshopt.h"
+#include "common/normals.h"
+#include <chrono>
 #include <iostream>
 #include <vector>
 #include <unordered_map>
@@ -20,125 +39,101 @@ using namespace glm;
 Program program;
 GLuint vsShader;
 GLuint fsShader;
-GLuint vbo, vao, ibo;
-int elementCount;
+GLuint vao;
+bool parallelMeshing = true;
+bool cullEmptySpace = true;
+bool optimizeMeshOrder = true;
 
 mat4 model;
 mat4 view;
 mat4 projection;
 
-float surfaceFunction(float x, float y, float z)
-{	
-	/*vec4 p(x, y, z, 1.0f);
-	p = rotateY(1.88f * y) * p;
-	x = p.x;
-	y = p.y;
-	z = p.z;*/
-
-	// Nordstrand's weird surface
-	return 25.0f * (pow(x,3.0f)*(y+z) + pow(y,3.0f)*(x+z) + pow(z,3.0f)*(x+y)) +
-        50.0f * (x*x*y*y + x*x*z*z + y*y*z*z) -
-        125.0f * (x*x*y*z + y*y*x*z+z*z*x*y) +
-        60.0f*x*y*z -
-        4.0f*(x*y+x*z+y*z);
-
-	//return x*x*x*x + y*y*y*y + z*z*z*z - 1.4f * (x*x + y*y + z*z) + 0.55f;
-
-	//return x * x + y * y + z * z - 1.0f;
-	//return y - x*x - z*z;
-	//return x*x*x*x*x*x + y*y*y*y*y*y + z*z*z*z*z*z - 1.0f;
+// The implicit surface to polygonize, compiled from data/isosurface.field at startup
+// (see common/expression.h). Falls back to nordstrandField, see common/field.h
+SurfaceField surfaceField;
+std::string surfaceSource;
+
+enum MeshMode
+{
+	VoxelMesh,
+	SurfaceNetsMesh,
+	MarchingCubesMesh,
+	EditableMesh
+};
+const MeshMode meshMode = SurfaceNetsMesh;
+
+const int gridResolution = 128;
+const int previewResolution = 32;
+const int exportResolution = 0; // e.g. 2048, 0 to skip the export
+const float epsilon = 0.3f;
+const float gridMin = -1.5f;
+const float gridMax = 1.5f;
+
+// A ball merged into the surface in EditableMesh mode. The field only changes
+// inside the ball, so moving it only touches the bricks around it.
+BrickMesh brickMesh;
+vec3 ballCenter = vec3(1.0f, 0.0f, 0.0f);
+const float ballRadius = 0.3f;
+
+template <typename T>
+T ball(T x, T y, T z)
+{
+	return square(x - T(ballCenter.x)) + square(y - T(ballCenter.y)) + square(z - T(ballCenter.z)) - T(ballRadius * ballRadius);
 }
 
-// Appends a clockwise oriented quad to the list of positions and indices
-void addQuad(const vec3 &v0, const vec3 &v1, const vec3 &v2, const vec3 &v3,
-std::vector<vec3> &positions, std::vector<GLushort> &indices)
+float editedSurface(float x, float y, float z)
 {
-	GLushort i = positions.size();
-	positions.push_back(v0);
-	positions.push_back(v1);
-	positions.push_back(v2);
-	positions.push_back(v3);
-	indices.push_back(i + 0);
-	indices.push_back(i + 1);
-	indices.push_back(i + 2);
-	indices.push_back(i + 2);
-	indices.push_back(i + 3);
-	indices.push_back(i + 0);
+	float b = ball(x, y, z);
+	float f = surfaceField.evaluate(x, y, z);
+	return b < 0.0f ? std::min(f, b) : f;
 }
 
-void polygonizeSurface(std::vector<vec3> &positions, std::vector<GLushort> &indices)
+void editedSurfaceBatch(const float *x, const float *y, const float *z, float *f, int count)
 {
-	int gridResolution = 128;
-	float epsilon = 0.3f;
-	float min = -1.5f;
-	float max = 1.5f;
-	float blockSize = (max - min) / float(gridResolution);
-
-	positions.clear();
-	indices.clear();
-	for(int gx = 0; gx <= gridResolution; ++gx)
+	surfaceField.evaluateBatch(x, y, z, f, count);
+	for(int i = 0; i < count; ++i)
 	{
-		for(int gy = 0; gy <= gridResolution; ++gy)
-		{
-			for(int gz = 0; gz <= gridResolution; ++gz)
-			{
-				float x = min + (max - min) * (gx / float(gridResolution));
-				float y = min + (max - min) * (gy / float(gridResolution));
-				float z = min + (max - min) * (gz / float(gridResolution));
-				// We approximate the level surface f(x, y, z) = 0 by
-				// adding voxels where |f(x, y, z)| <= epsilon
-				float f = std::abs(surfaceFunction(x, y, z));
-				if(f <= epsilon)
-				{
-					float h = blockSize / 2.0f;
-					// Front facing orientation is clockwise, note that we do some simple occlusion testing
-					// Front and back
-					if(std::abs(surfaceFunction(x, y, z + blockSize) > epsilon))
-						addQuad(vec3(x-h, y-h, z+h), vec3(x-h, y+h, z+h), vec3(x+h, y+h, z+h), vec3(x+h, y-h, z+h), positions, indices);
-					if(std::abs(surfaceFunction(x, y, z - blockSize) > epsilon))
-						addQuad(vec3(x-h, y-h, z-h), vec3(x+h, y-h, z-h), vec3(x+h, y+h, z-h), vec3(x-h, y+h, z-h), positions, indices);
-
-					// Top and bottom
-					if(std::abs(surfaceFunction(x, y + blockSize, z) > epsilon))
-						addQuad(vec3(x-h, y+h, z+h), vec3(x-h, y+h, z-h), vec3(x+h, y+h, z-h), vec3(x+h, y+h, z+h), positions, indices);
-					if(std::abs(surfaceFunction(x, y - blockSize, z) > epsilon))
-						addQuad(vec3(x-h, y-h, z+h), vec3(x+h, y-h, z+h), vec3(x+h, y-h, z-h), vec3(x-h, y-h, z-h), positions, indices);
-
-					// Left and right
-					if(std::abs(surfaceFunction(x - blockSize, y, z) > epsilon))
-						addQuad(vec3(x-h, y-h, z-h), vec3(x-h, y+h, z-h), vec3(x-h, y+h, z+h), vec3(x-h, y-h, z+h), positions, indices);
-					if(std::abs(surfaceFunction(x + blockSize, y, z) > epsilon))
-					addQuad(vec3(x+h, y-h, z+h), vec3(x+h, y+h, z+h), vec3(x+h, y+h, z-h), vec3(x+h, y-h, z-h), positions, indices);
-				}
-			}
-		}
+		float b = ball(x[i], y[i], z[i]);
+		if(b < 0.0f)
+			f[i] = std::min(f[i], b);
 	}
+}
 
-	std::cout<<"Generated isosurface ("<<positions.size()<<" vertices and "<<indices.size()<<" indices)"<<std::endl;
+Interval editedSurfaceInterval(const Interval &x, const Interval &y, const Interval &z)
+{
+	Interval b = ball(x, y, z);
+	Interval f = surfaceField.evaluateInterval(x, y, z);
+	if(b.lo >= 0.0f)
+		return f;
+	if(b.hi < 0.0f)
+		return min(f, b);
+	return Interval(std::min(f.lo, b.lo), f.hi);
 }
 
-void computeSurfaceNormals(const std::vector<vec3> &positions, const std::vector<GLushort> &indices, 
-std::vector<vec3> &normals, bool flip)
+const SurfaceField editedField = { "edited surface", editedSurface, editedSurfaceBatch, editedSurfaceInterval };
+
+// Runs on the mesh job thread, so only reads constant state
+void polygonizeSurface(int resolution, std::vector<vec3> &positions, std::vector<GLuint> &indices)
 {
-	normals = std::vector<vec3>(positions.size());
-	for(int i = 0; i < indices.size() - 2; i += 3)
-	{
-		GLushort j0 = indices[i + 0];
-		GLushort j1 = indices[i + 1];
-		GLushort j2 = indices[i + 2];
-		vec3 v0 = positions[j0];
-		vec3 v1 = positions[j1];
-		vec3 v2 = positions[j2];
-
-		// Each triangle has the same normal, defined by the crossproduct of two edges
-		vec3 n = normalize(cross(v1 - v0, v2 - v0));
-		if(flip)
-			n = -n;
-
-		normals[j0] = n;
-		normals[j1] = n;
-		normals[j2] = n;
-	}
+	// Evaluate the field once per lattice point, the mesher only reads from the cache
+	SampleGrid grid;
+	auto sampleStart = std::chrono::steady_clock::now();
+	if(cullEmptySpace)
+		sampleGridCulled(grid, surfaceField, resolution, gridMin, gridMax, epsilon);
+	else
+		sampleGrid(grid, surfaceField, resolution, gridMin, gridMax);
+	std::cout<<"Sampled "<<surfaceField.name<<" in "<<std::chrono::duration<double>(std::chrono::steady_clock::now() - sampleStart).count()<<" seconds"<<std::endl;
+	if(meshMode == SurfaceNetsMesh)
+		polygonizeSurfaceNets(grid, positions, indices);
+	else if(meshMode == MarchingCubesMesh)
+		polygonizeMarchingCubes(grid, positions, indices);
+	else if(parallelMeshing)
+		polygonizeVoxelsParallel(grid, epsilon, positions, indices);
+	else
+		polygonizeVoxels(grid, epsilon, positions, indices);
+
+	std::cout<<"Generated isosurface ("<<positions.size()<<" vertices and "<<indices.size()<<" indices) from "
+		<<grid.samples.size()<<" field samples in "<<grid.sampledBrickCount()<<" of "<<grid.brickCount()<<" bricks"<<std::endl;
 }
 
 void initProgram()
@@ -157,44 +152,79 @@ void initProgram()
 	program.uniforms["view"] = glGetUniformLocation(program.handle, "view");
 	program.uniforms["projection"] = glGetUniformLocation(program.handle, "projection");
 	program.uniforms["white"] = glGetUniformLocation(program.handle, "white");
+	program.uniforms["positionScale"] = glGetUniformLocation(program.handle, "positionScale");
+	program.uniforms["positionOffset"] = glGetUniformLocation(program.handle, "positionOffset");
+}
+
+MeshJob meshJob;
+MeshBuffers meshBuffers;
+int meshResolution;
+
+// Everything that determines the mesh at the given resolution
+MeshCacheKey getMeshKey(int resolution)
+{
+	MeshCacheKey key;
+	key.add("isosurface").add(surfaceField.name).add(surfaceSource).add(int(meshMode))
+		.add(resolution).add(epsilon).add(gridMin).add(gridMax).add(int(optimizeMeshOrder));
+	return key;
+}
+
+void startMeshJob(int resolution)
+{
+	meshResolution = resolution;
+	MeshCacheKey key = getMeshKey(resolution);
+	meshJob.start([resolution, key](MeshData &mesh)
+	{
+		polygonizeSurface(resolution, mesh.positions, mesh.indices);
+		// The smooth meshers share vertices between faces, so take the normal from the field instead
+		if(meshMode == VoxelMesh)
+			computeNormals(mesh.positions, mesh.indices, mesh.normals, FlatNormals, true);
+		else
+			computeFieldNormals(surfaceField, 0.5f * (gridMax - gridMin) / float(resolution), mesh.positions, mesh.normals);
+		// The meshers emit triangles in grid order, which reuses few vertices from the cache
+		if(optimizeMeshOrder)
+		{
+			MeshOptimizeReport report = optimizeMesh(mesh.positions, mesh.indices, true, true, &mesh.normals);
+			std::cout<<"Vertex cache ACMR "<<report.before.acmr<<" -> "<<report.after.acmr
+				<<", ATVR "<<report.before.atvr<<" -> "<<report.after.atvr<<std::endl;
+		}
+		if(resolution == gridResolution && !storeCachedMesh(key, mesh))
+			std::cerr<<"Failure storing "<<key.getFilename()<<std::endl;
+	});
 }
 
 void initBuffers()
 {
-	std::vector<vec3> positions;
-	std::vector<vec3> normals;
-	std::vector<GLushort> indices;
-	polygonizeSurface(positions, indices);
-	computeSurfaceNormals(positions, indices, normals, true);
-	elementCount = indices.size();
-	
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
-
-	// Create vertex buffer object to hold the vertex data
-	GLsizeiptr b0 = positions.size() * sizeof(vec3);
-	GLsizeiptr b1 = normals.size() * sizeof(vec3);
-	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, b0 + b1, NULL, GL_STATIC_DRAW);
-	glBufferSubData(GL_ARRAY_BUFFER, 0,	b0,	&positions[0]);
-	glBufferSubData(GL_ARRAY_BUFFER, b0, b1, &normals[0]);
-
-	// Enable and specify vertex format
-	glEnableVertexAttribArray(program.getAttribLoc("position"));
-	glEnableVertexAttribArray(program.getAttribLoc("normal"));
-	glVertexAttribPointer(program.getAttribLoc("position"),	3,	GL_FLOAT, GL_FALSE, 0, (void*)(0));
-	glVertexAttribPointer(program.getAttribLoc("normal"),	3,	GL_FLOAT, GL_FALSE, 0, (void*)(b0));
-
-	// Create index buffer object to hold the index data
-	glGenBuffers(1, &ibo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), &indices[0], GL_STATIC_DRAW);
-
-	// "Unbind" vao and buffers
-	glBindVertexArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	if(meshMode == EditableMesh)
+	{
+		double meshStart = glfwGetTime();
+		brickMesh.build(editedField, gridResolution, gridMin, gridMax);
+		std::cout<<"Generated brick mesh ("<<brickMesh.getVertexCount()<<" vertices and "
+			<<brickMesh.getTriangleCount()<<" triangles) in "<<(glfwGetTime() - meshStart)<<" seconds"<<std::endl;
+
+		glGenVertexArrays(1, &vao);
+		glBindVertexArray(vao);
+		brickMesh.setVertexFormat(program.getAttribLoc("position"), program.getAttribLoc("normal"));
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		return;
+	}
+
+	meshBuffers.create(program.getAttribLoc("position"), program.getAttribLoc("normal"));
+
+	// Map the mesh stored by a previous run if there is one
+	double loadStart = glfwGetTime();
+	MappedMeshFile cached;
+	if(loadCachedMesh(getMeshKey(gridResolution), cached))
+	{
+		meshBuffers.uploadInterleaved(cached.getVertices(), cached.getVertexCount(), cached.getIndices(), cached.getIndexCount());
+		std::cout<<"Loaded "<<cached.getVertexCount()<<" vertices from the mesh cache in "<<(glfwGetTime() - loadStart)<<" seconds"<<std::endl;
+		return;
+	}
+
+	// Otherwise the mesh is uploaded by update() once the job has built it
+	startMeshJob(previewResolution);
 }
 
 double time0 = 0.0;
@@ -230,44 +260,112 @@ void update(double time)
 	view = translate(0.0f, 0.0f, -4.0f + zoom);
 	projection = glm::perspective(45.0f, 640.0f / 480.0f, 0.1f, 10.0f);
 
+	MeshData mesh;
+	if(meshJob.poll(mesh))
+	{
+		std::cout<<"Polygonized at resolution "<<meshResolution<<" in "<<mesh.buildTime<<" seconds"<<std::endl;
+		meshBuffers.upload(mesh);
+		std::cout<<"Vertex buffer size: "<<mesh.positions.size() * meshBuffers.getVertexFormat().stride<<" bytes"<<std::endl;
+		if(meshResolution < gridResolution)
+			startMeshJob(gridResolution);
+	}
+
+	if(meshMode == EditableMesh)
+	{
+		// Remesh the region swept by the ball
+		float t = float(time);
+		vec3 center = vec3(cosf(t * 0.5f), 0.3f * sinf(t * 1.3f), sinf(t * 0.5f));
+		vec3 r = vec3(ballRadius);
+		vec3 boxMin = min(center, ballCenter) - r;
+		vec3 boxMax = max(center, ballCenter) + r;
+		ballCenter = center;
+		brickMesh.update(editedField, boxMin, boxMax);
+	}
+
 	time0 = time;
 }
 
+void drawSurface()
+{
+	if(meshMode == EditableMesh)
+	{
+		brickMesh.getVertexFormat().setPositionUniforms(program.uniforms["positionScale"], program.uniforms["positionOffset"]);
+		glBindVertexArray(vao);
+		brickMesh.draw();
+		glBindVertexArray(0);
+	}
+	else
+	{
+		meshBuffers.getVertexFormat().setPositionUniforms(program.uniforms["positionScale"], program.uniforms["positionOffset"]);
+		meshBuffers.draw();
+	}
+}
+
 void render()
 {
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	glUseProgram(program.handle);
-	glBindVertexArray(vao);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
 	
 	glUniform(program.uniforms["model"], model);
 	glUniform(program.uniforms["view"], view);
 	glUniform(program.uniforms["projection"], projection);
 	glUniform(program.uniforms["white"], 0.0f);
 
-	glDrawElements(GL_TRIANGLES, elementCount, GL_UNSIGNED_SHORT, 0);
+	drawSurface();
 
 	// Draw wireframe
 	glUniform(program.uniforms["white"], 1.0f);
 	glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-	glDrawElements(GL_TRIANGLES, elementCount, GL_UNSIGNED_SHORT, 0);
+	drawSurface();
 	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-
-	glBindVertexArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 	glUseProgram(0);
 
 	glfwSwapBuffers();
 }
 
+// Writes the mesh slab by slab, it never exists in memory as a whole
+void exportSurface(const char *filename, int resolution)
+{
+	MeshFileWriter writer;
+	if(!writer.open(filename))
+	{
+		std::cerr<<"Failure creating "<<filename<<std::endl;
+		return;
+	}
+
+	auto exportStart = std::chrono::steady_clock::now();
+	polygonizeMarchingCubesStreaming(surfaceField, resolution, gridMin, gridMax,
+		[&](const MeshChunk &chunk) { writer.write(chunk); });
+	if(!writer.close())
+		std::cerr<<"Failure writing "<<filename<<std::endl;
+	std::cout<<"Exported "<<writer.getVertexCount()<<" vertices and "<<writer.getIndexCount()<<" indices at resolution "
+		<<resolution<<" to "<<filename<<" in "<<std::chrono::duration<double>(std::chrono::steady_clock::now() - exportStart).count()<<" seconds"<<std::endl;
+}
+
+void loadSurfaceField(const char *filename)
+{
+	std::string source;
+	if(!readFile(filename, source))
+		std::cerr<<"Failure reading "<<filename<<std::endl;
+	else if(compileSurfaceField(filename, source, surfaceField))
+	{
+		surfaceSource = source;
+		return;
+	}
+	std::cerr<<"Using the built in nordstrand field"<<std::endl;
+	surfaceField = nordstrandField;
+}
+
 int main()
 {
 	int width = 640;
 	int height = 480;
 
+	loadSurfaceField("data/isosurface.field");
+	if(exportResolution > 0)
+		exportSurface("isosurface.mesh", exportResolution);
+
 	if(!initGL("Isosurface", width, height, 3, 1, 24, 8, 4, false))
 		exit(EXIT_FAILURE);
 
@@ -309,9 +407,8 @@ int main()
 	glDeleteShader(vsShader);
 	glDeleteShader(fsShader);
 	glDeleteProgram(program.handle);
-	glDeleteBuffers(1, &vbo);
-	glDeleteBuffers(1, &vao);
-	glDeleteBuffers(1, &ibo);
+	brickMesh.destroy();
+	meshBuffers.destroy();
 	glDeleteVertexArrays(1, &vao);
 	glfwTerminate();
 	return EXIT_SUCCESS;
@@ -1,12 +1,21 @@
 /* 
 OpenGL examples - Patched sphere
 
-Generate a sphere mesh by normalizing a cube
+Generate a sphere mesh by normalizing a cube, see common/cubesphere.h
 http://www.iquilezles.org/www/articles/patchedsphere/patchedsphere.htm
+or draw it as quadtrees of patches refined around the camera, see common/spherelod.h.
+L switches between the two, the mouse orbits and the wheel flies down to the surface.
 */
 
 #include "common/glutils.h"
 #include "common/globj.h"
+#include "common/camera.h"
+#include "common/cubesphere.h"
+#include "common/meshjob.h"
+#include "common/meshcache.h"
+#include "common/meshopt.h"
+#include "common/spherelod.h"
+#include <cmath>
 #include <iostream>
 #include <vector>
 #include <unordered_map>
@@ -15,141 +24,23 @@ using namespace glm;
 Program program;
 GLuint vsShader;
 GLuint fsShader;
-GLuint vbo, vao, ibo;
-int elementCount;
+MeshJob meshJob;
+MeshBuffers meshBuffers;
+SphereLod sphereLod;
+GLuint lodVao;
+Camera camera;
 
 mat4 model;
 mat4 view;
 mat4 projection;
 
-// Appends a clockwise oriented quad to the list of positions and indices
-void addQuad(const vec3 &v0, const vec3 &v1, const vec3 &v2, const vec3 &v3,
-std::vector<vec3> &positions, std::vector<GLushort> &indices)
-{
-	GLushort i = positions.size();
-	positions.push_back(v0);
-	positions.push_back(v1);
-	positions.push_back(v2);
-	positions.push_back(v3);
-	indices.push_back(i + 0);
-	indices.push_back(i + 1);
-	indices.push_back(i + 2);
-	indices.push_back(i + 2);
-	indices.push_back(i + 3);
-	indices.push_back(i + 0);
-}
-
-void generateSphereNormal(std::vector<vec3> &positions, std::vector<GLushort> &indices)
-{
-	static const float PI = 3.1415926535f;
-	static const float TWO_PI = 6.2831853071f;
-	float r = 2.0f;
-	float step = PI / 8.0f;
-	for(float theta = 0.0f; theta <= TWO_PI - step * 0.95f; theta += step)
-	{
-		for(float phi = 0.0f; phi <= PI - step * 0.95f; phi += step)
-		{
-			std::size_t i = positions.size();
-			vec3 v0 = vec3(r*sinf(phi)*sinf(theta), r*cosf(phi), r*sinf(phi)*cosf(theta));
-			vec3 v1 = vec3(r*sinf(phi)*sinf(theta + step), r*cosf(phi), r*sinf(phi)*cosf(theta + step));
-			vec3 v2 = vec3(r*sinf(phi + step)*sinf(theta + step), r*cosf(phi + step), r*sinf(phi + step)*cosf(theta + step));
-			vec3 v3 = vec3(r*sinf(phi + step)*sinf(theta), r*cosf(phi + step), r*sinf(phi + step)*cosf(theta));
-			positions.push_back(v0);
-			positions.push_back(v1);
-			positions.push_back(v2);
-			positions.push_back(v3);
-			indices.push_back(i + 0);
-			indices.push_back(i + 1);
-			indices.push_back(i + 2);
-			indices.push_back(i + 2);
-			indices.push_back(i + 3);
-			indices.push_back(i + 0);
-		}
-	}
-}
-
-void generateSpherePatched(std::vector<vec3> &positions, std::vector<GLushort> &indices)
-{
-	float r = 2.0f;
-	int m = 5; // squares per face
-	for(int i = 0; i <= m - 1; i += 1)
-	{
-		for(int j = 0; j <= m - 1; j += 1)
-		{
-			float sa = -1.0f + 2.0f * (i / float(m));
-			float sb = -1.0f + 2.0f * ((i + 1) / float(m));
-			float ta = -1.0f + 2.0f * (j / float(m));
-			float tb = -1.0f + 2.0f * ((j + 1) / float(m));
-			GLushort i = positions.size();
-			positions.push_back(normalize(vec3(sa,	tb,	1.0f)));
-			positions.push_back(normalize(vec3(sb,	tb,	1.0f)));
-			positions.push_back(normalize(vec3(sb,	ta,	1.0f)));
-			positions.push_back(normalize(vec3(sa,	ta,	1.0f)));
-			indices.push_back(i + 0); indices.push_back(i + 1); indices.push_back(i + 2);
-			indices.push_back(i + 2); indices.push_back(i + 3); indices.push_back(i + 0);
-			i += 4;
-			positions.push_back(normalize(vec3(sa,	ta,	-1.0f)));
-			positions.push_back(normalize(vec3(sb,	ta,	-1.0f)));
-			positions.push_back(normalize(vec3(sb,	tb,	-1.0f)));
-			positions.push_back(normalize(vec3(sa,	tb,	-1.0f)));
-			indices.push_back(i + 0); indices.push_back(i + 1); indices.push_back(i + 2);
-			indices.push_back(i + 2); indices.push_back(i + 3); indices.push_back(i + 0);
-			i += 4;
-			positions.push_back(normalize(vec3(sa,	1.0f, ta)));
-			positions.push_back(normalize(vec3(sb,	1.0f, ta)));
-			positions.push_back(normalize(vec3(sb,	1.0f, tb)));
-			positions.push_back(normalize(vec3(sa,	1.0f, tb)));
-			indices.push_back(i + 0); indices.push_back(i + 1); indices.push_back(i + 2);
-			indices.push_back(i + 2); indices.push_back(i + 3); indices.push_back(i + 0);
-			i += 4;
-			positions.push_back(normalize(vec3(sa, -1.0f, tb)));
-			positions.push_back(normalize(vec3(sb, -1.0f, tb)));
-			positions.push_back(normalize(vec3(sb, -1.0f, ta)));
-			positions.push_back(normalize(vec3(sa, -1.0f, ta)));
-			indices.push_back(i + 0); indices.push_back(i + 1); indices.push_back(i + 2);
-			indices.push_back(i + 2); indices.push_back(i + 3); indices.push_back(i + 0);
-			i += 4;
-			positions.push_back(normalize(vec3(-1.0f, sa, ta)));
-			positions.push_back(normalize(vec3(-1.0f, sb, ta)));
-			positions.push_back(normalize(vec3(-1.0f, sb, tb)));
-			positions.push_back(normalize(vec3(-1.0f, sa, tb)));
-			indices.push_back(i + 0); indices.push_back(i + 1); indices.push_back(i + 2);
-			indices.push_back(i + 2); indices.push_back(i + 3); indices.push_back(i + 0);
-			i += 4;
-			positions.push_back(normalize(vec3(1.0f, sa, tb)));
-			positions.push_back(normalize(vec3(1.0f, sb, tb)));
-			positions.push_back(normalize(vec3(1.0f, sb, ta)));
-			positions.push_back(normalize(vec3(1.0f, sa, ta)));
-			indices.push_back(i + 0); indices.push_back(i + 1); indices.push_back(i + 2);
-			indices.push_back(i + 2); indices.push_back(i + 3); indices.push_back(i + 0);
-			i += 4;
-		}
-	}
-}
-
-void computeSurfaceNormals(const std::vector<vec3> &positions, const std::vector<GLushort> &indices, 
-std::vector<vec3> &normals, bool flip)
-{
-	normals = std::vector<vec3>(positions.size());
-	for(int i = 0; i < indices.size() - 2; i += 3)
-	{
-		GLushort j0 = indices[i + 0];
-		GLushort j1 = indices[i + 1];
-		GLushort j2 = indices[i + 2];
-		vec3 v0 = positions[j0];
-		vec3 v1 = positions[j1];
-		vec3 v2 = positions[j2];
-
-		// Each triangle has the same normal, defined by the crossproduct of two edges
-		vec3 n = normalize(cross(v1 - v0, v2 - v0));
-		if(flip)
-			n = -n;
-
-		normals[j0] = n;
-		normals[j1] = n;
-		normals[j2] = n;
-	}
-}
+const float sphereRadius = 2.0f;
+const int sphereSubdivisions = 8; // quads along each edge of a cube face
+const bool weldSphere = true; // share the vertices along the edges of the cube faces
+const int lodPatchSize = 16; // quads along each edge of a patch
+const int lodPoolSize = 1024; // patches kept in the vertex buffer
+const float minAltitude = sphereRadius * 1e-5f;
+const float fieldOfView = 45.0f;
 
 void initProgram()
 {
@@ -167,44 +58,37 @@ void initProgram()
 	program.uniforms["view"] = glGetUniformLocation(program.handle, "view");
 	program.uniforms["projection"] = glGetUniformLocation(program.handle, "projection");
 	program.uniforms["white"] = glGetUniformLocation(program.handle, "white");
+	program.uniforms["positionScale"] = glGetUniformLocation(program.handle, "positionScale");
+	program.uniforms["positionOffset"] = glGetUniformLocation(program.handle, "positionOffset");
 }
 
 void initBuffers()
 {
-	std::vector<vec3> positions;
-	std::vector<vec3> normals;
-	std::vector<GLushort> indices;
-	generateSphereNormal(positions, indices);
-	computeSurfaceNormals(positions, indices, normals, true);
-	elementCount = indices.size();
-	
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
-
-	// Create vertex buffer object to hold the vertex data
-	GLsizeiptr b0 = positions.size() * sizeof(vec3);
-	GLsizeiptr b1 = normals.size() * sizeof(vec3);
-	glGenBuffers(1, &vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, b0 + b1, NULL, GL_STATIC_DRAW);
-	glBufferSubData(GL_ARRAY_BUFFER, 0,	b0,	&positions[0]);
-	glBufferSubData(GL_ARRAY_BUFFER, b0, b1, &normals[0]);
-
-	// Enable and specify vertex format
-	glEnableVertexAttribArray(program.getAttribLoc("position"));
-	glEnableVertexAttribArray(program.getAttribLoc("normal"));
-	glVertexAttribPointer(program.getAttribLoc("position"),	3,	GL_FLOAT, GL_FALSE, 0, (void*)(0));
-	glVertexAttribPointer(program.getAttribLoc("normal"),	3,	GL_FLOAT, GL_FALSE, 0, (void*)(b0));
-
-	// Create index buffer object to hold the index data
-	glGenBuffers(1, &ibo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), &indices[0], GL_STATIC_DRAW);
-
-	// "Unbind" vao and buffers
-	glBindVertexArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	sphereLod.create(sphereRadius, lodPatchSize, lodPoolSize);
+	glGenVertexArrays(1, &lodVao);
+
+	meshBuffers.create(program.getAttribLoc("position"), program.getAttribLoc("normal"));
+
+	// Use the mesh stored by a previous run if there is one
+	MeshCacheKey key;
+	key.add("sphere").add(sphereRadius).add(sphereSubdivisions).add(int(weldSphere));
+	MappedMeshFile cached;
+	if(loadCachedMesh(key, cached))
+	{
+		meshBuffers.uploadInterleaved(cached.getVertices(), cached.getVertexCount(), cached.getIndices(), cached.getIndexCount());
+		return;
+	}
+
+	// Otherwise build it on a worker thread, update() uploads it once it is done
+	meshJob.start([key](MeshData &mesh)
+	{
+		generateCubeSphere(sphereRadius, sphereSubdivisions, weldSphere, mesh.positions, mesh.normals, mesh.indices);
+		MeshOptimizeReport report = optimizeMesh(mesh.positions, mesh.indices, true, true, &mesh.normals);
+		std::cout<<"Vertex cache ACMR "<<report.before.acmr<<" -> "<<report.after.acmr
+			<<", ATVR "<<report.before.atvr<<" -> "<<report.after.atvr<<std::endl;
+		if(!storeCachedMesh(key, mesh))
+			std::cerr<<"Failure storing "<<key.getFilename()<<std::endl;
+	});
 }
 
 double time0 = 0.0;
@@ -212,10 +96,11 @@ int lastMouseX = 320;
 int lastMouseY = 240;
 float rotationSpeedX = 0.0f;
 float rotationSpeedY = 0.0f;
-float rotationX = 0.0f;
-float rotationY = 0.0f;
 bool keydown = false;
 bool wireframe = true;
+bool lodKeydown = false;
+bool lodEnabled = true;
+double lastReport = 0.0;
 
 void update(double time)
 {
@@ -231,6 +116,23 @@ void update(double time)
 		keydown = false;
 	}
 
+	if(glfwGetKey('L') && !lodKeydown)
+	{
+		lodEnabled = !lodEnabled;
+		lodKeydown = true;
+	}
+	else if(!glfwGetKey('L'))
+	{
+		lodKeydown = false;
+	}
+
+	MeshData mesh;
+	if(meshJob.poll(mesh))
+	{
+		std::cout<<"Generated sphere ("<<mesh.positions.size()<<" vertices) in "<<mesh.buildTime<<" seconds"<<std::endl;
+		meshBuffers.upload(mesh);
+	}
+
 	int mouseX, mouseY;
 	glfwGetMousePos(&mouseX, &mouseY);
 	if(glfwGetMouseButton(GLFW_MOUSE_BUTTON_LEFT))
@@ -243,46 +145,75 @@ void update(double time)
 
 	rotationSpeedX = 0.95f * rotationSpeedX;
 	rotationSpeedY = 0.95f * rotationSpeedY;
-	rotationX += rotationSpeedX;
-	rotationY += rotationSpeedY;
 	lastMouseX = mouseX;
 	lastMouseY = mouseY;
 
-	model = rotateX(-rotationX) * rotateY(-rotationY);
-	float zoom = float(glfwGetMouseWheel()) * 0.05f;
-	view = translate(0.0f, 0.0f, -4.0f + zoom);
-	projection = glm::perspective(45.0f, 640.0f / 480.0f, 0.1f, 10.0f);
+	// Orbit the sphere looking at its center, slower near the surface so the ground does not race by
+	float altitude = std::max(minAltitude, 2.0f * std::pow(0.85f, float(glfwGetMouseWheel())));
+	float orbitSpeed = std::min(1.0f, altitude / sphereRadius);
+	camera.rotateLeft(rotationSpeedY * orbitSpeed);
+	camera.rotateUp(rotationSpeedX * orbitSpeed);
+	camera.updateVectors();
+	camera.setPosition(-(sphereRadius + altitude) * camera.getForward());
+
+	// Nothing is nearer than the ground below or farther than the horizon
+	float horizon = std::sqrt(altitude * (altitude + 2.0f * sphereRadius));
+	model = mat4(1.0f);
+	view = camera.getViewMatrix();
+	projection = glm::perspective(fieldOfView, 640.0f / 480.0f, 0.5f * altitude, 1.1f * horizon + altitude);
+
+	if(lodEnabled)
+	{
+		float pixelsPerRadian = 480.0f / (2.0f * std::tan(0.5f * fieldOfView * 3.1415926535f / 180.0f));
+		sphereLod.update(camera.getPosition(), projection * view, pixelsPerRadian);
+		if(time - lastReport > 1.0)
+		{
+			std::cout<<"Altitude "<<altitude<<": "<<sphereLod.getPatchCount()<<" patches, "<<sphereLod.getTriangleCount()
+				<<" triangles, deepest level "<<sphereLod.getDeepestLevel()<<", "<<sphereLod.getResidentCount()<<" in the pool"<<std::endl;
+			lastReport = time;
+		}
+	}
 
 	time0 = time;
 }
 
+void drawSphere()
+{
+	if(lodEnabled)
+	{
+		glBindVertexArray(lodVao);
+		sphereLod.bindBuffers();
+		sphereLod.draw(program.getAttribLoc("position"), program.getAttribLoc("normal"),
+			program.uniforms["positionScale"], program.uniforms["positionOffset"]);
+		glBindVertexArray(0);
+		return;
+	}
+
+	meshBuffers.getVertexFormat().setPositionUniforms(program.uniforms["positionScale"], program.uniforms["positionOffset"]);
+	meshBuffers.draw();
+}
+
 void render()
 {
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	glUseProgram(program.handle);
-	glBindVertexArray(vao);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
 	
 	glUniform(program.uniforms["model"], model);
 	glUniform(program.uniforms["view"], view);
 	glUniform(program.uniforms["projection"], projection);
 	glUniform(program.uniforms["white"], 0.0f);
 
-	glDrawElements(GL_TRIANGLES, elementCount, GL_UNSIGNED_SHORT, 0);
+	drawSphere();
 
 	if(wireframe)
 	{
 		glUniform(program.uniforms["white"], 1.0f);
 		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-		glDrawElements(GL_TRIANGLES, elementCount, GL_UNSIGNED_SHORT, 0);
+		drawSphere();
 		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 	}
 
-	glBindVertexArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 	glUseProgram(0);
 
 	glfwSwapBuffers();
@@ -334,10 +265,9 @@ int main()
 	glDeleteShader(vsShader);
 	glDeleteShader(fsShader);
 	glDeleteProgram(program.handle);
-	glDeleteBuffers(1, &vbo);
-	glDeleteBuffers(1, &vao);
-	glDeleteBuffers(1, &ibo);
-	glDeleteVertexArrays(1, &vao);
+	meshBuffers.destroy();
+	sphereLod.destroy();
+	glDeleteVertexArrays(1, &lodVao);
 	glfwTerminate();
 	return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -1,32 +1,104 @@
 /* 
 OpenGL examples - Mandelbrot
+
+Drawn by data/fractal.fs, or computed on the CPU (see common/mandelbrot.h) without
+opening a window:
+	06mandelbrot --cpu image.png [--size width height] [--view zoom x y] [--iterations n]
+writes the view to a .png or .ppm file. B compares the speed of the two on the current view.
+E turns the early exits for the inside of the set (see common/mandelbrot.h) off and on in
+every mode, --exact turns them off for a file.
+
+F goes through the formulas of common/fractal.h, the Mandelbrot set, Multibrot of power 3,
+the Julia set and the Burning Ship, and C switches to smooth colouring. Each is its own
+variant of the shader, compiled when it is picked. For a file,
+	[--fractal mandelbrot|multibrotN|julia|ship] [--julia x y] [--smooth] [--precision float|double|dd]
+render with the specialized kernel of the formula, --julia alone with the Julia set.
+The deep zoom stays with the Mandelbrot set.
+
+D switches to the deep zoom (see common/deepzoom.h), computed on the CPU and shown as a
+texture, which goes on where the floats of the shader run out. The image is kept between
+frames (see common/progressive.h): panning only computes the strips that come into view
+and zooming sharpens a resampled preview from the center out. A still view is not drawn
+again in either mode. T draws it from a quadtree of cached tiles instead (see
+common/tilecache.h), which makes going back to a region almost free, down to the deepest
+tile level. B times it and prints the view, which
+	06mandelbrot --cpu image.png --center x y --scale s [--iterations n]
+renders to a file.
+
+Files of any size are rendered in bands of rows and streamed to disk as they are done
+(see common/bandexport.h), so
+	06mandelbrot --cpu poster.png --size 65536 65536 --center x y --scale s
+makes a poster of a view without holding it in memory, reporting its progress as it
+goes. --band sets the rows of a band.
 */
 
 #include "common/glutils.h"
 #include "common/globj.h"
+#include "common/bandexport.h"
+#include "common/deepzoom.h"
+#include "common/fractal.h"
+#include "common/mandelbrot.h"
+#include "common/parallel.h"
+#include "common/progressive.h"
+#include "common/tilecache.h"
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 #include <vector>
 #include <unordered_map>
 using namespace glm;
 
 Program program;
+Program imageProgram;
 GLuint vsShader;
 GLuint fsShader;
+GLuint imageFsShader;
 GLuint vbo, vao, ibo;
+GLuint texture;
+const int deepWidth = 640;
+const int deepHeight = 480;
 
-void initProgram()
+FractalSettings fractal;
+const int shaderIterations = 128;
+
+// The variant of the shader for the fractal settings, replacing the last one
+void initFractalProgram()
 {
-	std::string vsSrc, fsSrc;
-	if(!readFile("data/mandelbrot.vs", vsSrc) ||
-		!readFile("data/mandelbrot.fs", fsSrc))
+	std::string fsSrc;
+	if(!readFile("data/fractal.fs", fsSrc))
 		std::cerr<<"Failure reading shader data"<<std::endl;
 
-	vsShader = getShader(GL_VERTEX_SHADER, vsSrc);
-	fsShader = getShader(GL_FRAGMENT_SHADER, fsSrc);
+	if(program.handle)
+	{
+		glDeleteProgram(program.handle);
+		glDeleteShader(fsShader);
+	}
+	fsShader = getShader(GL_FRAGMENT_SHADER, addShaderDefines(fsSrc, getFractalDefines(fractal, shaderIterations)));
 	program.handle = getProgram(vsShader, fsShader);
 	program.attribs["position"]	= glGetAttribLocation(program.handle, "position");
 	program.uniforms["zoom"] = glGetUniformLocation(program.handle, "zoom");
 	program.uniforms["offset"] = glGetUniformLocation(program.handle, "offset");
+	program.uniforms["interiorChecks"] = glGetUniformLocation(program.handle, "interiorChecks");
+}
+
+void initProgram()
+{
+	std::string vsSrc, fsSrc;
+	if(!readFile("data/mandelbrot.vs", vsSrc))
+		std::cerr<<"Failure reading shader data"<<std::endl;
+
+	vsShader = getShader(GL_VERTEX_SHADER, vsSrc);
+	initFractalProgram();
+
+	if(!readFile("data/image.fs", fsSrc))
+		std::cerr<<"Failure reading shader data"<<std::endl;
+
+	imageFsShader = getShader(GL_FRAGMENT_SHADER, fsSrc);
+	imageProgram.handle = getProgram(vsShader, imageFsShader);
+	imageProgram.attribs["position"] = glGetAttribLocation(imageProgram.handle, "position");
+	imageProgram.uniforms["image"] = glGetUniformLocation(imageProgram.handle, "image");
 }
 
 void initBuffers()
@@ -49,6 +121,8 @@ void initBuffers()
 	// Enable and specify vertex format
 	glEnableVertexAttribArray(program.getAttribLoc("position"));
 	glVertexAttribPointer(program.getAttribLoc("position"),	2,	GL_FLOAT, GL_FALSE, 0, (void*)(0));
+	glEnableVertexAttribArray(imageProgram.getAttribLoc("position"));
+	glVertexAttribPointer(imageProgram.getAttribLoc("position"),	2,	GL_FLOAT, GL_FALSE, 0, (void*)(0));
 
 	const GLushort indices[] = { 0, 1, 2, 2, 3, 0 };
 
@@ -61,6 +135,16 @@ void initBuffers()
 	glBindVertexArray(0);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	// The deep zoom image, filtered so the previews fill the window
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, deepWidth, deepHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 double time0 = 0.0;
@@ -71,59 +155,543 @@ float zoomSpeed = 0.0f;
 vec2 offset = vec2(0.0f, 0.0f);
 vec2 offsetSpeed = vec2(0.0f, 0.0f);
 int mouseWheel0 = 0;
+bool benchmarkKeydown = false;
+bool redraw = true;
+bool earlyExits = true;
+bool earlyExitKeydown = false;
+bool formulaKeydown = false;
+bool coloringKeydown = false;
+
+bool deepMode = false;
+bool deepKeydown = false;
+DeepView deepView;
+vec2 deepPanSpeed = vec2(0.0f, 0.0f);
+vec2 deepPanPixels = vec2(0.0f, 0.0f); // what the view moved short of a whole pixel
+float deepZoomSpeed = 0.0f;
+ProgressiveImage deepImage;
+std::vector<double> deepOrbit;
+bool deepOrbitDirty = true;
+bool deepStale = true; // the texture shows something else than deepImage
+std::vector<unsigned char> deepPixels;
+
+bool tileMode = false;
+bool tileKeydown = false;
+bool tilesDirty = true;
+TileCache tileCache(64 << 20, "tilecache");
+std::vector<TileKey> visibleTiles;
+std::vector<int> tileCounts;
+
+void drawQuad()
+{
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+
+	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void drawFractal()
+{
+	glUniform(program.uniforms["zoom"], zoom);
+	glUniform(program.uniforms["offset"], offset);
+	glUniform(program.uniforms["interiorChecks"], GLint(earlyExits));
+	drawQuad();
+}
+
+// Enough decimals for every word of the center
+std::string getDeepViewArgs(const DeepView &view)
+{
+	int decimals = 10 * view.getPrecision();
+	std::ostringstream args;
+	args<<"--center "<<view.x.toString(decimals)<<" "<<view.y.toString(decimals)
+		<<" --scale "<<std::setprecision(17)<<view.scale<<" --iterations "<<view.maxIteration;
+	return args.str();
+}
+
+void benchmarkDeep()
+{
+	std::vector<int> counts;
+	double start = glfwGetTime();
+	std::uint64_t iterations = computeDeepMandelbrot(deepView, 640, 480, counts);
+	double cpuTime = glfwGetTime() - start;
+
+	std::cout<<"View "<<getDeepViewArgs(deepView)<<", "<<iterations<<" iterations done"<<std::endl;
+	std::cout<<"CPU ("<<getWorkerCount()<<" threads): "<<cpuTime * 1000.0<<" ms, "
+		<<640.0 * 480.0 / cpuTime * 1e-6<<" Mpixels/s, "<<double(iterations) / cpuTime * 1e-6<<" Mpixel-iterations/s"<<std::endl;
+}
+
+// Times the shader and the CPU on the current view, in pixels per second. The
+// iterations are only those the CPU did, the shader skips other ones
+void benchmark()
+{
+	MandelbrotView view;
+	view.zoom = zoom;
+	view.offset = offset;
+	view.maxIteration = shaderIterations;
+	view.interiorChecks = view.subdivide = earlyExits;
+	std::vector<int> counts;
+	std::vector<float> values;
+	bool plain = fractal.formula == MandelbrotFormula && fractal.coloring == CountColoring;
+	double start = glfwGetTime();
+	std::uint64_t iterations = plain ? computeMandelbrot(view, 640, 480, counts) :
+		computeFractal(fractal, DeepView(view), 640, 480, values);
+	double cpuTime = glfwGetTime() - start;
+
+	const int frames = 20;
+	glUseProgram(program.handle);
+	glFinish();
+	start = glfwGetTime();
+	for(int i = 0; i < frames; ++i)
+		drawFractal();
+	glFinish();
+	double gpuTime = (glfwGetTime() - start) / frames;
+	glUseProgram(0);
+
+	std::cout<<"View --view "<<zoom<<" "<<offset.x<<" "<<offset.y<<" --fractal "<<getFractalName(fractal)
+		<<(fractal.coloring == SmoothColoring ? " --smooth" : "")<<", "<<iterations<<" iterations done"<<std::endl;
+	std::cout<<"CPU ("<<getWorkerCount()<<" threads): "<<cpuTime * 1000.0<<" ms, "
+		<<640.0 * 480.0 / cpuTime * 1e-6<<" Mpixels/s, "<<double(iterations) / cpuTime * 1e-6<<" Mpixel-iterations/s"<<std::endl;
+	std::cout<<"GPU: "<<gpuTime * 1000.0<<" ms, "<<640.0 * 480.0 / gpuTime * 1e-6<<" Mpixels/s"<<std::endl;
+}
+
 void update(double time)
 {
 	double dt = time - time0;
 
-	int mouseX, mouseY;
-	glfwGetMousePos(&mouseX, &mouseY);
-	if(glfwGetMouseButton(GLFW_MOUSE_BUTTON_LEFT))
+	if(glfwGetKey('B') && !benchmarkKeydown)
 	{
-		int dx = mouseX - lastMouseX;
-		int dy = mouseY - lastMouseY;
-		offsetSpeed += vec2(dx * 0.005f, -dy * 0.005f) * (1.0f - zoom);
+		if(deepMode)
+			benchmarkDeep();
+		else
+			benchmark();
+		redraw = true;
+		benchmarkKeydown = true;
+	}
+	else if(!glfwGetKey('B'))
+	{
+		benchmarkKeydown = false;
+	}
+
+	if(glfwGetKey('E') && !earlyExitKeydown)
+	{
+		earlyExits = !earlyExits;
+		std::cout<<"Early exits "<<(earlyExits ? "on" : "off")<<std::endl;
+		deepView.interiorChecks = deepView.subdivide = earlyExits;
+		if(deepMode)
+			deepImage.invalidate();
+		tilesDirty = true;
+		redraw = true;
+		earlyExitKeydown = true;
+	}
+	else if(!glfwGetKey('E'))
+	{
+		earlyExitKeydown = false;
 	}
 
+	// The formulas and colourings of the shader, the deep zoom only has the Mandelbrot set
+	if(glfwGetKey('F') && !formulaKeydown)
+	{
+		static const char *formulas[] = { "mandelbrot", "multibrot3", "julia", "ship" };
+		std::string name = getFractalName(fractal);
+		int next = 0;
+		for(int i = 0; i < 4; ++i)
+			next = name == formulas[i] ? (i + 1) % 4 : next;
+		parseFractalFormula(formulas[next], fractal);
+		std::cout<<"Fractal "<<formulas[next]<<std::endl;
+		initFractalProgram();
+		redraw = true;
+		formulaKeydown = true;
+	}
+	else if(!glfwGetKey('F'))
+	{
+		formulaKeydown = false;
+	}
+
+	if(glfwGetKey('C') && !coloringKeydown)
+	{
+		fractal.coloring = fractal.coloring == SmoothColoring ? CountColoring : SmoothColoring;
+		std::cout<<(fractal.coloring == SmoothColoring ? "Smooth" : "Count")<<" colouring"<<std::endl;
+		initFractalProgram();
+		redraw = true;
+		coloringKeydown = true;
+	}
+	else if(!glfwGetKey('C'))
+	{
+		coloringKeydown = false;
+	}
+
+	if(glfwGetKey('D') && !deepKeydown)
+	{
+		deepMode = !deepMode;
+		if(deepMode)
+		{
+			MandelbrotView view;
+			view.zoom = zoom;
+			view.offset = offset;
+			view.interiorChecks = view.subdivide = earlyExits;
+			deepView = DeepView(view);
+			deepView.maxIteration = getDeepIterationLimit(deepView.scale);
+			deepImage.resize(deepWidth, deepHeight);
+			deepPanPixels = vec2(0.0f, 0.0f);
+			deepOrbitDirty = true;
+			tilesDirty = true;
+		}
+		else
+		{
+			// As close as the floats of the shader get
+			zoom = float(1.0 - deepView.scale);
+			offset = vec2(float(deepView.x.toDouble() + 0.75 * deepView.scale), float(deepView.y.toDouble()));
+		}
+		offsetSpeed = deepPanSpeed = vec2(0.0f, 0.0f);
+		zoomSpeed = deepZoomSpeed = 0.0f;
+		redraw = true;
+		deepKeydown = true;
+	}
+	else if(!glfwGetKey('D'))
+	{
+		deepKeydown = false;
+	}
+
+	if(glfwGetKey('T') && !tileKeydown)
+	{
+		tileMode = !tileMode;
+		std::cout<<(tileMode ? "Tiles" : "Progressive")<<", "<<tileCache.getTileCount()<<" tiles in memory, "
+			<<tileCache.getSpilledCount()<<" on disk"<<std::endl;
+		tilesDirty = true;
+		deepStale = true;
+		tileKeydown = true;
+	}
+	else if(!glfwGetKey('T'))
+	{
+		tileKeydown = false;
+	}
+
+	int mouseX, mouseY;
+	glfwGetMousePos(&mouseX, &mouseY);
+	int dx = mouseX - lastMouseX;
+	int dy = mouseY - lastMouseY;
+	bool dragging = glfwGetMouseButton(GLFW_MOUSE_BUTTON_LEFT) != 0;
 	int mouseWheel1 = glfwGetMouseWheel();
 	int dw = mouseWheel1 - mouseWheel0;
-	zoomSpeed += float(dw) * 0.0005f * (1.0f - zoom);
 	mouseWheel0 = mouseWheel1;
+	lastMouseX = mouseX;
+	lastMouseY = mouseY;
+	time0 = time;
+
+	if(deepMode)
+	{
+		// In fractions of the view, so the speed feels the same at every depth
+		if(dragging)
+			deepPanSpeed += vec2(dx, -dy) * 0.0015f;
+		deepZoomSpeed += float(dw) * 0.02f;
+		deepPanSpeed *= 0.95f;
+		deepZoomSpeed *= 0.95f;
+		if(length(deepPanSpeed) < 1e-4f)
+			deepPanSpeed = vec2(0.0f, 0.0f);
+		if(std::abs(deepZoomSpeed) < 1e-4f)
+			deepZoomSpeed = 0.0f;
+
+		// Whole pixels at a time, so the image can move and keep what it computed
+		deepPanPixels += deepPanSpeed * float(dt) * vec2(float(deepWidth), float(deepHeight));
+		int px = int(deepPanPixels.x);
+		int py = int(deepPanPixels.y);
+		if(px != 0 || py != 0)
+		{
+			deepPanPixels -= vec2(float(px), float(py));
+			deepView.pan(double(px) / deepWidth, double(py) / deepHeight);
+			deepImage.shift(-px, py);
+			deepOrbitDirty = true;
+			tilesDirty = true;
+		}
+
+		// Between the whole set and the deepest scale the doubles resolve
+		double scale = std::min(std::max(deepView.scale * std::exp(-double(deepZoomSpeed)), minDeepScale), 1.0);
+		if(deepZoomSpeed != 0.0f && scale != deepView.scale)
+		{
+			double factor = scale / deepView.scale;
+			deepView.scale = scale;
+			deepView.maxIteration = getDeepIterationLimit(deepView.scale);
+			deepImage.zoom(factor);
+			deepOrbitDirty = true;
+			tilesDirty = true;
+		}
+		return;
+	}
+
+	if(dragging)
+		offsetSpeed += vec2(dx * 0.005f, -dy * 0.005f) * (1.0f - zoom);
+	zoomSpeed += float(dw) * 0.0005f * (1.0f - zoom);
 
+	// The coasting ends once it moves the image by less than a pixel a second
 	offsetSpeed *= 0.95f;
-	offset = vec2(offset.x + offsetSpeed.x * dt, offset.y + offsetSpeed.y * dt);
 	zoomSpeed *= 0.95f;
-	zoom += zoomSpeed;
+	if(length(offsetSpeed) < 0.005f * (1.0f - zoom))
+		offsetSpeed = vec2(0.0f, 0.0f);
+	if(std::abs(zoomSpeed) < 1e-4f * (1.0f - zoom))
+		zoomSpeed = 0.0f;
 
-	lastMouseX = mouseX;
-	lastMouseY = mouseY;
+	if(offsetSpeed != vec2(0.0f, 0.0f) || zoomSpeed != 0.0f)
+	{
+		offset = vec2(offset.x + offsetSpeed.x * dt, offset.y + offsetSpeed.y * dt);
+		zoom += zoomSpeed;
+		redraw = true;
+	}
+}
 
-	time0 = time;
+void uploadDeep(const int *counts, int maxIteration)
+{
+	std::size_t count = std::size_t(deepWidth) * deepHeight;
+	deepPixels.resize(count * 3);
+	colorMandelbrot(counts, count, maxIteration, &deepPixels[0]);
+
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, deepWidth, deepHeight, GL_RGB, GL_UNSIGNED_BYTE, &deepPixels[0]);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	redraw = true;
 }
 
-void render()
+// Spends part of the frame on the pixels the deep view still lacks and uploads the image.
+// Once they are all done this returns at once
+void refineDeep()
 {
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	if(deepImage.isDone() && !deepStale)
+		return;
 
-	glUseProgram(program.handle);
-	glBindVertexArray(vao);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	
-	glUniform(program.uniforms["zoom"], zoom);
-	glUniform(program.uniforms["offset"], offset);
+	if(deepOrbitDirty)
+	{
+		computeReferenceOrbit(deepView, deepOrbit);
+		deepOrbitDirty = false;
+	}
+	deepImage.refine(getDeepKernel(deepView, deepOrbit, deepWidth, deepHeight), 0.02);
+	uploadDeep(deepImage.getCounts(), deepView.maxIteration);
+	deepStale = false;
+}
 
-	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
+// Computes the missing tiles of the view for part of the frame, nearest the center first,
+// and draws the view from the cache. Once they are all there only a move draws again
+void refineTiles()
+{
+	if(!tilesDirty)
+		return;
 
-	glBindVertexArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	getVisibleTiles(deepView, deepWidth, visibleTiles);
+	requestTiles(tileCache, visibleTiles, 0.02);
+	tileCounts.resize(std::size_t(deepWidth) * deepHeight);
+	tilesDirty = !drawTiles(tileCache, deepView, deepWidth, deepHeight, &tileCounts[0]);
+	uploadDeep(&tileCounts[0], visibleTiles.empty() ? deepView.maxIteration : visibleTiles[0].maxIteration);
+	deepStale = true;
+}
+
+void drawDeep()
+{
+	glUseProgram(imageProgram.handle);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glUniform1i(imageProgram.uniforms["image"], 0);
+	drawQuad();
+	glBindTexture(GL_TEXTURE_2D, 0);
 	glUseProgram(0);
+}
+
+void render()
+{
+	// Past the deepest tiles only the progressive image has the precision
+	if(deepMode && tileMode && getTileLevel(deepView.scale, deepWidth) < maxTileLevel)
+		refineTiles();
+	else if(deepMode)
+		refineDeep();
+
+	// The last frame stays on screen while nothing changes
+	if(!redraw)
+		return;
+
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	if(deepMode)
+		drawDeep();
+	else
+	{
+		glUseProgram(program.handle);
+		drawFractal();
+		glUseProgram(0);
+	}
 
 	glfwSwapBuffers();
+	redraw = false;
 }
 
-int main()
+// Renders the view given on the command line on the CPU and writes it to a file
+int renderToFile(int argc, char *argv[])
 {
+	std::string filename;
+	int width = 640;
+	int height = 480;
+	MandelbrotView view;
+	bool deep = false;
+	bool iterationsGiven = false;
+	bool exact = false;
+	std::string centerX, centerY;
+	DeepView deepView;
+	FractalSettings settings;
+	bool specialized = false;
+	bool formulaGiven = false;
+	bool juliaGiven = false;
+	int bandRows = 0;
+	for(int i = 1; i < argc; ++i)
+	{
+		if(std::strcmp(argv[i], "--cpu") == 0 && i + 1 < argc)
+			filename = argv[++i];
+		else if(std::strcmp(argv[i], "--size") == 0 && i + 2 < argc)
+		{
+			width = std::atoi(argv[++i]);
+			height = std::atoi(argv[++i]);
+		}
+		else if(std::strcmp(argv[i], "--view") == 0 && i + 3 < argc)
+		{
+			view.zoom = float(std::atof(argv[++i]));
+			view.offset.x = float(std::atof(argv[++i]));
+			view.offset.y = float(std::atof(argv[++i]));
+		}
+		else if(std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+		{
+			view.maxIteration = std::atoi(argv[++i]);
+			iterationsGiven = true;
+		}
+		else if(std::strcmp(argv[i], "--exact") == 0)
+			exact = true;
+		else if(std::strcmp(argv[i], "--band") == 0 && i + 1 < argc)
+			bandRows = std::atoi(argv[++i]);
+		else if(std::strcmp(argv[i], "--fractal") == 0 && i + 1 < argc && parseFractalFormula(argv[i + 1], settings))
+		{
+			++i;
+			specialized = formulaGiven = true;
+		}
+		else if(std::strcmp(argv[i], "--julia") == 0 && i + 2 < argc)
+		{
+			settings.juliaX = std::atof(argv[++i]);
+			settings.juliaY = std::atof(argv[++i]);
+			juliaGiven = true;
+		}
+		else if(std::strcmp(argv[i], "--smooth") == 0)
+		{
+			settings.coloring = SmoothColoring;
+			specialized = true;
+		}
+		else if(std::strcmp(argv[i], "--precision") == 0 && i + 1 < argc)
+		{
+			std::string precision = argv[++i];
+			if(precision == "float")
+				settings.precision = FloatPrecision;
+			else if(precision == "double")
+				settings.precision = DoublePrecision;
+			else if(precision == "dd")
+				settings.precision = DoubleDoublePrecision;
+			else
+			{
+				filename.clear();
+				break;
+			}
+			specialized = true;
+		}
+		else if(std::strcmp(argv[i], "--center") == 0 && i + 2 < argc)
+		{
+			centerX = argv[++i];
+			centerY = argv[++i];
+			deep = true;
+		}
+		else if(std::strcmp(argv[i], "--scale") == 0 && i + 1 < argc)
+		{
+			deepView.scale = std::atof(argv[++i]);
+			if(deepView.scale > 0.0)
+				deepView.scale = std::max(deepView.scale, minDeepScale);
+			deep = true;
+		}
+		else
+		{
+			filename.clear();
+			break;
+		}
+	}
+	// --julia alone picks the Julia set, with another formula it is a mistake
+	if(juliaGiven)
+	{
+		if(formulaGiven && settings.formula != JuliaFormula)
+			filename.clear();
+		settings.formula = JuliaFormula;
+		specialized = true;
+	}
+	view.interiorChecks = view.subdivide = !exact;
+	deepView.interiorChecks = deepView.subdivide = !exact;
+	if(deep)
+	{
+		// The center is parsed last, its precision depends on the scale
+		deepView.maxIteration = iterationsGiven ? view.maxIteration : getDeepIterationLimit(deepView.scale);
+		view.maxIteration = deepView.maxIteration;
+		if(!(deepView.scale > 0.0) ||
+			(!centerX.empty() && (!BigFixed::parse(centerX, deepView.getPrecision(), deepView.x) ||
+			!BigFixed::parse(centerY, deepView.getPrecision(), deepView.y))))
+			filename.clear();
+	}
+	if(filename.empty() || width <= 0 || height <= 0 || view.maxIteration <= 0)
+	{
+		std::cerr<<"Usage: 06mandelbrot --cpu image.png|image.ppm [--size width height] [--view zoom x y] [--iterations n] [--exact]"<<std::endl;
+		std::cerr<<"       06mandelbrot --cpu image.png|image.ppm [--size width height] [--center x y] [--scale s] [--iterations n] [--exact]"<<std::endl;
+		std::cerr<<"       and for either [--fractal mandelbrot|multibrotN|julia|ship] [--julia x y] [--smooth] [--precision float|double|dd]"<<std::endl;
+		std::cerr<<"       [--band rows]"<<std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// The specialized kernels take a deep view for any view
+	if(specialized && !deep)
+	{
+		deepView = DeepView(view);
+		deepView.maxIteration = view.maxIteration;
+	}
+	std::vector<double> orbit;
+	if(deep && !specialized)
+		computeReferenceOrbit(deepView, orbit);
+	ColorKernel kernel = specialized ? getFractalColorKernel(settings, deepView, width, height) :
+		getCountColorKernel(deep ? getDeepKernel(deepView, orbit, width, height) :
+		getMandelbrotKernel(view, width, height), view.maxIteration);
+
+	// At most once a second, and for the last band
+	double pixels = double(width) * height;
+	double lastReport = 0.0;
+	ExportProgress done = { 0, height, 0, 0.0 };
+	auto report = [&](const ExportProgress &progress)
+	{
+		done = progress;
+		if(progress.seconds - lastReport < 1.0 && progress.rows < progress.height)
+			return;
+		lastReport = progress.seconds;
+		double fraction = double(progress.rows) / progress.height;
+		std::cout<<"\rRow "<<progress.rows<<" of "<<progress.height<<" ("<<int(fraction * 100.0)<<"%), "
+			<<fraction * pixels / progress.seconds * 1e-6<<" Mpixels/s, "
+			<<double(progress.iterations) / progress.seconds * 1e-6<<" Mpixel-iterations/s, "
+			<<int(progress.seconds / std::max(fraction, 1e-9) - progress.seconds)<<" s left   "<<std::flush;
+	};
+	if(!exportImage(filename, width, height, kernel, report, bandRows))
+	{
+		std::cerr<<std::endl<<"Failure writing "<<filename<<std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::cout<<std::endl<<"Computed "<<width<<"x"<<height<<" pixels, "<<done.iterations<<" iterations done, in "<<done.seconds
+		<<" seconds on "<<getWorkerCount()<<" threads: "<<pixels / done.seconds * 1e-6<<" Mpixels/s, "
+		<<double(done.iterations) / done.seconds * 1e-6<<" Mpixel-iterations/s"<<std::endl;
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+	if(argc > 1)
+		return renderToFile(argc, argv);
+
 	int width = 640;
 	int height = 480;
 
@@ -137,6 +705,8 @@ int main()
 
 	while(glfwGetWindowParam(GLFW_OPENED))
 	{
+		// The swap only polls the input when a frame is drawn, and a still view draws none
+		glfwPollEvents();
 		double time = glfwGetTime();
 		update(time);
 		render();
@@ -155,7 +725,10 @@ int main()
 
 	glDeleteShader(vsShader);
 	glDeleteShader(fsShader);
+	glDeleteShader(imageFsShader);
 	glDeleteProgram(program.handle);
+	glDeleteProgram(imageProgram.handle);
+	glDeleteTextures(1, &texture);
 	glDeleteBuffers(1, &vbo);
 	glDeleteBuffers(1, &vao);
 	glDeleteBuffers(1, &ibo);
@@ -0,0 +1,325 @@
+/* 
+OpenGL examples - Vertex layout
+
+Benchmarks planar vertex buffers, one block per attribute, against one interleaved
+buffer built with VertexBuilder (see common/vertexformat.h), on large meshes.
+Each mesh is drawn with the rasterizer discarded, so the time is spent fetching and
+transforming vertices, once in grid order and once with the vertices shuffled, where
+every fetch is a cache miss and locality matters most. The rate is of indices, the
+vertex fetches the draw makes, each vertex being shared by several triangles.
+*/
+
+#include "common/glutils.h"
+#include "common/globj.h"
+#include "common/vertexformat.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <unordered_map>
+using namespace glm;
+
+Program program;
+GLuint vsShader;
+GLuint fsShader;
+GLuint texture;
+
+mat4 model;
+mat4 view = translate(0.0f, 0.0f, -3.0f);
+mat4 projection = glm::perspective(45.0f, 640.0f / 480.0f, 0.1f, 10.0f);
+
+const int meshSizes[] = { 256, 1024, 2048 }; // quads along each side of the sphere grid
+const int drawRepeats = 20;
+
+struct Mesh
+{
+	std::vector<vec3> positions;
+	std::vector<vec3> normals;
+	std::vector<vec2> texels;
+	std::vector<GLuint> indices;
+};
+
+struct Buffers
+{
+	GLuint vao, vbo, ibo;
+	GLenum indexType;
+	GLsizei elementCount;
+};
+
+Buffers displayed;
+
+void initProgram()
+{
+	std::string vsSrc, fsSrc;
+	if(!readFile("data/diffuse.vs", vsSrc) ||
+		!readFile("data/diffuse.fs", fsSrc))
+		std::cerr<<"Failure reading shader data"<<std::endl;
+
+	vsShader = getShader(GL_VERTEX_SHADER, vsSrc);
+	fsShader = getShader(GL_FRAGMENT_SHADER, fsSrc);
+	program.handle = getProgram(vsShader, fsShader);
+
+	program.attribs["position"] = glGetAttribLocation(program.handle, "position");
+	program.attribs["normal"] = glGetAttribLocation(program.handle, "normal");
+	program.attribs["texel"] = glGetAttribLocation(program.handle, "texel");
+
+	program.uniforms["model"] = glGetUniformLocation(program.handle, "model");
+	program.uniforms["view"] = glGetUniformLocation(program.handle, "view");
+	program.uniforms["projection"] = glGetUniformLocation(program.handle, "projection");
+	program.uniforms["lightPos"] = glGetUniformLocation(program.handle, "lightPos");
+	program.uniforms["lightColor"] = glGetUniformLocation(program.handle, "lightColor");
+	program.uniforms["ambient"] = glGetUniformLocation(program.handle, "ambient");
+	program.uniforms["texBaseImage"] = glGetUniformLocation(program.handle, "texBaseImage");
+
+	GLubyte white[4] = { 255, 255, 255, 255 };
+	texture = createTexture2d(1, 1, white, GL_UNSIGNED_BYTE, GL_RGBA);
+}
+
+// A unit sphere as a grid of size by size quads, clockwise seen from outside
+void generateSphere(int size, Mesh &mesh)
+{
+	const float PI = 3.14159265f;
+	for(int j = 0; j <= size; ++j)
+	{
+		for(int i = 0; i <= size; ++i)
+		{
+			float u = float(i) / float(size);
+			float v = float(j) / float(size);
+			float theta = PI * v;
+			float phi = 2.0f * PI * u;
+			vec3 p(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+			mesh.positions.push_back(p);
+			mesh.normals.push_back(p);
+			mesh.texels.push_back(vec2(u, v));
+		}
+	}
+	for(int j = 0; j < size; ++j)
+	{
+		for(int i = 0; i < size; ++i)
+		{
+			GLuint a = GLuint(j * (size + 1) + i);
+			GLuint b = a + GLuint(size + 1);
+			GLuint quad[6] = { a, a + 1, b + 1, b + 1, b, a };
+			mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+		}
+	}
+}
+
+// Renumbers the vertices randomly, so consecutive triangles fetch from all over the buffer
+void shuffleVertices(Mesh &mesh)
+{
+	std::vector<GLuint> order(mesh.positions.size());
+	for(std::size_t i = 0; i < order.size(); ++i)
+		order[i] = GLuint(i);
+	std::shuffle(order.begin(), order.end(), std::mt19937(1));
+
+	Mesh shuffled;
+	shuffled.positions.resize(order.size());
+	shuffled.normals.resize(order.size());
+	shuffled.texels.resize(order.size());
+	for(std::size_t i = 0; i < order.size(); ++i)
+	{
+		shuffled.positions[order[i]] = mesh.positions[i];
+		shuffled.normals[order[i]] = mesh.normals[i];
+		shuffled.texels[order[i]] = mesh.texels[i];
+	}
+	shuffled.indices.resize(mesh.indices.size());
+	for(std::size_t i = 0; i < mesh.indices.size(); ++i)
+		shuffled.indices[i] = order[mesh.indices[i]];
+	std::swap(mesh, shuffled);
+}
+
+void createBuffers(Buffers &buffers, const Mesh &mesh)
+{
+	glGenVertexArrays(1, &buffers.vao);
+	glBindVertexArray(buffers.vao);
+	glGenBuffers(1, &buffers.vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, buffers.vbo);
+	glGenBuffers(1, &buffers.ibo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.ibo);
+	buffers.indexType = uploadIndices(mesh.indices, mesh.positions.size(), GL_STATIC_DRAW);
+	buffers.elementCount = GLsizei(mesh.indices.size());
+}
+
+// One block per attribute, the layout these examples used to upload
+void uploadPlanar(Buffers &buffers, const Mesh &mesh)
+{
+	createBuffers(buffers, mesh);
+	GLsizeiptr b0 = mesh.positions.size() * sizeof(vec3);
+	GLsizeiptr b1 = mesh.normals.size() * sizeof(vec3);
+	GLsizeiptr b2 = mesh.texels.size() * sizeof(vec2);
+	glBufferData(GL_ARRAY_BUFFER, b0 + b1 + b2, NULL, GL_STATIC_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0,			b0,	&mesh.positions[0]);
+	glBufferSubData(GL_ARRAY_BUFFER, b0,		b1,	&mesh.normals[0]);
+	glBufferSubData(GL_ARRAY_BUFFER, b0 + b1,	b2,	&mesh.texels[0]);
+
+	glEnableVertexAttribArray(program.getAttribLoc("position"));
+	glEnableVertexAttribArray(program.getAttribLoc("normal"));
+	glEnableVertexAttribArray(program.getAttribLoc("texel"));
+	glVertexAttribPointer(program.getAttribLoc("position"),	3,	GL_FLOAT, GL_FALSE, 0, (void*)(0));
+	glVertexAttribPointer(program.getAttribLoc("normal"),	3,	GL_FLOAT, GL_FALSE, 0, (void*)(b0));
+	glVertexAttribPointer(program.getAttribLoc("texel"),	2,	GL_FLOAT, GL_FALSE, 0, (void*)(b0 + b1));
+	glBindVertexArray(0);
+}
+
+void uploadInterleaved(Buffers &buffers, const Mesh &mesh)
+{
+	createBuffers(buffers, mesh);
+	VertexFormat format;
+	format.add("position", 3).add("normal", 3).add("texel", 2);
+	std::vector<unsigned char> vertices;
+	VertexBuilder(format).source("position", mesh.positions).source("normal", mesh.normals)
+		.source("texel", mesh.texels).build(mesh.positions.size(), vertices);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size(), &vertices[0], GL_STATIC_DRAW);
+	format.apply(program.attribs);
+	glBindVertexArray(0);
+}
+
+void destroyBuffers(Buffers &buffers)
+{
+	glDeleteBuffers(1, &buffers.vbo);
+	glDeleteBuffers(1, &buffers.ibo);
+	glDeleteVertexArrays(1, &buffers.vao);
+}
+
+double seconds(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Returns the milliseconds per draw, averaged over drawRepeats draws
+double timeDraws(const Buffers &buffers)
+{
+	glBindVertexArray(buffers.vao);
+	glDrawElements(GL_TRIANGLES, buffers.elementCount, buffers.indexType, 0); // warm up
+	glFinish();
+	auto start = std::chrono::steady_clock::now();
+	for(int r = 0; r < drawRepeats; ++r)
+		glDrawElements(GL_TRIANGLES, buffers.elementCount, buffers.indexType, 0);
+	glFinish();
+	glBindVertexArray(0);
+	return 1000.0 * seconds(start) / drawRepeats;
+}
+
+void runBenchmark()
+{
+	glUseProgram(program.handle);
+	glUniform(program.uniforms["model"], model);
+	glUniform(program.uniforms["view"], view);
+	glUniform(program.uniforms["projection"], projection);
+	glEnable(GL_RASTERIZER_DISCARD);
+
+	std::printf("%10s %10s %12s %12s %12s %12s\n", "vertices", "order", "layout", "upload ms", "draw ms", "Mindices/s");
+	for(int s = 0; s < int(sizeof(meshSizes) / sizeof(meshSizes[0])); ++s)
+	{
+		Mesh mesh;
+		generateSphere(meshSizes[s], mesh);
+		for(int shuffled = 0; shuffled < 2; ++shuffled)
+		{
+			if(shuffled)
+				shuffleVertices(mesh);
+			for(int interleaved = 0; interleaved < 2; ++interleaved)
+			{
+				Buffers buffers;
+				auto uploadStart = std::chrono::steady_clock::now();
+				if(interleaved)
+					uploadInterleaved(buffers, mesh);
+				else
+					uploadPlanar(buffers, mesh);
+				glFinish();
+				double uploadTime = 1000.0 * seconds(uploadStart);
+				double drawTime = timeDraws(buffers);
+				std::printf("%10d %10s %12s %12.1f %12.2f %12.1f\n", int(mesh.positions.size()),
+					shuffled ? "shuffled" : "grid", interleaved ? "interleaved" : "planar",
+					uploadTime, drawTime, mesh.indices.size() / drawTime / 1000.0);
+				destroyBuffers(buffers);
+			}
+		}
+	}
+
+	glDisable(GL_RASTERIZER_DISCARD);
+	glUseProgram(0);
+
+	// Keep the smallest mesh on screen
+	Mesh mesh;
+	generateSphere(meshSizes[0], mesh);
+	uploadInterleaved(displayed, mesh);
+}
+
+void render(double time)
+{
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	model = rotateY(float(time) * 0.5f);
+	glUseProgram(program.handle);
+	glUniform(program.uniforms["model"], model);
+	glUniform(program.uniforms["view"], view);
+	glUniform(program.uniforms["projection"], projection);
+	glUniform(program.uniforms["lightPos"], vec3(2.0f, 2.0f, 3.0f));
+	glUniform(program.uniforms["lightColor"], vec4(0.9f, 0.95f, 1.0f, 1.0f));
+	glUniform(program.uniforms["ambient"], vec4(0.2f, 0.2f, 0.38f, 1.0f));
+	glUniform(program.uniforms["texBaseImage"], 0);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glBindVertexArray(displayed.vao);
+	glDrawElements(GL_TRIANGLES, displayed.elementCount, displayed.indexType, 0);
+	glBindVertexArray(0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram(0);
+
+	glfwSwapBuffers();
+}
+
+int main()
+{
+	int width = 640;
+	int height = 480;
+
+	if(!initGL("Vertex layout", width, height, 3, 1, 24, 8, 4, false))
+		exit(EXIT_FAILURE);
+
+	initProgram();
+	runBenchmark();
+
+	glClearColor(0.55f, 0.59f, 0.95f, 1.0f);
+	glClearDepth(1.0f);
+
+	glEnable(GL_DEPTH_TEST);
+	glDepthMask(GL_TRUE);
+	glDepthFunc(GL_LEQUAL);
+	glDepthRange(0.0f, 1.0f);
+	glEnable(GL_CULL_FACE);
+	glFrontFace(GL_CW);
+	glCullFace(GL_BACK);
+
+	while(glfwGetWindowParam(GLFW_OPENED))
+	{
+		double time = glfwGetTime();
+		if(glfwGetKey(GLFW_KEY_ESC))
+			glfwCloseWindow();
+
+		render(time);
+
+		GLenum error = glGetError();
+		if(error != GL_NO_ERROR)
+		{
+			std::cerr<<getErrorMessage(error)<<std::endl;
+			std::cin.get();
+			glfwCloseWindow();
+		}
+		
+		// let cpu get some sleep
+		glfwSleep(0.013);
+	}
+
+	destroyBuffers(displayed);
+	glDeleteTextures(1, &texture);
+	glDeleteShader(vsShader);
+	glDeleteShader(fsShader);
+	glDeleteProgram(program.handle);
+	glfwTerminate();
+	return EXIT_SUCCESS;
+}
@@ -37,7 +37,7 @@ bool loadMesh(Mesh &mesh)
 {
 	std::vector<std::string> textureNames;
 	std::vector<GLfloat> vertices;
-	std::vector<GLushort> indices;
+	std::vector<GLuint> indices;
 	std::unordered_map<int, DrawCall> drawCalls;
 	int drawCallIndex = 0;
 
@@ -64,7 +64,7 @@ bool loadMesh(Mesh &mesh)
 			else if(prefix == "i")
 			{
 				int textureIndex;
-				GLushort vertexIndex;
+				GLuint vertexIndex;
 				ss>>textureIndex>>vertexIndex;
 				indices.push_back(vertexIndex);
 
@@ -77,7 +77,7 @@ bool loadMesh(Mesh &mesh)
 					DrawCall dc;
 					dc.mode = GL_TRIANGLES;
 					dc.count = 1;
-					dc.type = GL_UNSIGNED_SHORT;
+					dc.type = GL_UNSIGNED_INT;
 					dc.start = drawCallIndex;
 					drawCalls[textureIndex] = dc;
 				}
@@ -121,9 +121,25 @@ bool loadMesh(Mesh &mesh)
 	glBindBuffer(GL_ARRAY_BUFFER, vbo);
 	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), &vertices[0], GL_STATIC_DRAW);
 
+	// Keep 16 bit indices unless the model has too many vertices for them. This is
+	// uploadIndices of common/globj.h, copied since this example is still written
+	// against the old src/ headers rather than common/
+	std::size_t vertexCount = vertices.size() / 8;
+	GLenum indexType = vertexCount <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	for(std::unordered_map<int, DrawCall>::iterator i = drawCalls.begin(); i != drawCalls.end(); ++i)
+		i->second.type = indexType;
+
 	glGenBuffers(1, &ibo);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), &indices[0], GL_STATIC_DRAW);
+	if(indexType == GL_UNSIGNED_SHORT)
+	{
+		std::vector<GLushort> narrow(indices.begin(), indices.end());
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, narrow.size() * sizeof(GLushort), &narrow[0], GL_STATIC_DRAW);
+	}
+	else
+	{
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
+	}
 	
 	glBindVertexArray(0);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -161,7 +177,8 @@ void renderMesh(Mesh &mesh)
 		glBindTexture(GL_TEXTURE_2D, texture);
 
 		DrawCall dc = i->second;
-		glDrawElements(dc.mode, dc.count, dc.type, reinterpret_cast<const GLvoid*>(dc.start * sizeof(GLushort)));
+		std::size_t indexSize = dc.type == GL_UNSIGNED_INT ? sizeof(GLuint) : sizeof(GLushort);
+		glDrawElements(dc.mode, dc.count, dc.type, reinterpret_cast<const GLvoid*>(dc.start * indexSize));
 	}
 
 	glBindTexture(GL_TEXTURE_2D, 0);
@@ -0,0 +1,97 @@
+#include "bandexport.h"
+#include "imagefile.h"
+#include "parallel.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+ColorKernel getCountColorKernel(const CountKernel &kernel, int maxIteration)
+{
+	return [kernel, maxIteration](int x0, int y0, int x1, int y1, unsigned char *rgb, std::size_t stride)
+	{
+		int w = x1 - x0, h = y1 - y0;
+		std::vector<int> counts(std::size_t(w) * h);
+		std::uint64_t sum = kernel(x0, y0, x1, y1, &counts[0], w);
+		for(int y = 0; y < h; ++y)
+			colorMandelbrot(&counts[std::size_t(y) * w], w, maxIteration, rgb + y * stride);
+		return sum;
+	};
+}
+
+ColorKernel getFractalColorKernel(const FractalSettings &settings, const DeepView &view, int width, int height)
+{
+	FractalKernel kernel = getFractalKernel(settings);
+	if(!kernel)
+		return ColorKernel();
+	return [kernel, &settings, &view, width, height](int x0, int y0, int x1, int y1, unsigned char *rgb, std::size_t stride)
+	{
+		int w = x1 - x0, h = y1 - y0;
+		std::vector<float> values(std::size_t(w) * h);
+		std::uint64_t sum = kernel(settings, view, width, height, x0, y0, x1, y1, &values[0], w);
+		for(int y = 0; y < h; ++y)
+			colorFractal(&values[std::size_t(y) * w], w, view.maxIteration, rgb + y * stride);
+		return sum;
+	};
+}
+
+int getBandRows(int width)
+{
+	// Whole rows of tiles once the bands are that tall
+	int rows = std::max(1, (1 << 22) / std::max(width, 1));
+	return rows >= mandelbrotTileSize ? rows / mandelbrotTileSize * mandelbrotTileSize : rows;
+}
+
+bool exportImage(const std::string &filename, int width, int height, const ColorKernel &kernel,
+const ExportCallback &progress, int bandRows)
+{
+	ImageFileWriter writer;
+	if(width <= 0 || height <= 0 || !kernel || !writer.open(filename, width, height))
+		return false;
+	// Taller bands would bring back the memory the bands are there to save
+	if(bandRows <= 0)
+		bandRows = getBandRows(width);
+	bandRows = std::min(bandRows, maxBandFactor * getBandRows(width));
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	ExportProgress state = { 0, height, 0, 0.0 };
+	auto report = [&]()
+	{
+		state.rows = writer.getRowsWritten();
+		state.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if(progress)
+			progress(state);
+	};
+
+	// A band is computed into one buffer while the one before is written from the other
+	const std::size_t stride = std::size_t(width) * 3;
+	std::vector<unsigned char> bands[2];
+	std::thread writing;
+	for(int y0 = 0, band = 0; y0 < height; y0 += bandRows, band ^= 1)
+	{
+		int y1 = std::min(height, y0 + bandRows);
+		std::vector<unsigned char> &rgb = bands[band];
+		rgb.resize(stride * (y1 - y0));
+		state.iterations += parallelTiles(width, y0, y1, mandelbrotTileSize, [&](int tx0, int ty0, int tx1, int ty1)
+		{
+			return kernel(tx0, ty0, tx1, ty1, &rgb[std::size_t(ty0 - y0) * stride + std::size_t(tx0) * 3], stride);
+		});
+
+		// Stop at the first failed write, rather than compute the rest of a poster for nothing
+		if(writing.joinable())
+		{
+			writing.join();
+			report();
+		}
+		if(!writer.isGood())
+			break;
+		writing = std::thread([&writer, &rgb, y0, y1]()
+		{
+			writer.writeRows(&rgb[0], y1 - y0);
+		});
+	}
+	if(writing.joinable())
+		writing.join();
+	report();
+	return writer.close();
+}
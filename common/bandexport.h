@@ -0,0 +1,56 @@
+/*
+OpenGL examples - Band export
+
+Renders images far larger than memory, such as 65536 x 65536 posters of the views of
+the Mandelbrot example, and streams them to a file (see imagefile.h):
+	exportImage("poster.png", 65536, 65536, getCountColorKernel(kernel, maxIteration), report);
+The image is computed in bands of whole rows. Every band is cut into tiles that all the
+workers (see parallel.h) take in turn, and while one band is computed the one before it
+is written by a thread of its own, so the disk and the cores overlap. Only those two
+bands are ever in memory, whatever the size of the image. The progress is reported
+after every band, with the time and the iterations so far.
+*/
+
+#ifndef BAND_EXPORT_H
+#define BAND_EXPORT_H
+#include "fractal.h"
+#include "mandelbrot.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+
+/* writes the colours of the pixels [x0, x1) x [y0, y1) of the image to rgb, 3 bytes per pixel,
+	rows stride bytes apart. returns the iterations it took. called from the workers */
+typedef std::function<std::uint64_t(int x0, int y0, int x1, int y1, unsigned char *rgb, std::size_t stride)> ColorKernel;
+
+struct ExportProgress
+{
+	int rows; // written so far
+	int height;
+	std::uint64_t iterations;
+	double seconds;
+};
+
+typedef std::function<void(const ExportProgress &progress)> ExportCallback;
+
+/* colours the counts of the kernel (see mandelbrot.h and deepzoom.h) with colorMandelbrot */
+ColorKernel getCountColorKernel(const CountKernel &kernel, int maxIteration);
+
+/* colours the values of the kernel of the settings (see fractal.h) with colorFractal.
+	the settings and the view are referenced, not copied */
+ColorKernel getFractalColorKernel(const FractalSettings &settings, const DeepView &view, int width, int height);
+
+/* the rows per band for images width pixels wide, a few million pixels */
+int getBandRows(int width);
+
+/* how many times getBandRows a band can be */
+static const int maxBandFactor = 4;
+
+/* renders the width x height image band by band, bandRows rows each or getBandRows if 0, and at
+	most maxBandFactor times that, and writes it to a .png or .ppm file. progress, if any, is called
+	after every band.
+	return false if the file could not be written */
+bool exportImage(const std::string &filename, int width, int height, const ColorKernel &kernel,
+	const ExportCallback &progress = ExportCallback(), int bandRows = 0);
+
+#endif
@@ -0,0 +1,209 @@
+#include "bigfixed.h"
+#include <algorithm>
+#include <cmath>
+
+BigFixed::BigFixed() : negative(false), words(1, 0)
+{
+}
+
+BigFixed::BigFixed(double value, int precision) : negative(value < 0.0), words(std::max(0, precision) + 1, 0)
+{
+	double magnitude = std::abs(value);
+	for(std::size_t i = 0; i < words.size() && magnitude > 0.0; ++i)
+	{
+		double word = std::floor(magnitude);
+		words[i] = std::uint32_t(word);
+		magnitude = (magnitude - word) * 4294967296.0;
+	}
+}
+
+bool BigFixed::parse(const std::string &text, int precision, BigFixed &value)
+{
+	std::size_t i = 0;
+	bool negative = i < text.size() && (text[i] == '-' || text[i] == '+') && text[i++] == '-';
+	std::size_t point = text.find('.', i);
+	std::string integer = text.substr(i, point == std::string::npos ? std::string::npos : point - i);
+	std::string fraction = point == std::string::npos ? std::string() : text.substr(point + 1);
+	if(integer.empty() && fraction.empty())
+		return false;
+	if(integer.find_first_not_of("0123456789") != std::string::npos || fraction.find_first_not_of("0123456789") != std::string::npos)
+		return false;
+
+	// The fraction from its last digit, each step shifts it one place to the right
+	value = BigFixed(0.0, precision);
+	for(std::size_t d = fraction.size(); d > 0; --d)
+	{
+		value.words[0] = std::uint32_t(fraction[d - 1] - '0');
+		value.divideSmall(10);
+	}
+	std::uint32_t whole = 0;
+	for(std::size_t d = 0; d < integer.size(); ++d)
+		whole = whole * 10 + std::uint32_t(integer[d] - '0');
+	value.words[0] = whole;
+	value.negative = negative && !value.isZero();
+	return true;
+}
+
+std::string BigFixed::toString(int decimals) const
+{
+	std::string text = negative && !isZero() ? "-" : "";
+	text += std::to_string(words[0]);
+	if(decimals <= 0)
+		return text;
+
+	text += '.';
+	BigFixed fraction = *this;
+	for(int d = 0; d < decimals; ++d)
+	{
+		fraction.words[0] = 0;
+		fraction.multiplySmall(10);
+		text += char('0' + fraction.words[0]);
+	}
+	return text;
+}
+
+double BigFixed::toDouble() const
+{
+	// From the least significant word, so the rounding happens once at the end
+	double value = 0.0;
+	for(std::size_t i = words.size(); i > 0; --i)
+		value = value / 4294967296.0 + double(words[i - 1]);
+	return negative ? -value : value;
+}
+
+void BigFixed::setPrecision(int precision)
+{
+	words.resize(std::max(0, precision) + 1, 0);
+}
+
+BigFixed BigFixed::operator-() const
+{
+	BigFixed result = *this;
+	result.negative = !negative && !isZero();
+	return result;
+}
+
+BigFixed operator+(const BigFixed &a, const BigFixed &b)
+{
+	if(a.negative == b.negative)
+		return BigFixed::addMagnitudes(a, b, a.negative);
+	if(BigFixed::compareMagnitudes(a, b) >= 0)
+		return BigFixed::subtractMagnitudes(a, b, a.negative);
+	return BigFixed::subtractMagnitudes(b, a, b.negative);
+}
+
+BigFixed operator-(const BigFixed &a, const BigFixed &b)
+{
+	return a + -b;
+}
+
+BigFixed operator*(const BigFixed &a, const BigFixed &b)
+{
+	// Word k of the product sums the products of words i and j with i + j == k. Each row
+	// runs from the least significant word and passes its carries up
+	const std::size_t n = std::max(a.words.size(), b.words.size());
+	std::vector<std::uint32_t> product(a.words.size() + b.words.size(), 0);
+	for(std::size_t i = 0; i < a.words.size(); ++i)
+	{
+		if(a.words[i] == 0)
+			continue;
+		std::uint64_t carry = 0;
+		for(std::size_t j = b.words.size(); j > 0; --j)
+		{
+			std::uint64_t t = std::uint64_t(a.words[i]) * b.words[j - 1] + product[i + j - 1] + carry;
+			product[i + j - 1] = std::uint32_t(t);
+			carry = t >> 32;
+		}
+		for(std::size_t k = i; k > 0 && carry != 0; --k)
+		{
+			std::uint64_t t = std::uint64_t(product[k - 1]) + carry;
+			product[k - 1] = std::uint32_t(t);
+			carry = t >> 32;
+		}
+	}
+
+	BigFixed result;
+	result.words.assign(product.begin(), product.begin() + n);
+	result.negative = a.negative != b.negative && !result.isZero();
+	return result;
+}
+
+bool BigFixed::isZero() const
+{
+	for(std::size_t i = 0; i < words.size(); ++i)
+		if(words[i] != 0)
+			return false;
+	return true;
+}
+
+int BigFixed::compareMagnitudes(const BigFixed &a, const BigFixed &b)
+{
+	std::size_t n = std::max(a.words.size(), b.words.size());
+	for(std::size_t i = 0; i < n; ++i)
+	{
+		std::uint32_t x = i < a.words.size() ? a.words[i] : 0;
+		std::uint32_t y = i < b.words.size() ? b.words[i] : 0;
+		if(x != y)
+			return x < y ? -1 : 1;
+	}
+	return 0;
+}
+
+BigFixed BigFixed::addMagnitudes(const BigFixed &a, const BigFixed &b, bool negative)
+{
+	BigFixed result;
+	result.words.assign(std::max(a.words.size(), b.words.size()), 0);
+	std::uint64_t carry = 0;
+	for(std::size_t i = result.words.size(); i > 0; --i)
+	{
+		std::uint64_t t = carry;
+		t += i - 1 < a.words.size() ? a.words[i - 1] : 0;
+		t += i - 1 < b.words.size() ? b.words[i - 1] : 0;
+		result.words[i - 1] = std::uint32_t(t);
+		carry = t >> 32;
+	}
+	result.negative = negative && !result.isZero();
+	return result;
+}
+
+// |a| - |b|, with |a| >= |b|
+BigFixed BigFixed::subtractMagnitudes(const BigFixed &a, const BigFixed &b, bool negative)
+{
+	BigFixed result;
+	result.words.assign(std::max(a.words.size(), b.words.size()), 0);
+	std::int64_t borrow = 0;
+	for(std::size_t i = result.words.size(); i > 0; --i)
+	{
+		std::int64_t t = -borrow;
+		t += i - 1 < a.words.size() ? std::int64_t(a.words[i - 1]) : 0;
+		t -= i - 1 < b.words.size() ? std::int64_t(b.words[i - 1]) : 0;
+		borrow = t < 0 ? 1 : 0;
+		result.words[i - 1] = std::uint32_t(t + (borrow << 32));
+	}
+	result.negative = negative && !result.isZero();
+	return result;
+}
+
+// Multiplies the magnitude, returns what overflows the integer part
+std::uint32_t BigFixed::multiplySmall(std::uint32_t factor)
+{
+	std::uint64_t carry = 0;
+	for(std::size_t i = words.size(); i > 0; --i)
+	{
+		std::uint64_t t = std::uint64_t(words[i - 1]) * factor + carry;
+		words[i - 1] = std::uint32_t(t);
+		carry = t >> 32;
+	}
+	return std::uint32_t(carry);
+}
+
+void BigFixed::divideSmall(std::uint32_t divisor)
+{
+	std::uint64_t remainder = 0;
+	for(std::size_t i = 0; i < words.size(); ++i)
+	{
+		std::uint64_t t = (remainder << 32) | words[i];
+		words[i] = std::uint32_t(t / divisor);
+		remainder = t % divisor;
+	}
+}
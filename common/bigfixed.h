@@ -0,0 +1,56 @@
+/*
+OpenGL examples - Fixed point numbers
+
+Signed fixed point numbers with a 32 bit integer part and any number of 32 bit words of
+fraction, for the few values of a deep zoom (see deepzoom.h) that need more precision
+than a double. The precision is given in words of fraction when a number is made, and
+the result of + - or * takes the larger precision of its operands. Products are
+truncated and the integer part wraps around, which is fine for values that stay small
+like the orbits of the Mandelbrot set.
+*/
+
+#ifndef BIG_FIXED_H
+#define BIG_FIXED_H
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class BigFixed
+{
+public:
+	BigFixed();
+
+	/* the double exactly, if the precision holds its bits and |value| < 2^32 */
+	BigFixed(double value, int precision);
+
+	/* reads a decimal number such as -0.743643887037158704752191506114774.
+		return false if the text is not a number */
+	static bool parse(const std::string &text, int precision, BigFixed &value);
+
+	/* the decimal digits of the number, rounded down to the given number of decimals */
+	std::string toString(int decimals) const;
+
+	double toDouble() const;
+	int getPrecision() const { return int(words.size()) - 1; }
+
+	/* truncates or extends the fraction to the given number of words */
+	void setPrecision(int precision);
+
+	BigFixed operator-() const;
+	friend BigFixed operator+(const BigFixed &a, const BigFixed &b);
+	friend BigFixed operator-(const BigFixed &a, const BigFixed &b);
+	friend BigFixed operator*(const BigFixed &a, const BigFixed &b);
+
+private:
+	bool isZero() const;
+	static int compareMagnitudes(const BigFixed &a, const BigFixed &b);
+	static BigFixed addMagnitudes(const BigFixed &a, const BigFixed &b, bool negative);
+	static BigFixed subtractMagnitudes(const BigFixed &a, const BigFixed &b, bool negative);
+	std::uint32_t multiplySmall(std::uint32_t factor);
+	void divideSmall(std::uint32_t divisor);
+
+	bool negative;
+	std::vector<std::uint32_t> words; // the integer part, then the fraction from its most significant word
+};
+
+#endif
@@ -0,0 +1,218 @@
+#include "brickmesh.h"
+#include "parallel.h"
+#include <algorithm>
+using namespace glm;
+
+// Room left in a range for the brick to grow before it has to move
+static GLuint withSlack(std::size_t count)
+{
+	return count == 0 ? 0 : GLuint(count + count / 2 + 6);
+}
+
+BrickMesh::BrickMesh() : vbo(0), ibo(0), vertexCapacity(0), indexCapacity(0), vertexEnd(0), indexEnd(0)
+{
+	format = getPackedVertexFormat(vec3(-1.0f), vec3(1.0f), true, false, false, Directions8);
+}
+
+void BrickMesh::build(const SurfaceField &field, int resolution, float min, float max)
+{
+	sampleGridCulled(grid, field, resolution, min, max, 0.0f);
+	format = getPackedVertexFormat(vec3(min), vec3(max), true, false, false, Directions8);
+	bricks.assign(grid.brickCount(), Brick());
+	std::vector<int> all(grid.brickCount());
+	for(int i = 0; i < grid.brickCount(); ++i)
+		all[i] = i;
+	polygonizeBricks(field, all);
+	reallocate();
+}
+
+int BrickMesh::update(const SurfaceField &field, const vec3 &boxMin, const vec3 &boxMax)
+{
+	std::vector<int> changed;
+	resampleRegion(grid, field, boxMin, boxMax, changed);
+
+	// The cells of a brick reach one sample into the bricks after it,
+	// so a changed brick also dirties the bricks before it
+	std::vector<int> dirty;
+	int nb = grid.bricksPerAxis();
+	for(std::size_t i = 0; i < changed.size(); ++i)
+	{
+		int bx = changed[i] / (nb * nb);
+		int by = (changed[i] / nb) % nb;
+		int bz = changed[i] % nb;
+		for(int c = 0; c < 8; ++c)
+		{
+			int x = bx - (c & 1);
+			int y = by - ((c >> 1) & 1);
+			int z = bz - ((c >> 2) & 1);
+			if(x >= 0 && y >= 0 && z >= 0)
+				dirty.push_back(grid.brickIndex(x, y, z));
+		}
+	}
+	std::sort(dirty.begin(), dirty.end());
+	dirty.erase(std::unique(dirty.begin(), dirty.end()), dirty.end());
+	if(dirty.empty())
+		return 0;
+
+	polygonizeBricks(field, dirty);
+	bool fits = true;
+	for(std::size_t i = 0; i < dirty.size() && fits; ++i)
+		fits = allocate(bricks[dirty[i]]);
+
+	if(!fits)
+	{
+		reallocate();
+	}
+	else
+	{
+		for(std::size_t i = 0; i < dirty.size(); ++i)
+			upload(bricks[dirty[i]]);
+	}
+	return int(dirty.size());
+}
+
+void BrickMesh::polygonizeBricks(const SurfaceField &field, const std::vector<int> &dirty)
+{
+	parallelFor(int(dirty.size()), [&](int i)
+	{
+		Brick &brick = bricks[dirty[i]];
+		std::vector<vec3> positions;
+		std::vector<vec3> normals;
+		polygonizeMarchingCubesBrick(grid, dirty[i], positions, brick.indices);
+		computeFieldNormals(field, 0.5f * grid.blockSize(), positions, normals);
+		brick.vertices.resize(positions.size() * 2);
+		for(std::size_t j = 0; j < positions.size(); ++j)
+		{
+			brick.vertices[2 * j + 0] = positions[j];
+			brick.vertices[2 * j + 1] = normals[j];
+		}
+	});
+}
+
+// Keeps the ranges of the brick if the new mesh fits, otherwise moves it to the end of the
+// buffers, leaving degenerate triangles behind. Returns false if the buffers are full.
+bool BrickMesh::allocate(Brick &brick)
+{
+	GLuint vertexCount = brick.vertices.size() / 2;
+	GLuint indexCount = brick.indices.size();
+	if(vertexCount <= brick.vertexCapacity && indexCount <= brick.indexCapacity)
+		return true;
+
+	GLuint newVertexCapacity = withSlack(vertexCount);
+	GLuint newIndexCapacity = withSlack(indexCount) / 3 * 3;
+	if(vertexEnd + newVertexCapacity > vertexCapacity || indexEnd + newIndexCapacity > indexCapacity)
+		return false;
+
+	if(brick.indexCapacity > 0)
+	{
+		std::vector<GLuint> degenerate(brick.indexCapacity, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, brick.indexStart * sizeof(GLuint), degenerate.size() * sizeof(GLuint), &degenerate[0]);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+
+	brick.vertexStart = vertexEnd;
+	brick.vertexCapacity = newVertexCapacity;
+	brick.indexStart = indexEnd;
+	brick.indexCapacity = newIndexCapacity;
+	vertexEnd += newVertexCapacity;
+	indexEnd += newIndexCapacity;
+	return true;
+}
+
+void BrickMesh::upload(const Brick &brick)
+{
+	if(brick.indexCapacity == 0)
+		return;
+
+	if(!brick.vertices.empty())
+	{
+		std::vector<unsigned char> packed(brick.vertices.size() / 2 * format.stride);
+		for(std::size_t i = 0; i < brick.vertices.size() / 2; ++i)
+			packVertex(format, brick.vertices[2 * i], brick.vertices[2 * i + 1], vec4(0.0f), vec2(0.0f), &packed[i * format.stride]);
+		glBindBuffer(GL_ARRAY_BUFFER, vbo);
+		glBufferSubData(GL_ARRAY_BUFFER, brick.vertexStart * format.stride, packed.size(), &packed[0]);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	// Pad the range with degenerate triangles
+	std::vector<GLuint> indices(brick.indexCapacity, 0);
+	for(std::size_t i = 0; i < brick.indices.size(); ++i)
+		indices[i] = brick.vertexStart + brick.indices[i];
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, brick.indexStart * sizeof(GLuint), indices.size() * sizeof(GLuint), &indices[0]);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+// Packs every brick from the start of new buffers, which get room to grow as well
+void BrickMesh::reallocate()
+{
+	vertexEnd = 0;
+	indexEnd = 0;
+	for(std::size_t i = 0; i < bricks.size(); ++i)
+	{
+		Brick &brick = bricks[i];
+		brick.vertexStart = vertexEnd;
+		brick.vertexCapacity = withSlack(brick.vertices.size() / 2);
+		brick.indexStart = indexEnd;
+		brick.indexCapacity = withSlack(brick.indices.size()) / 3 * 3;
+		vertexEnd += brick.vertexCapacity;
+		indexEnd += brick.indexCapacity;
+	}
+	vertexCapacity = withSlack(vertexEnd);
+	indexCapacity = withSlack(indexEnd) / 3 * 3;
+
+	if(vbo == 0)
+		glGenBuffers(1, &vbo);
+	if(ibo == 0)
+		glGenBuffers(1, &ibo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, vertexCapacity * format.stride, NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// Whatever lies past the last brick is never drawn, but the gaps between them are
+	std::vector<GLuint> degenerate(indexCapacity, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCapacity * sizeof(GLuint), degenerate.empty() ? NULL : &degenerate[0], GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	for(std::size_t i = 0; i < bricks.size(); ++i)
+		upload(bricks[i]);
+}
+
+void BrickMesh::setVertexFormat(GLint positionAttrib, GLint normalAttrib)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	format.apply(positionAttrib, normalAttrib);
+}
+
+void BrickMesh::draw() const
+{
+	glDrawElements(GL_TRIANGLES, indexEnd, GL_UNSIGNED_INT, 0);
+}
+
+void BrickMesh::destroy()
+{
+	glDeleteBuffers(1, &vbo);
+	glDeleteBuffers(1, &ibo);
+	vbo = 0;
+	ibo = 0;
+	bricks.clear();
+}
+
+std::size_t BrickMesh::getVertexCount() const
+{
+	std::size_t count = 0;
+	for(std::size_t i = 0; i < bricks.size(); ++i)
+		count += bricks[i].vertices.size() / 2;
+	return count;
+}
+
+std::size_t BrickMesh::getTriangleCount() const
+{
+	std::size_t count = 0;
+	for(std::size_t i = 0; i < bricks.size(); ++i)
+		count += bricks[i].indices.size() / 3;
+	return count;
+}
@@ -0,0 +1,76 @@
+/*
+OpenGL examples - Brick mesh
+
+An isosurface kept as one marching cubes mesh per brick of a SampleGrid (see isosurface.h),
+for fields that are edited or animated locally.
+	update(field, boxMin, boxMax)
+resamples only the bricks around the changed box, polygonizes again only the bricks whose
+samples changed, and uploads only those with glBufferSubData.
+
+Each brick owns a range of the vertex buffer and a range of the index buffer, allocated with
+some slack. The unused part of an index range holds degenerate triangles, so the whole mesh
+is still drawn with a single glDrawElements. A brick that outgrows its ranges moves to the end
+of the buffers, and when the buffers are full they are reallocated and every brick is uploaded
+again. The vertices are packed positions and normals (see vertexpack.h), quantized to the
+box of the grid, and decoded with the uniforms set by getVertexFormat().setPositionUniforms.
+build and update bind buffers, so they must not be called while a vertex array object is bound.
+*/
+
+#ifndef BRICK_MESH_H
+#define BRICK_MESH_H
+#include "isosurface.h"
+#include "vertexpack.h"
+#include <vector>
+
+class BrickMesh
+{
+public:
+	BrickMesh();
+
+	/* samples the field, culling empty space, and builds and uploads every brick */
+	void build(const SurfaceField &field, int resolution, float min, float max);
+
+	/* resamples the bricks around the box [boxMin, boxMax], which must contain every point
+		where the field changed, and rebuilds the bricks that use a changed sample.
+		returns the number of rebuilt bricks */
+	int update(const SurfaceField &field, const glm::vec3 &boxMin, const glm::vec3 &boxMax);
+
+	/* binds the buffers and specifies the vertex format of the currently bound vertex array object */
+	void setVertexFormat(GLint positionAttrib, GLint normalAttrib);
+
+	/* draws the mesh, the vertex array object set up by setVertexFormat must be bound */
+	void draw() const;
+
+	void destroy();
+
+	std::size_t getVertexCount() const;
+	std::size_t getTriangleCount() const;
+	const PackedVertexFormat &getVertexFormat() const { return format; }
+private:
+	struct Brick
+	{
+		std::vector<glm::vec3> vertices; // position, normal, position, normal...
+		std::vector<GLuint> indices; // relative to the first vertex of the brick
+		GLuint vertexStart;
+		GLuint vertexCapacity;
+		GLuint indexStart;
+		GLuint indexCapacity;
+	};
+
+	void polygonizeBricks(const SurfaceField &field, const std::vector<int> &dirty);
+	bool allocate(Brick &brick);
+	void upload(const Brick &brick);
+	void reallocate();
+
+	SampleGrid grid;
+	std::vector<Brick> bricks;
+	PackedVertexFormat format;
+	GLuint vbo;
+	GLuint ibo;
+	GLuint vertexCapacity;
+	GLuint indexCapacity;
+	GLuint vertexEnd;
+	GLuint indexEnd;
+};
+
+#endif
@@ -1,15 +1,18 @@
-#include "common/glutils.h"
+#include "camera.h"
 using namespace glm;
 
+static const float PI = 3.1415926535f;
+static const float TWO_PI = 6.2831853071f;
+
 Camera::Camera() : theta(0), phi(0), position(0, 0, -1)
 {
 	updateVectors();
 }
 
-void Camera::rotateLeft(float t) { theta -= t; if(t < 0.0f) t += TWO_PI; }
-void Camera::rotateRight(float t) { theta += t; if(t > TWO_PI) t -= TWO_PI; }
-void Camera::rotateUp(float t) { if(phi < PI) phi += t; }
-void Camera::rotateDown(float t) { if(phi > -PI) phi -= t; }
+void Camera::rotateLeft(float t) { theta -= t; if(theta < 0.0f) theta += TWO_PI; }
+void Camera::rotateRight(float t) { theta += t; if(theta > TWO_PI) theta -= TWO_PI; }
+void Camera::rotateUp(float t) { phi = std::min(phi + t, 0.5f * PI - 0.001f); }
+void Camera::rotateDown(float t) { phi = std::max(phi - t, -0.5f * PI + 0.001f); }
 
 void Camera::setHorizontalAngle(float t) { theta = mod(t, TWO_PI); }
 void Camera::setVerticalAngle(float t) { phi = mod(abs(t), PI) * (t < 0 ? -1 : 1); }
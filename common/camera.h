@@ -14,7 +14,7 @@ determined by the horizontal and vertical angles, theta and phi.
 
 #ifndef CAMERA_H
 #define CAMERA_H
-#include "common/glutils.h"
+#include "glutils.h"
 
 class Camera
 {
@@ -30,6 +30,9 @@ public:
 	void setVerticalAngle(float t);
 	void setPosition(const glm::vec3 &p);
 
+	const glm::vec3 &getPosition() const { return position; }
+	const glm::vec3 &getForward() const { return forward; }
+
 	void updateVectors();
 
 	glm::mat4 getViewMatrix();
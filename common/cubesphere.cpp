@@ -0,0 +1,76 @@
+#include "cubesphere.h"
+#include <cstdint>
+#include <unordered_map>
+using namespace glm;
+
+const CubeFace cubeFaces[6] =
+{
+	{ vec3( 1.0f,  0.0f,  0.0f), vec3( 0.0f,  1.0f,  0.0f), vec3( 0.0f,  0.0f,  1.0f) },
+	{ vec3(-1.0f,  0.0f,  0.0f), vec3( 0.0f,  0.0f,  1.0f), vec3( 0.0f,  1.0f,  0.0f) },
+	{ vec3( 0.0f,  1.0f,  0.0f), vec3( 0.0f,  0.0f,  1.0f), vec3( 1.0f,  0.0f,  0.0f) },
+	{ vec3( 0.0f, -1.0f,  0.0f), vec3( 1.0f,  0.0f,  0.0f), vec3( 0.0f,  0.0f,  1.0f) },
+	{ vec3( 0.0f,  0.0f,  1.0f), vec3( 1.0f,  0.0f,  0.0f), vec3( 0.0f,  1.0f,  0.0f) },
+	{ vec3( 0.0f,  0.0f, -1.0f), vec3( 0.0f,  1.0f,  0.0f), vec3( 1.0f,  0.0f,  0.0f) }
+};
+
+std::size_t getCubeSphereVertexCount(int subdivisions, bool weld)
+{
+	std::size_t n = std::size_t(subdivisions);
+	return weld ? 6 * n * n + 2 : 6 * (n + 1) * (n + 1);
+}
+
+void generateCubeSphere(float radius, int subdivisions, bool weld,
+std::vector<vec3> &positions, std::vector<vec3> &normals, std::vector<GLuint> &indices)
+{
+	const int n = subdivisions;
+	positions.reserve(positions.size() + getCubeSphereVertexCount(n, weld));
+	normals.reserve(normals.size() + getCubeSphereVertexCount(n, weld));
+	indices.reserve(indices.size() + 36 * std::size_t(n) * n);
+
+	// Edge vertices are found by their point on the cube, in integer steps of 1 / n,
+	// so the faces meeting at an edge agree on them exactly
+	std::unordered_map<uint64_t, GLuint> edgeVertices;
+	std::vector<GLuint> face((n + 1) * (n + 1));
+	for(int f = 0; f < 6; ++f)
+	{
+		const CubeFace &c = cubeFaces[f];
+		for(int j = 0; j <= n; ++j)
+		{
+			for(int i = 0; i <= n; ++i)
+			{
+				vec3 p = c.center * float(n) + c.u * float(2 * i - n) + c.v * float(2 * j - n);
+				bool edge = i == 0 || i == n || j == 0 || j == n;
+				if(weld && edge)
+				{
+					uint64_t size = uint64_t(2 * n + 1);
+					uint64_t key = (uint64_t(p.x + float(n)) * size + uint64_t(p.y + float(n))) * size + uint64_t(p.z + float(n));
+					std::unordered_map<uint64_t, GLuint>::iterator found = edgeVertices.find(key);
+					if(found != edgeVertices.end())
+					{
+						face[j * (n + 1) + i] = found->second;
+						continue;
+					}
+					edgeVertices[key] = GLuint(positions.size());
+				}
+
+				face[j * (n + 1) + i] = GLuint(positions.size());
+				vec3 normal = normalize(p);
+				positions.push_back(normal * radius);
+				normals.push_back(normal);
+			}
+		}
+
+		for(int j = 0; j < n; ++j)
+		{
+			for(int i = 0; i < n; ++i)
+			{
+				GLuint a = face[j * (n + 1) + i];
+				GLuint b = face[j * (n + 1) + i + 1];
+				GLuint c = face[(j + 1) * (n + 1) + i + 1];
+				GLuint d = face[(j + 1) * (n + 1) + i];
+				GLuint quad[6] = { a, d, c, c, b, a };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+	}
+}
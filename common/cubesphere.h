@@ -0,0 +1,36 @@
+/*
+OpenGL examples - Cube sphere
+
+A sphere made by projecting the surface of a subdivided cube onto it
+(http://www.iquilezles.org/www/articles/patchedsphere/patchedsphere.htm).
+Each of the six faces is a grid of subdivisions x subdivisions quads whose vertices
+are shared by the quads around them, and the normal of every vertex is simply its
+direction from the center. Unwelded, every face has its own row of vertices along
+each edge, 6 (n + 1)^2 in all, which keeps the faces independent for texturing or
+culling. Welded, the faces share their edges, 6 n^2 + 2 vertices in all.
+*/
+
+#ifndef CUBE_SPHERE_H
+#define CUBE_SPHERE_H
+#include "glutils.h"
+#include <vector>
+
+/* the six faces of the cube, each spanned by center + s * u + t * v for s and t in [-1, 1].
+	cross(u, v) == center, so a quad (s, t), (s, t + dt), (s + ds, t + dt), (s + ds, t) is
+	clockwise seen from outside */
+struct CubeFace
+{
+	glm::vec3 center;
+	glm::vec3 u;
+	glm::vec3 v;
+};
+extern const CubeFace cubeFaces[6];
+
+/* returns the number of vertices generateCubeSphere emits */
+std::size_t getCubeSphereVertexCount(int subdivisions, bool weld);
+
+/* appends a sphere of clockwise triangles, seen from outside */
+void generateCubeSphere(float radius, int subdivisions, bool weld,
+	std::vector<glm::vec3> &positions, std::vector<glm::vec3> &normals, std::vector<GLuint> &indices);
+
+#endif
@@ -0,0 +1,223 @@
+#include "deepzoom.h"
+#include "parallel.h"
+#include "simd.h"
+#include <algorithm>
+#include <cmath>
+using namespace glm;
+
+// The size of the view at scale 1 and its center, as in data/fractal.fs
+static const double viewWidth = 3.5;
+static const double viewHeight = 2.0;
+static const double centerX = -0.75;
+
+DeepView::DeepView() : scale(1.0), maxIteration(128), interiorChecks(true), subdivide(true)
+{
+	x = BigFixed(centerX, getPrecision());
+	y = BigFixed(0.0, getPrecision());
+}
+
+DeepView::DeepView(const MandelbrotView &view) :
+	scale(1.0 - view.zoom), maxIteration(view.maxIteration), interiorChecks(view.interiorChecks), subdivide(view.subdivide)
+{
+	x = BigFixed(centerX * scale + view.offset.x, getPrecision());
+	y = BigFixed(view.offset.y, getPrecision());
+}
+
+// The bits below the point of a scale, kept finite for scales of 0 or less
+static double getScaleBits(double scale)
+{
+	return -std::log2(scale > minDeepScale ? std::min(scale, 1.0) : minDeepScale);
+}
+
+int DeepView::getPrecision() const
+{
+	// The bits of the scale and a double's worth for the pixels and the orbit
+	int bits = int(std::ceil(getScaleBits(scale))) + 64;
+	return (bits + 31) / 32;
+}
+
+void DeepView::pan(double dx, double dy)
+{
+	int precision = getPrecision();
+	x = x + BigFixed(dx * viewWidth * scale, precision);
+	y = y + BigFixed(dy * viewHeight * scale, precision);
+	x.setPrecision(std::max(precision, x.getPrecision()));
+	y.setPrecision(std::max(precision, y.getPrecision()));
+}
+
+int getDeepIterationLimit(double scale)
+{
+	return 128 + int(32.0 * getScaleBits(scale));
+}
+
+void computeReferenceOrbit(const DeepView &view, std::vector<double> &orbit)
+{
+	int precision = view.getPrecision();
+	BigFixed cx = view.x, cy = view.y;
+	cx.setPrecision(precision);
+	cy.setPrecision(precision);
+
+	orbit.assign(2, 0.0);
+	BigFixed zx(0.0, precision), zy(0.0, precision);
+	for(int i = 0; i < view.maxIteration; ++i)
+	{
+		BigFixed xy = zx * zy;
+		zx = zx * zx - zy * zy + cx;
+		zy = xy + xy + cy;
+		double x = zx.toDouble(), y = zy.toDouble();
+		orbit.push_back(x);
+		orbit.push_back(y);
+		if(x * x + y * y >= 4.0)
+			break;
+	}
+}
+
+std::uint64_t iterateDeep(const DeepView &view, const std::vector<double> &orbit,
+int width, int height, int x0, int y0, int x1, int y1, int *counts, int stride)
+{
+	const int w = doublev::width;
+	const int last = int(orbit.size()) / 2 - 1;
+	const doublev two(2.0), four(4.0), one(1.0);
+	const doublev maxCount(double(view.maxIteration));
+	double dcx[w], dcy[w], refX[w], refY[w], rebased[w], n[w], done[w];
+	int index[w], offsets[w];
+
+	// The interior checks need c and z themselves, which doubles only hold well enough down
+	// to this scale. Orbits closer than a thousandth of a pixel to an earlier point are periodic
+	const double centerX = view.x.toDouble(), centerY = view.y.toDouble();
+	const bool interiorChecks = view.interiorChecks && view.scale > 1e-10;
+	const double cycleDistance = 1e-3 * viewWidth * view.scale / double(width);
+	const doublev cycleDistance2(cycleDistance * cycleDistance);
+
+	// The lanes take the pixels in row order and wrap, as in iterateMandelbrot
+	const int columns = x1 - x0;
+	const int pixels = columns * (y1 - y0);
+	std::uint64_t sum = 0;
+	for(int p = 0; p < pixels; p += w)
+	{
+		for(int lane = 0; lane < w; ++lane)
+		{
+			int q = std::min(p + lane, pixels - 1);
+			int x = x0 + q % columns, y = y0 + q / columns;
+			dcx[lane] = ((double(x) + 0.5) / double(width) - 0.5) * viewWidth * view.scale;
+			dcy[lane] = (0.5 - (double(y) + 0.5) / double(height)) * viewHeight * view.scale;
+			offsets[lane] = (y - y0) * stride + (x - x0);
+			index[lane] = 0;
+		}
+
+		// Z is the reference at the index of each lane. Until a lane rebases they all share
+		// the same index, and none can reach the end of the reference before steps run out
+		doublev dzx(0.0), dzy(0.0), zx(0.0), zy(0.0), count(0.0), iterated(0.0), stopped(0.0);
+		doublev dc = doublev::load(dcx), dci = doublev::load(dcy);
+		doublev active = doublev(0.0) < one; // every lane
+		if(interiorChecks)
+		{
+			stopped = isInsideBulbs(doublev(centerX) + dc, doublev(centerY) + dci);
+			count = select(stopped, maxCount, count);
+			active = andNot(stopped, active);
+		}
+
+		doublev savedX(0.0), savedY(0.0);
+		int checkpoint = 1;
+		int steps = last;
+		for(int i = 0; i < view.maxIteration; ++i)
+		{
+			doublev tx = two * zx + dzx, ty = two * zy + dzy;
+			doublev dx = tx * dzx - ty * dzy + dc;
+			dzy = tx * dzy + ty * dzx + dci;
+			dzx = dx;
+
+			for(int lane = 0; lane < w; ++lane)
+			{
+				const double *z = &orbit[2 * ++index[lane]];
+				refX[lane] = z[0];
+				refY[lane] = z[1];
+			}
+			zx = doublev::load(refX);
+			zy = doublev::load(refY);
+
+			doublev px = zx + dzx, py = zy + dzy;
+			doublev r2 = px * px + py * py;
+			count = count + (active & one);
+			active = active & (r2 < four);
+			if(!any(active))
+				break;
+
+			if(interiorChecks)
+			{
+				doublev ex = px - savedX, ey = py - savedY;
+				doublev periodic = active & (ex * ex + ey * ey < cycleDistance2);
+				if(any(periodic))
+				{
+					iterated = select(periodic, count, iterated);
+					stopped = stopped | periodic;
+					count = select(periodic, maxCount, count);
+					active = andNot(periodic, active);
+				}
+				if(i + 1 == checkpoint)
+				{
+					savedX = px;
+					savedY = py;
+					checkpoint *= 2;
+				}
+			}
+
+			int rebase = maskBits(r2 < dzx * dzx + dzy * dzy);
+			if(--steps > 0 && rebase == 0)
+				continue;
+
+			steps = last;
+			for(int lane = 0; lane < w; ++lane)
+			{
+				bool b = (rebase >> lane & 1) != 0 || index[lane] == last;
+				index[lane] = b ? 0 : index[lane];
+				rebased[lane] = b ? 1.0 : 0.0;
+				steps = std::min(steps, last - index[lane]);
+			}
+			doublev mask = doublev::load(rebased) > doublev(0.5);
+			dzx = select(mask, px, dzx);
+			dzy = select(mask, py, dzy);
+			zx = andNot(mask, zx);
+			zy = andNot(mask, zy);
+		}
+
+		count.store(n);
+		select(stopped, iterated, count).store(done);
+		for(int lane = 0; lane < w && p + lane < pixels; ++lane)
+		{
+			counts[offsets[lane]] = int(n[lane]);
+			sum += std::uint64_t(done[lane]);
+		}
+	}
+	return sum;
+}
+
+CountKernel getDeepKernel(const DeepView &view, const std::vector<double> &orbit, int width, int height)
+{
+	CountKernel kernel = [&view, &orbit, width, height](int x0, int y0, int x1, int y1, int *counts, int stride)
+	{
+		return iterateDeep(view, orbit, width, height, x0, y0, x1, y1, counts, stride);
+	};
+	if(!view.subdivide)
+		return kernel;
+	return [kernel](int x0, int y0, int x1, int y1, int *counts, int stride)
+	{
+		return subdivideCounts(kernel, x0, y0, x1, y1, counts, stride);
+	};
+}
+
+std::uint64_t computeDeepMandelbrot(const DeepView &view, int width, int height, std::vector<int> &counts)
+{
+	counts.resize(std::size_t(width) * height);
+	if(counts.empty())
+		return 0;
+
+	std::vector<double> orbit;
+	computeReferenceOrbit(view, orbit);
+
+	CountKernel kernel = getDeepKernel(view, orbit, width, height);
+	return parallelTiles(width, 0, height, mandelbrotTileSize, [&](int x0, int y0, int x1, int y1)
+	{
+		return kernel(x0, y0, x1, y1, &counts[std::size_t(y0) * width + x0], width);
+	});
+}
@@ -0,0 +1,80 @@
+/*
+OpenGL examples - Deep zoom
+
+The Mandelbrot image (see mandelbrot.h) at magnifications far beyond what a float or a
+double can resolve, by perturbation. One reference orbit Z(n) of the center of the view
+is computed in fixed point (see bigfixed.h) with enough bits for the size of a pixel.
+Every pixel c = C + dc then only follows its difference from the reference,
+	dz(n + 1) = (2 Z(n) + dz(n)) dz(n) + dc
+in doubles, which keep their relative precision however small dz and dc get, down to
+scales of minDeepScale, 1e-300.
+
+The difference is only accurate while it stays small next to the orbit. Where the pixel
+orbit comes closer to 0 than to the reference, |Z(n) + dz(n)| < |dz(n)|, or where it
+outlives the reference, the pixel is rebased: its full value becomes the new difference
+and it continues from the start of the reference, Z(0) = 0. This removes the glitches
+of plain perturbation without detecting them afterwards or adding references.
+
+The pixels are iterated doublev::width at a time (see simd.h), each lane reading the
+reference at its own index since the lanes rebase at different times, and the tiles of
+the image are spread over the workers (see parallel.h). The shaders of the examples are
+limited to floats, whose exponents end at 1e-38, so the per-pixel work stays on the CPU.
+
+interiorChecks and subdivide work as in mandelbrot.h, except that the cardioid, bulb and
+cycle checks need the full c and z in doubles and are left out below a scale of 1e-10.
+Cycles are detected within a thousandth of a pixel. Subdivision works at any depth.
+*/
+
+#ifndef DEEP_ZOOM_H
+#define DEEP_ZOOM_H
+#include "bigfixed.h"
+#include "mandelbrot.h"
+
+/* the smallest scale, past which the pixel differences get subnormal */
+static const double minDeepScale = 1e-300;
+
+struct DeepView
+{
+	DeepView();
+
+	/* the same view as the shader shows for view.zoom and view.offset */
+	explicit DeepView(const MandelbrotView &view);
+
+	BigFixed x; // the center
+	BigFixed y;
+	double scale; // 1 shows the rectangle of data/fractal.fs at zoom 0, 3.5 x 2
+	int maxIteration;
+	bool interiorChecks;
+	bool subdivide;
+
+	/* the precision in words the center needs at this scale, with some to spare, at most
+		that of minDeepScale */
+	int getPrecision() const;
+
+	/* moves the center by (dx, dy) times the size of the view, and keeps its precision up to the scale */
+	void pan(double dx, double dy);
+};
+
+/* an iteration cap for views of the given scale, deeper views need more to show their detail.
+	scales below minDeepScale count as minDeepScale */
+int getDeepIterationLimit(double scale);
+
+/* the orbit of the center of the view, Z(0) = 0 up to the first value that escapes or Z(maxIteration),
+	as x and y of each */
+void computeReferenceOrbit(const DeepView &view, std::vector<double> &orbit);
+
+/* writes the iteration counts of the pixels [x0, x1) x [y0, y1) of a width x height image to counts,
+	the first pixel of each row stride counts after the first of the one above.
+	returns the iterations done, as iterateMandelbrot */
+std::uint64_t iterateDeep(const DeepView &view, const std::vector<double> &orbit,
+	int width, int height, int x0, int y0, int x1, int y1, int *counts, int stride);
+
+/* iterateDeep for a width x height image, through subdivideCounts if the view subdivides.
+	the view and the orbit are referenced, not copied */
+CountKernel getDeepKernel(const DeepView &view, const std::vector<double> &orbit, int width, int height);
+
+/* the counts of every pixel, row by row, computed by all the workers.
+	returns the iterations done */
+std::uint64_t computeDeepMandelbrot(const DeepView &view, int width, int height, std::vector<int> &counts);
+
+#endif
@@ -0,0 +1,102 @@
+/*
+OpenGL examples - Double-double arithmetic
+
+doubledoublev holds each lane as the unevaluated sum hi + lo of two doubles (see simd.h),
+|lo| at most half an ulp of hi, which gives about 106 bits of mantissa, 32 digits, at
+roughly ten times the cost of a double. It behaves like doublev under + - * and unary
+minus, and abs, so the fractal kernels (see fractal.h) take it as a number type.
+Comparisons only look at hi, enough for bailout tests, and return doublev masks.
+The sums and products are exact transformations in the usual way, with FMA or Dekker's
+split for the products, which needs IEEE rounding: do not build this with fast math.
+*/
+
+#ifndef DOUBLE_DOUBLE_H
+#define DOUBLE_DOUBLE_H
+#include "simd.h"
+#include <cmath>
+
+struct doubledoublev
+{
+	static const int width = doublev::width;
+	doublev hi;
+	doublev lo;
+
+	doubledoublev() { }
+	doubledoublev(double s) : hi(s), lo(0.0) { }
+	doubledoublev(doublev h) : hi(h), lo(0.0) { }
+	doubledoublev(doublev h, doublev l) : hi(h), lo(l) { }
+
+	/* the lanes hi[i] + lo[i] */
+	static doubledoublev load(const double *hi, const double *lo)
+	{
+		return doubledoublev(doublev::load(hi), doublev::load(lo));
+	}
+};
+
+// a + b exactly, for any a and b
+inline doubledoublev twoSum(doublev a, doublev b)
+{
+	doublev s = a + b;
+	doublev bb = s - a;
+	return doubledoublev(s, (a - (s - bb)) + (b - bb));
+}
+
+// a + b exactly, for |a| >= |b|
+inline doubledoublev quickTwoSum(doublev a, doublev b)
+{
+	doublev s = a + b;
+	return doubledoublev(s, b - (s - a));
+}
+
+// a * b exactly. With FMA the error is what a fused multiply-subtract leaves, otherwise
+// both are split into 26 bit halves (Dekker). Compilers fuse the split by themselves when
+// they target FMA, which breaks it, so it is only used where the target has none
+inline doubledoublev twoProduct(doublev a, doublev b)
+{
+	doublev p = a * b;
+#if defined(SIMD_AVX) && (defined(__FMA__) || (defined(_MSC_VER) && defined(__AVX2__)))
+	return doubledoublev(p, _mm256_fmsub_pd(a.v, b.v, p.v));
+#elif defined(FP_FAST_FMA) || defined(__FP_FAST_FMA)
+	double x[doublev::width], y[doublev::width], e[doublev::width];
+	a.store(x);
+	b.store(y);
+	p.store(e);
+	for(int i = 0; i < doublev::width; ++i)
+		e[i] = std::fma(x[i], y[i], -e[i]);
+	return doubledoublev(p, doublev::load(e));
+#else
+	const doublev split(134217729.0); // 2^27 + 1
+	doublev ta = split * a, tb = split * b;
+	doublev ah = ta - (ta - a), bh = tb - (tb - b);
+	doublev al = a - ah, bl = b - bh;
+	return doubledoublev(p, ((ah * bh - p) + ah * bl + al * bh) + al * bl);
+#endif
+}
+
+inline doubledoublev operator+(const doubledoublev &a, const doubledoublev &b)
+{
+	doubledoublev s = twoSum(a.hi, b.hi);
+	doubledoublev t = twoSum(a.lo, b.lo);
+	s = quickTwoSum(s.hi, s.lo + t.hi);
+	return quickTwoSum(s.hi, s.lo + t.lo);
+}
+
+inline doubledoublev operator-(const doubledoublev &a) { return doubledoublev(-a.hi, -a.lo); }
+inline doubledoublev operator-(const doubledoublev &a, const doubledoublev &b) { return a + -b; }
+
+inline doubledoublev operator*(const doubledoublev &a, const doubledoublev &b)
+{
+	doubledoublev p = twoProduct(a.hi, b.hi);
+	return quickTwoSum(p.hi, p.lo + (a.hi * b.lo + a.lo * b.hi));
+}
+
+inline doubledoublev abs(const doubledoublev &a)
+{
+	doublev negative = a.hi < doublev(0.0);
+	return doubledoublev(select(negative, -a.hi, a.hi), select(negative, -a.lo, a.lo));
+}
+
+inline doublev operator<(const doubledoublev &a, const doubledoublev &b) { return a.hi < b.hi; }
+inline doublev operator>(const doubledoublev &a, const doubledoublev &b) { return a.hi > b.hi; }
+
+#endif
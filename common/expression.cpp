@@ -0,0 +1,571 @@
+#include "expression.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <tuple>
+
+// The operation of op on floats, floatv lanes or intervals, b is ignored by the unary operations
+template <typename T>
+static T apply(Expression::Opcode op, const T &a, const T &b)
+{
+	using std::min;
+	using std::max;
+	using std::abs;
+	using std::sqrt;
+	switch(op)
+	{
+	case Expression::Add: return a + b;
+	case Expression::Subtract: return a - b;
+	case Expression::Multiply: return a * b;
+	case Expression::Divide: return a / b;
+	case Expression::Negate: return -a;
+	case Expression::Square: return square(a);
+	case Expression::Min: return min(a, b);
+	case Expression::Max: return max(a, b);
+	case Expression::Abs: return abs(a);
+	case Expression::Sqrt: return sqrt(a);
+	default: return a;
+	}
+}
+
+static bool isUnary(Expression::Opcode op)
+{
+	return op == Expression::Negate || op == Expression::Square || op == Expression::Abs || op == Expression::Sqrt;
+}
+
+static bool isCommutative(Expression::Opcode op)
+{
+	return op == Expression::Add || op == Expression::Multiply || op == Expression::Min || op == Expression::Max;
+}
+
+// A recursive descent parser that builds the operation graph as it goes. Nodes 0, 1 and 2
+// are x, y and z, and every node is created after its operands.
+class ExpressionCompiler
+{
+public:
+	struct Node
+	{
+		int op; // an Expression::Opcode, or -1 for the variables
+		int a;
+		int b;
+		float value;
+	};
+
+	std::vector<Node> nodes;
+	std::string error;
+
+	ExpressionCompiler(const std::string &source) : source(source), pos(0)
+	{
+		for(int i = 0; i < 3; ++i)
+		{
+			Node variable = { -1, -1, -1, 0.0f };
+			nodes.push_back(variable);
+		}
+	}
+
+	/* returns the root node, check error for failure */
+	int parse()
+	{
+		int root = parseSum();
+		skipSpace();
+		if(pos < source.size())
+			fail("unexpected '" + std::string(1, source[pos]) + "'");
+		return root;
+	}
+
+	bool isConstant(int node, float value) const
+	{
+		return nodes[node].op == Expression::Constant && nodes[node].value == value;
+	}
+
+	int constant(float value)
+	{
+		return add(Expression::Constant, -1, -1, value);
+	}
+
+	// Creates the node op(a, b), or finds the identical one, after folding and simplifying it
+	int operation(Expression::Opcode op, int a, int b = -1)
+	{
+		Node na = nodes[a];
+		if(na.op == Expression::Constant && (isUnary(op) || nodes[b].op == Expression::Constant))
+			return constant(apply(op, na.value, isUnary(op) ? 0.0f : nodes[b].value));
+
+		switch(op)
+		{
+		case Expression::Add:
+			if(isConstant(a, 0.0f)) return b;
+			if(isConstant(b, 0.0f)) return a;
+			break;
+		case Expression::Subtract:
+			if(isConstant(b, 0.0f)) return a;
+			if(isConstant(a, 0.0f)) return operation(Expression::Negate, b);
+			if(a == b) return constant(0.0f);
+			break;
+		case Expression::Multiply:
+			if(isConstant(a, 1.0f)) return b;
+			if(isConstant(b, 1.0f)) return a;
+			if(isConstant(a, -1.0f)) return operation(Expression::Negate, b);
+			if(isConstant(b, -1.0f)) return operation(Expression::Negate, a);
+			if(isConstant(a, 0.0f) || isConstant(b, 0.0f)) return constant(0.0f);
+			if(a == b) return operation(Expression::Square, a);
+			break;
+		case Expression::Divide:
+			if(isConstant(b, 1.0f)) return a;
+			if(nodes[b].op == Expression::Constant) return operation(Expression::Multiply, a, constant(1.0f / nodes[b].value));
+			break;
+		case Expression::Negate:
+			if(na.op == Expression::Negate) return na.a;
+			break;
+		case Expression::Min:
+		case Expression::Max:
+			if(a == b) return a;
+			break;
+		case Expression::Abs:
+			if(na.op == Expression::Abs || na.op == Expression::Square) return a;
+			break;
+		default:
+			break;
+		}
+
+		// Order the operands so that a + b and b + a are the same node
+		if(isCommutative(op) && b < a)
+			std::swap(a, b);
+		return add(op, a, b, 0.0f);
+	}
+
+private:
+	const std::string &source;
+	std::size_t pos;
+	std::map<std::tuple<int, int, int, unsigned int>, int> unique;
+
+	int add(int op, int a, int b, float value)
+	{
+		unsigned int bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		auto key = std::make_tuple(op, a, b, bits);
+		auto found = unique.find(key);
+		if(found != unique.end())
+			return found->second;
+
+		Node node = { op, a, b, value };
+		nodes.push_back(node);
+		unique[key] = int(nodes.size()) - 1;
+		return int(nodes.size()) - 1;
+	}
+
+	int fail(const std::string &message)
+	{
+		if(error.empty())
+		{
+			std::ostringstream out;
+			out<<"column "<<(pos + 1)<<": "<<message;
+			error = out.str();
+		}
+		pos = source.size();
+		return 0;
+	}
+
+	void skipSpace()
+	{
+		while(pos < source.size())
+		{
+			if(source[pos] == '#')
+			{
+				while(pos < source.size() && source[pos] != '\n')
+					++pos;
+			}
+			else if(std::isspace((unsigned char)source[pos]))
+				++pos;
+			else
+				break;
+		}
+	}
+
+	bool accept(char c)
+	{
+		skipSpace();
+		if(pos < source.size() && source[pos] == c)
+		{
+			++pos;
+			return true;
+		}
+		return false;
+	}
+
+	int parseSum()
+	{
+		int left = parseProduct();
+		for(;;)
+		{
+			if(accept('+'))
+				left = operation(Expression::Add, left, parseProduct());
+			else if(accept('-'))
+				left = operation(Expression::Subtract, left, parseProduct());
+			else
+				return left;
+		}
+	}
+
+	int parseProduct()
+	{
+		int left = parseUnary();
+		for(;;)
+		{
+			if(accept('*'))
+				left = operation(Expression::Multiply, left, parseUnary());
+			else if(accept('/'))
+				left = operation(Expression::Divide, left, parseUnary());
+			else
+				return left;
+		}
+	}
+
+	int parseUnary()
+	{
+		if(accept('-'))
+			return operation(Expression::Negate, parseUnary());
+		if(accept('+'))
+			return parseUnary();
+		return parsePower();
+	}
+
+	int parsePower()
+	{
+		int base = parsePrimary();
+		if(!accept('^'))
+			return base;
+
+		std::size_t exponentPos = pos;
+		int exponent = parseUnary();
+		float n = nodes[exponent].value;
+		if(nodes[exponent].op != Expression::Constant || n < 0.0f || n > 64.0f || n != std::floor(n))
+		{
+			pos = exponentPos;
+			return fail("exponent must be an integer constant from 0 to 64");
+		}
+		return power(base, int(n));
+	}
+
+	// Exponentiation by squaring, so x^3 and x^4 share the node x^2
+	int power(int base, int n)
+	{
+		if(n == 0)
+			return constant(1.0f);
+		if(n == 1)
+			return base;
+		if(n % 2 == 0)
+			return operation(Expression::Square, power(base, n / 2));
+		return operation(Expression::Multiply, power(base, n - 1), base);
+	}
+
+	int parsePrimary()
+	{
+		skipSpace();
+		if(pos >= source.size())
+			return fail("unexpected end of expression");
+
+		if(accept('('))
+		{
+			int inner = parseSum();
+			if(!accept(')'))
+				return fail("expected ')'");
+			return inner;
+		}
+
+		char c = source[pos];
+		if(std::isdigit((unsigned char)c) || c == '.')
+		{
+			char *end;
+			float value = std::strtof(source.c_str() + pos, &end);
+			if(end == source.c_str() + pos)
+				return fail("invalid number");
+			pos = end - source.c_str();
+			return constant(value);
+		}
+
+		if(!std::isalpha((unsigned char)c))
+			return fail("unexpected '" + std::string(1, c) + "'");
+		std::size_t start = pos;
+		while(pos < source.size() && std::isalnum((unsigned char)source[pos]))
+			++pos;
+		std::string name = source.substr(start, pos - start);
+		if(name == "x") return 0;
+		if(name == "y") return 1;
+		if(name == "z") return 2;
+		if(name == "pi") return constant(3.1415926535f);
+
+		Expression::Opcode op;
+		int arity;
+		if(name == "min") { op = Expression::Min; arity = 2; }
+		else if(name == "max") { op = Expression::Max; arity = 2; }
+		else if(name == "abs") { op = Expression::Abs; arity = 1; }
+		else if(name == "sqrt") { op = Expression::Sqrt; arity = 1; }
+		else
+		{
+			pos = start;
+			return fail("unknown name '" + name + "'");
+		}
+
+		if(!accept('('))
+			return fail("expected '(' after " + name);
+		int a = parseSum();
+		int b = -1;
+		if(arity == 2)
+		{
+			if(!accept(','))
+				return fail(name + " takes two arguments");
+			b = parseSum();
+		}
+		if(!accept(')'))
+			return fail("expected ')'");
+		return operation(op, a, b);
+	}
+};
+
+Expression::Expression() : registerCount(3), result(0)
+{
+}
+
+bool Expression::compile(const std::string &source, std::string &error)
+{
+	ExpressionCompiler compiler(source);
+	int root = compiler.parse();
+	if(!compiler.error.empty())
+	{
+		error = compiler.error;
+		return false;
+	}
+
+	// Turn additions and multiplications by a constant into immediate instructions. At most
+	// one operand is constant, or the node would have been folded
+	std::vector<ExpressionCompiler::Node> nodes = compiler.nodes;
+	int count = int(nodes.size());
+	for(int i = 3; i < count; ++i)
+	{
+		ExpressionCompiler::Node &node = nodes[i];
+		bool constantA = node.a >= 0 && nodes[node.a].op == Constant;
+		bool constantB = node.b >= 0 && nodes[node.b].op == Constant;
+		if((node.op == Add || node.op == Multiply) && (constantA || constantB))
+		{
+			node.value = nodes[constantA ? node.a : node.b].value;
+			node.a = constantA ? node.b : node.a;
+			node.op = node.op == Add ? AddConstant : MultiplyConstant;
+			node.b = -1;
+		}
+		else if(node.op == Subtract && constantB)
+		{
+			node.value = -nodes[node.b].value;
+			node.op = AddConstant;
+			node.b = -1;
+		}
+	}
+
+	// Only the nodes reachable from the root are computed, in the order they were created
+	std::vector<bool> used(count, false);
+	used[root] = true;
+	for(int i = count - 1; i >= 0; --i)
+	{
+		if(!used[i])
+			continue;
+		if(nodes[i].a >= 0) used[nodes[i].a] = true;
+		if(nodes[i].b >= 0) used[nodes[i].b] = true;
+	}
+
+	std::vector<int> lastUse(count, -1);
+	for(int i = 0; i < count; ++i)
+	{
+		if(!used[i])
+			continue;
+		if(nodes[i].a >= 0) lastUse[nodes[i].a] = i;
+		if(nodes[i].b >= 0) lastUse[nodes[i].b] = i;
+	}
+	lastUse[root] = count;
+
+	// Registers 0 to 2 hold the variables, the others are released after their last reader
+	program.clear();
+	registerCount = 3;
+	std::vector<int> nodeRegister(count, -1);
+	std::vector<int> freeRegisters;
+	for(int i = 0; i < 3; ++i)
+		nodeRegister[i] = i;
+	for(int i = 3; i < count; ++i)
+	{
+		if(!used[i])
+			continue;
+
+		const ExpressionCompiler::Node &node = nodes[i];
+		Instruction instruction;
+		instruction.op = Opcode(node.op);
+		instruction.a = node.a >= 0 ? nodeRegister[node.a] : -1;
+		instruction.b = node.b >= 0 ? nodeRegister[node.b] : -1;
+		instruction.value = node.value;
+
+		// An operand read for the last time can be overwritten by the result
+		int operands[2] = { node.a, node.b };
+		for(int k = 0; k < 2; ++k)
+			if(operands[k] >= 3 && lastUse[operands[k]] == i && (k == 0 || operands[1] != operands[0]))
+				freeRegisters.push_back(nodeRegister[operands[k]]);
+
+		if(freeRegisters.empty())
+		{
+			instruction.dst = registerCount++;
+		}
+		else
+		{
+			instruction.dst = freeRegisters.back();
+			freeRegisters.pop_back();
+		}
+		nodeRegister[i] = instruction.dst;
+		program.push_back(instruction);
+	}
+	result = nodeRegister[root];
+	return true;
+}
+
+template <typename T>
+T Expression::run(T *registers) const
+{
+	for(std::size_t i = 0; i < program.size(); ++i)
+	{
+		const Instruction &in = program[i];
+		if(in.op == Constant)
+			registers[in.dst] = T(in.value);
+		else if(in.op == AddConstant)
+			registers[in.dst] = registers[in.a] + T(in.value);
+		else if(in.op == MultiplyConstant)
+			registers[in.dst] = registers[in.a] * T(in.value);
+		else
+			registers[in.dst] = apply(in.op, registers[in.a], registers[in.b < 0 ? in.a : in.b]);
+	}
+	return registers[result];
+}
+
+float Expression::evaluate(float x, float y, float z) const
+{
+	float stack[64];
+	std::vector<float> heap;
+	float *registers = stack;
+	if(registerCount > 64)
+	{
+		heap.resize(registerCount);
+		registers = &heap[0];
+	}
+	registers[0] = x;
+	registers[1] = y;
+	registers[2] = z;
+	return run(registers);
+}
+
+Interval Expression::evaluateInterval(const Interval &x, const Interval &y, const Interval &z) const
+{
+	std::vector<Interval> registers(registerCount);
+	registers[0] = x;
+	registers[1] = y;
+	registers[2] = z;
+	return run(&registers[0]);
+}
+
+void Expression::evaluateBatch(const float *x, const float *y, const float *z, float *f, int count) const
+{
+	// Each register holds a block of points. The interpreter runs the whole program on one
+	// block before the next, so the registers stay in the L1 cache. The registers are not
+	// aligned to the vector size, so they are accessed with floatv::load and store
+	const int w = floatv::width;
+	const int block = 32 * w;
+	static thread_local std::vector<float> storage;
+	if(storage.size() < std::size_t(registerCount * block))
+		storage.resize(registerCount * block);
+	float *registers = &storage[0];
+
+	for(int start = 0; start < count; start += block)
+	{
+		// A partial last vector is padded with copies of the last point
+		int n = std::min(count - start, block);
+		int padded = (n + w - 1) / w * w;
+		const float *inputs[3] = { x + start, y + start, z + start };
+		for(int v = 0; v < 3; ++v)
+		{
+			std::copy(inputs[v], inputs[v] + n, registers + v * block);
+			std::fill(registers + v * block + n, registers + v * block + padded, inputs[v][n - 1]);
+		}
+
+		for(std::size_t i = 0; i < program.size(); ++i)
+		{
+			const Instruction &in = program[i];
+			float *d = registers + in.dst * block;
+			const float *a = registers + (in.a < 0 ? 0 : in.a) * block;
+			const float *b = registers + (in.b < 0 ? 0 : in.b) * block;
+			switch(in.op)
+			{
+			case Constant: std::fill(d, d + padded, in.value); break;
+			case Add: for(int k = 0; k < padded; k += w) (floatv::load(a + k) + floatv::load(b + k)).store(d + k); break;
+			case Subtract: for(int k = 0; k < padded; k += w) (floatv::load(a + k) - floatv::load(b + k)).store(d + k); break;
+			case Multiply: for(int k = 0; k < padded; k += w) (floatv::load(a + k) * floatv::load(b + k)).store(d + k); break;
+			case Divide: for(int k = 0; k < padded; k += w) (floatv::load(a + k) / floatv::load(b + k)).store(d + k); break;
+			case Negate: for(int k = 0; k < padded; k += w) (-floatv::load(a + k)).store(d + k); break;
+			case Square: for(int k = 0; k < padded; k += w) square(floatv::load(a + k)).store(d + k); break;
+			case Min: for(int k = 0; k < padded; k += w) min(floatv::load(a + k), floatv::load(b + k)).store(d + k); break;
+			case Max: for(int k = 0; k < padded; k += w) max(floatv::load(a + k), floatv::load(b + k)).store(d + k); break;
+			case Abs: for(int k = 0; k < padded; k += w) abs(floatv::load(a + k)).store(d + k); break;
+			case Sqrt: for(int k = 0; k < padded; k += w) sqrt(floatv::load(a + k)).store(d + k); break;
+			case AddConstant: { floatv c(in.value); for(int k = 0; k < padded; k += w) (floatv::load(a + k) + c).store(d + k); } break;
+			case MultiplyConstant: { floatv c(in.value); for(int k = 0; k < padded; k += w) (floatv::load(a + k) * c).store(d + k); } break;
+			}
+		}
+
+		const float *r = registers + result * block;
+		std::copy(r, r + n, f + start);
+	}
+}
+
+std::string Expression::disassemble() const
+{
+	static const char *names[] = { "const", "add", "sub", "mul", "div", "neg", "sqr", "min", "max", "abs", "sqrt", "addc", "mulc" };
+	std::ostringstream out;
+	for(std::size_t i = 0; i < program.size(); ++i)
+	{
+		const Instruction &in = program[i];
+		out<<"r"<<in.dst<<" = "<<names[in.op];
+		if(in.op != Constant)
+			out<<" r"<<in.a;
+		if(in.b >= 0)
+			out<<" r"<<in.b;
+		if(in.op == Constant || in.op == AddConstant || in.op == MultiplyConstant)
+			out<<" "<<in.value;
+		out<<"\n";
+	}
+	out<<"result r"<<result<<"\n";
+	return out.str();
+}
+
+bool compileSurfaceField(const std::string &name, const std::string &source, SurfaceField &field)
+{
+	std::shared_ptr<Expression> expression = std::make_shared<Expression>();
+	std::string error;
+	if(!expression->compile(source, error))
+	{
+		std::cerr<<"Failure compiling field "<<name<<", "<<error<<std::endl;
+		return false;
+	}
+
+	field.name = name;
+	field.evaluate = [expression](float x, float y, float z)
+	{
+		return expression->evaluate(x, y, z);
+	};
+	field.evaluateBatch = [expression](const float *x, const float *y, const float *z, float *f, int count)
+	{
+		expression->evaluateBatch(x, y, z, f, count);
+	};
+	field.evaluateInterval = [expression](const Interval &x, const Interval &y, const Interval &z)
+	{
+		return expression->evaluateInterval(x, y, z);
+	};
+	return true;
+}
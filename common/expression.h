@@ -0,0 +1,89 @@
+/*
+OpenGL examples - Expressions
+
+Fields f(x, y, z) written as text and compiled at runtime, so the surface can be
+changed without rebuilding. The language has the variables x, y and z, numbers,
+the constant pi, the operators + - * / and ^ (integer powers), parentheses and
+the functions min(a, b), max(a, b), abs(a) and sqrt(a). A # starts a comment
+running to the end of the line.
+
+The source is parsed into a graph of operations in which identical subexpressions
+are a single node and constant subexpressions are folded, so the x*x in x^2*y and
+x^3 is computed once. Powers are expanded into squares and products. The graph is
+then scheduled into a register bytecode, reusing a register once its last reader
+has run. Constant operands of + - and * are folded into the instruction.
+
+The interpreter runs each instruction over a whole batch of points, floatv::width
+lanes at a time (see simd.h), so the cost of decoding an instruction is shared by
+all the points of the batch. The same bytecode is also run on plain floats and on
+intervals (see interval.h), so compiled fields can be culled like the built in ones.
+*/
+
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+#include "field.h"
+#include <string>
+#include <vector>
+
+class Expression
+{
+public:
+	Expression();
+
+	/* compiles the source, replacing any previous program.
+		return true if successful.
+		return false otherwise, with a description of the first error in error */
+	bool compile(const std::string &source, std::string &error);
+
+	float evaluate(float x, float y, float z) const;
+	void evaluateBatch(const float *x, const float *y, const float *z, float *f, int count) const;
+	Interval evaluateInterval(const Interval &x, const Interval &y, const Interval &z) const;
+
+	int getInstructionCount() const { return int(program.size()); }
+	int getRegisterCount() const { return registerCount; }
+
+	/* one line per instruction, for inspecting the output of the compiler */
+	std::string disassemble() const;
+
+	enum Opcode
+	{
+		Constant,
+		Add,
+		Subtract,
+		Multiply,
+		Divide,
+		Negate,
+		Square,
+		Min,
+		Max,
+		Abs,
+		Sqrt,
+		AddConstant,
+		MultiplyConstant
+	};
+
+	/* registers 0, 1 and 2 hold x, y and z */
+	struct Instruction
+	{
+		Opcode op;
+		int dst;
+		int a;
+		int b;
+		float value; // of Constant, AddConstant and MultiplyConstant
+	};
+
+private:
+	template <typename T>
+	T run(T *registers) const;
+
+	std::vector<Instruction> program;
+	int registerCount;
+	int result;
+};
+
+/* compiles source into a field named name. The field keeps its own copy of the compiled expression.
+	return true if successful.
+	return false otherwise, after printing the error to std::cerr */
+bool compileSurfaceField(const std::string &name, const std::string &source, SurfaceField &field);
+
+#endif
@@ -0,0 +1,6 @@
+#include "field.h"
+
+const SurfaceField nordstrandField = makeSurfaceField<Nordstrand>("nordstrand");
+const SurfaceField quarticBlobField = makeSurfaceField<QuarticBlob>("quartic blob");
+const SurfaceField sphereField = makeSurfaceField<Sphere>("sphere");
+const SurfaceField paraboloidField = makeSurfaceField<Paraboloid>("paraboloid");
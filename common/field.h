@@ -0,0 +1,126 @@
+/*
+OpenGL examples - Fields
+
+Implicit surfaces f(x, y, z) = 0 used by the isosurface example.
+Each field is a functor whose call operator is a template over the number
+type, so the formula is written once and instantiated for plain floats,
+for SIMD lanes (see simd.h) and for intervals (see interval.h).
+
+A SurfaceField bundles the scalar evaluator with a batch evaluator
+	evaluateBatch(x, y, z, f, count)
+which computes f[i] = f(x[i], y[i], z[i]) for count points, floatv::width
+points at a time with a scalar loop for the remainder, and an interval
+evaluator
+	evaluateInterval(x, y, z)
+which bounds f over the box x * y * z. Fields without an interval form
+leave it empty, in which case nothing can be culled. The evaluators are
+std::function so that fields built at runtime (see expression.h) can carry
+their own state.
+*/
+
+#ifndef FIELD_H
+#define FIELD_H
+#include "simd.h"
+#include "interval.h"
+#include <functional>
+#include <string>
+
+typedef std::function<float(float x, float y, float z)> SurfaceFunction;
+typedef std::function<void(const float *x, const float *y, const float *z, float *f, int count)> SurfaceFunctionBatch;
+typedef std::function<Interval(const Interval &x, const Interval &y, const Interval &z)> SurfaceFunctionInterval;
+
+struct SurfaceField
+{
+	std::string name;
+	SurfaceFunction evaluate;
+	SurfaceFunctionBatch evaluateBatch;
+	SurfaceFunctionInterval evaluateInterval;
+};
+
+/* x * x for floats and SIMD lanes, Interval has a tighter overload */
+template <typename T>
+T square(T x)
+{
+	return x * x;
+}
+
+// Nordstrand's weird surface
+struct Nordstrand
+{
+	template <typename T>
+	T operator()(T x, T y, T z) const
+	{
+		T xx = square(x), yy = square(y), zz = square(z);
+		return T(25.0f) * (xx * x * (y + z) + yy * y * (x + z) + zz * z * (x + y)) +
+			T(50.0f) * (xx * yy + xx * zz + yy * zz) -
+			T(125.0f) * (xx * y * z + yy * x * z + zz * x * y) +
+			T(60.0f) * x * y * z -
+			T(4.0f) * (x * y + x * z + y * z);
+	}
+};
+
+// A cube with rounded edges, bulging into blobs
+struct QuarticBlob
+{
+	template <typename T>
+	T operator()(T x, T y, T z) const
+	{
+		T xx = square(x), yy = square(y), zz = square(z);
+		return square(xx) + square(yy) + square(zz) - T(1.4f) * (xx + yy + zz) + T(0.55f);
+	}
+};
+
+struct Sphere
+{
+	template <typename T>
+	T operator()(T x, T y, T z) const
+	{
+		return square(x) + square(y) + square(z) - T(1.0f);
+	}
+};
+
+struct Paraboloid
+{
+	template <typename T>
+	T operator()(T x, T y, T z) const
+	{
+		return y - square(x) - square(z);
+	}
+};
+
+template <typename Field>
+float evaluateField(float x, float y, float z)
+{
+	return Field()(x, y, z);
+}
+
+template <typename Field>
+void evaluateFieldBatch(const float *x, const float *y, const float *z, float *f, int count)
+{
+	Field field;
+	int i = 0;
+	for(; i + floatv::width <= count; i += floatv::width)
+		field(floatv::load(x + i), floatv::load(y + i), floatv::load(z + i)).store(f + i);
+	for(; i < count; ++i)
+		f[i] = field(x[i], y[i], z[i]);
+}
+
+template <typename Field>
+Interval evaluateFieldInterval(const Interval &x, const Interval &y, const Interval &z)
+{
+	return Field()(x, y, z);
+}
+
+template <typename Field>
+SurfaceField makeSurfaceField(const char *name)
+{
+	SurfaceField field = { name, evaluateField<Field>, evaluateFieldBatch<Field>, evaluateFieldInterval<Field> };
+	return field;
+}
+
+extern const SurfaceField nordstrandField;
+extern const SurfaceField quarticBlobField;
+extern const SurfaceField sphereField;
+extern const SurfaceField paraboloidField;
+
+#endif
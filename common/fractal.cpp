@@ -0,0 +1,130 @@
+#include "fractal.h"
+#include "parallel.h"
+#include <cstdlib>
+#include <sstream>
+
+// The size of the view at scale 1, as in deepzoom.cpp
+static const double viewWidth = 3.5;
+static const double viewHeight = 2.0;
+
+FractalGrid::FractalGrid(const DeepView &view, int width, int height) :
+	pixelWidth(viewWidth * view.scale / double(width)), pixelHeight(viewHeight * view.scale / double(height)),
+	width(width), height(height)
+{
+	// What the double of the center leaves out of the fixed point one
+	centerX = view.x.toDouble();
+	centerY = view.y.toDouble();
+	int precision = std::max(view.x.getPrecision(), view.y.getPrecision());
+	centerLoX = (view.x - BigFixed(centerX, precision)).toDouble();
+	centerLoY = (view.y - BigFixed(centerY, precision)).toDouble();
+}
+
+template <typename Formula, typename Real>
+static FractalKernel getKernel(FractalColoring coloring)
+{
+	if(coloring == SmoothColoring)
+		return &iterateFractal<Formula, Real, SmoothCount>;
+	return &iterateFractal<Formula, Real, EscapeCount>;
+}
+
+template <typename Formula>
+static FractalKernel getKernel(const FractalSettings &settings)
+{
+	switch(settings.precision)
+	{
+	case DoublePrecision: return getKernel<Formula, doublev>(settings.coloring);
+	case DoubleDoublePrecision: return getKernel<Formula, doubledoublev>(settings.coloring);
+	default: return getKernel<Formula, floatv>(settings.coloring);
+	}
+}
+
+FractalKernel getFractalKernel(const FractalSettings &settings)
+{
+	switch(settings.formula)
+	{
+	case JuliaFormula: return getKernel<Julia>(settings);
+	case BurningShipFormula: return getKernel<BurningShip>(settings);
+	case MultibrotFormula:
+		switch(settings.power)
+		{
+		case 3: return getKernel<Multibrot<3> >(settings);
+		case 4: return getKernel<Multibrot<4> >(settings);
+		case 5: return getKernel<Multibrot<5> >(settings);
+		case 6: return getKernel<Multibrot<6> >(settings);
+		default: return nullptr;
+		}
+	default: return getKernel<Mandelbrot>(settings);
+	}
+}
+
+std::uint64_t computeFractal(const FractalSettings &settings, const DeepView &view, int width, int height,
+std::vector<float> &values)
+{
+	values.resize(std::size_t(width) * height);
+	FractalKernel kernel = getFractalKernel(settings);
+	if(values.empty() || !kernel)
+		return 0;
+
+	return parallelTiles(width, 0, height, mandelbrotTileSize, [&](int x0, int y0, int x1, int y1)
+	{
+		return kernel(settings, view, width, height, x0, y0, x1, y1, &values[std::size_t(y0) * width + x0], width);
+	});
+}
+
+void colorFractal(const float *values, std::size_t count, int maxIteration, unsigned char *rgb)
+{
+	colorMandelbrot(values, count, maxIteration, rgb);
+}
+
+std::string getFractalDefines(const FractalSettings &settings, int maxIteration)
+{
+	static const char *formulas[] = { "FORMULA_MANDELBROT", "FORMULA_MULTIBROT", "FORMULA_JULIA", "FORMULA_BURNING_SHIP" };
+	std::ostringstream defines;
+	defines.precision(9);
+	defines<<std::showpoint;
+	defines<<"#define "<<formulas[settings.formula]<<"\n";
+	defines<<"#define POWER "<<settings.getPower()<<"\n";
+	defines<<"#define MAX_ITERATION "<<maxIteration<<"\n";
+	if(settings.formula == JuliaFormula)
+		defines<<"#define JULIA_C vec2("<<settings.juliaX<<", "<<settings.juliaY<<")\n";
+	if(settings.coloring == SmoothColoring)
+		defines<<"#define SMOOTH_COLORING\n";
+	return defines.str();
+}
+
+bool parseFractalFormula(const std::string &name, FractalSettings &settings)
+{
+	if(name == "mandelbrot")
+		settings.formula = MandelbrotFormula;
+	else if(name == "julia")
+		settings.formula = JuliaFormula;
+	else if(name == "ship")
+		settings.formula = BurningShipFormula;
+	else if(name.compare(0, 9, "multibrot") == 0)
+	{
+		int power = std::atoi(name.c_str() + 9);
+		if(power == 2)
+			settings.formula = MandelbrotFormula;
+		else if(power >= 3 && power <= maxMultibrotPower)
+		{
+			settings.formula = MultibrotFormula;
+			settings.power = power;
+		}
+		else
+			return false;
+	}
+	else
+		return false;
+	return true;
+}
+
+std::string getFractalName(const FractalSettings &settings)
+{
+	switch(settings.formula)
+	{
+	case MultibrotFormula: return "multibrot" + std::to_string(settings.power);
+	case JuliaFormula: return "julia";
+	case BurningShipFormula: return "ship";
+	default: return "mandelbrot";
+	}
+}
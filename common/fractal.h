@@ -0,0 +1,339 @@
+/*
+OpenGL examples - Escape-time fractals
+
+A family of CPU kernels for the fractals iterated like the Mandelbrot set (see
+mandelbrot.h), one per formula, number type and colouring, chosen at compile time:
+	formula		Mandelbrot		z = z^2 + c from z = 0
+				Multibrot<N>	z = z^N + c from z = 0
+				Julia			z = z^2 + k from z = c, for a constant k
+				BurningShip		z = (|x| + i|y|)^2 + c from z = 0
+	number		floatv, doublev or doubledoublev (see simd.h and doubledouble.h), 8, 4 or
+				4 lanes with AVX, precise to zooms of about 1e-5, 1e-13 and 1e-29
+	colouring	EscapeCount		the iterations while |z| < 2
+				SmoothCount		the count with a fraction from how far past a radius of
+								256 the orbit escaped, continuous across the counts
+The formula and colouring are structs of static functions that the kernel is written over,
+and the number types behave like floats, so every combination is a separate loop with the
+formula inlined and nothing decided in it but the exit once every lane has escaped.
+getFractalKernel picks the instantiation for the settings once per image:
+	FractalSettings settings;
+	settings.formula = JuliaFormula;
+	computeFractal(settings, view, 640, 480, values);
+The view is a DeepView (see deepzoom.h), whose center has the precision the double-doubles
+need. The kernels leave out the interior checks and subdivision of mandelbrot.h, which only
+hold for the Mandelbrot set and for counts.
+
+getFractalDefines gives the same choice to data/fractal.fs as preprocessor definitions. The
+shaders only have floats, so every precision draws the float variant on the GPU.
+*/
+
+#ifndef FRACTAL_H
+#define FRACTAL_H
+#include "deepzoom.h"
+#include "doubledouble.h"
+#include "simd.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum FractalFormula { MandelbrotFormula, MultibrotFormula, JuliaFormula, BurningShipFormula };
+enum FractalPrecision { FloatPrecision, DoublePrecision, DoubleDoublePrecision };
+enum FractalColoring { CountColoring, SmoothColoring };
+
+static const int maxMultibrotPower = 6;
+
+struct FractalSettings
+{
+	FractalSettings() : formula(MandelbrotFormula), power(3), precision(FloatPrecision),
+		coloring(CountColoring), juliaX(-0.8), juliaY(0.156) { }
+
+	FractalFormula formula;
+	int power; // of MultibrotFormula, 3 to maxMultibrotPower
+	FractalPrecision precision;
+	FractalColoring coloring;
+	double juliaX; // k of JuliaFormula
+	double juliaY;
+
+	/* the power of z in the formula */
+	int getPower() const { return formula == MultibrotFormula ? power : 2; }
+};
+
+/* Lanes of the number types */
+
+inline void loadLanes(const double *hi, const double *, floatv &v)
+{
+	float f[floatv::width];
+	for(int i = 0; i < floatv::width; ++i)
+		f[i] = float(hi[i]);
+	v = floatv::load(f);
+}
+inline void loadLanes(const double *hi, const double *, doublev &v) { v = doublev::load(hi); }
+inline void loadLanes(const double *hi, const double *lo, doubledoublev &v) { v = doubledoublev::load(hi, lo); }
+
+inline void storeLanes(floatv v, double *p)
+{
+	float f[floatv::width];
+	v.store(f);
+	for(int i = 0; i < floatv::width; ++i)
+		p[i] = f[i];
+}
+inline void storeLanes(doublev v, double *p) { v.store(p); }
+
+// The value as a lane of a mask type, for the number types whose comparisons give a simpler one
+inline floatv leading(floatv a) { return a; }
+inline doublev leading(doublev a) { return a; }
+inline doublev leading(const doubledoublev &a) { return a.hi; }
+
+/* Formulas */
+
+// z^N in place, by multiplying z^(N - 1) by z
+template <int N>
+struct ComplexPower
+{
+	template <typename Real>
+	static void apply(Real &x, Real &y)
+	{
+		Real bx = x, by = y;
+		ComplexPower<N - 1>::apply(x, y);
+		Real t = x * bx - y * by;
+		y = x * by + y * bx;
+		x = t;
+	}
+};
+
+template <>
+struct ComplexPower<2>
+{
+	template <typename Real>
+	static void apply(Real &x, Real &y)
+	{
+		Real t = x * x - y * y;
+		y = (x + x) * y;
+		x = t;
+	}
+};
+
+template <int N>
+struct Multibrot
+{
+	static const int power = N;
+
+	template <typename Real>
+	static void start(Real &zx, Real &zy, Real &cx, Real &cy, const Real &x, const Real &y, const Real &, const Real &)
+	{
+		zx = zy = Real(0.0);
+		cx = x;
+		cy = y;
+	}
+
+	template <typename Real>
+	static void step(Real &zx, Real &zy, const Real &cx, const Real &cy)
+	{
+		ComplexPower<N>::apply(zx, zy);
+		zx = zx + cx;
+		zy = zy + cy;
+	}
+};
+
+typedef Multibrot<2> Mandelbrot;
+
+struct Julia
+{
+	static const int power = 2;
+
+	template <typename Real>
+	static void start(Real &zx, Real &zy, Real &cx, Real &cy, const Real &x, const Real &y, const Real &kx, const Real &ky)
+	{
+		zx = x;
+		zy = y;
+		cx = kx;
+		cy = ky;
+	}
+
+	template <typename Real>
+	static void step(Real &zx, Real &zy, const Real &cx, const Real &cy)
+	{
+		Mandelbrot::step(zx, zy, cx, cy);
+	}
+};
+
+struct BurningShip
+{
+	static const int power = 2;
+
+	template <typename Real>
+	static void start(Real &zx, Real &zy, Real &cx, Real &cy, const Real &x, const Real &y, const Real &kx, const Real &ky)
+	{
+		Mandelbrot::start(zx, zy, cx, cy, x, y, kx, ky);
+	}
+
+	template <typename Real>
+	static void step(Real &zx, Real &zy, const Real &cx, const Real &cy)
+	{
+		zx = abs(zx);
+		zy = abs(zy);
+		Mandelbrot::step(zx, zy, cx, cy);
+	}
+};
+
+/* Colourings */
+
+struct EscapeCount
+{
+	static double getBailout() { return 4.0; }
+
+	// What the colouring keeps of the orbits as they escape, nothing
+	template <typename Mask>
+	struct Escape
+	{
+		void record(Mask, Mask) { }
+		void store(double *) const { }
+	};
+
+	static float getValue(double count, double, int, int) { return float(count); }
+};
+
+struct SmoothCount
+{
+	static double getBailout() { return 65536.0; }
+
+	// |z|^2 of the orbits as they escape
+	template <typename Mask>
+	struct Escape
+	{
+		Escape() : r2(0.0) { }
+		void record(Mask escaped, Mask value) { r2 = select(escaped, value, r2); }
+		void store(double *p) const { storeLanes(r2, p); }
+		Mask r2;
+	};
+
+	// From count + 1 at the bailout radius R down to count at R^power
+	static float getValue(double count, double r2, int power, int maxIteration)
+	{
+		if(count >= double(maxIteration))
+			return float(maxIteration);
+		double fraction = std::log(std::log(r2) / std::log(getBailout())) / std::log(double(power));
+		return float(std::min(std::max(count + 1.0 - fraction, 0.0), double(maxIteration)));
+	}
+};
+
+/* Kernels */
+
+/* where the pixels of a width x height image of the view lie, the center in two doubles so the
+	points of the double-double kernels get all of its precision */
+struct FractalGrid
+{
+	FractalGrid(const DeepView &view, int width, int height);
+
+	/* the center of pixel (x, y), row 0 at the top, as hi + lo */
+	void getPoint(int x, int y, double &hiX, double &loX, double &hiY, double &loY) const
+	{
+		split(centerX, centerLoX, (double(x) + 0.5 - 0.5 * width) * pixelWidth, hiX, loX);
+		split(centerY, centerLoY, (0.5 * height - double(y) - 0.5) * pixelHeight, hiY, loY);
+	}
+
+	double centerX, centerLoX;
+	double centerY, centerLoY;
+	double pixelWidth, pixelHeight;
+	int width, height;
+
+private:
+	// center + lo + d rounded to two doubles, exactly for the first sum
+	static void split(double center, double lo, double d, double &hi, double &rest)
+	{
+		hi = center + d;
+		double bb = hi - center;
+		rest = (center - (hi - bb)) + (d - bb) + lo;
+	}
+};
+
+/* writes the values of the pixels [x0, x1) x [y0, y1) of a width x height image of the view to
+	values, the first pixel of each row stride values after the first of the one above.
+	returns the sum of the iteration counts */
+template <typename Formula, typename Real, typename Coloring>
+std::uint64_t iterateFractal(const FractalSettings &settings, const DeepView &view, int width, int height,
+	int x0, int y0, int x1, int y1, float *values, int stride)
+{
+	typedef decltype(Real() < Real()) Mask;
+	const int w = Real::width;
+	const FractalGrid grid(view, width, height);
+	const Real bailout(Coloring::getBailout());
+	const Real kx(settings.juliaX), ky(settings.juliaY);
+	const Mask one(1.0);
+	double hiX[w], loX[w], hiY[w], loY[w], n[w], r2[w];
+	int offsets[w];
+
+	// The lanes take the pixels in row order and wrap, as in iterateMandelbrot
+	const int columns = x1 - x0;
+	const int pixels = columns * (y1 - y0);
+	std::uint64_t sum = 0;
+	for(int p = 0; p < pixels; p += w)
+	{
+		for(int lane = 0; lane < w; ++lane)
+		{
+			int q = p + lane < pixels ? p + lane : pixels - 1;
+			int x = x0 + q % columns, y = y0 + q / columns;
+			grid.getPoint(x, y, hiX[lane], loX[lane], hiY[lane], loY[lane]);
+			offsets[lane] = (y - y0) * stride + (x - x0);
+		}
+
+		Real px, py, zx, zy, cx, cy;
+		loadLanes(hiX, loX, px);
+		loadLanes(hiY, loY, py);
+		Formula::start(zx, zy, cx, cy, px, py, kx, ky);
+
+		Mask count(0.0);
+		Mask active = Mask(0.0) < one; // every lane
+		typename Coloring::template Escape<Mask> escape;
+		for(int i = 0; i < view.maxIteration; ++i)
+		{
+			Real size = zx * zx + zy * zy;
+			Mask inside = size < bailout;
+			escape.record(andNot(inside, active), leading(size));
+			active = active & inside;
+			if(!any(active))
+				break;
+			count = count + (active & one);
+			Formula::step(zx, zy, cx, cy);
+		}
+
+		storeLanes(count, n);
+		escape.store(r2);
+		for(int lane = 0; lane < w && p + lane < pixels; ++lane)
+		{
+			values[offsets[lane]] = Coloring::getValue(n[lane], r2[lane], Formula::power, view.maxIteration);
+			sum += std::uint64_t(n[lane]);
+		}
+	}
+	return sum;
+}
+
+/* iterateFractal for some formula, number type and colouring */
+typedef std::uint64_t (*FractalKernel)(const FractalSettings &settings, const DeepView &view, int width, int height,
+	int x0, int y0, int x1, int y1, float *values, int stride);
+
+/* the instantiation of iterateFractal for the settings.
+	return nullptr if the power is out of range */
+FractalKernel getFractalKernel(const FractalSettings &settings);
+
+/* the values of every pixel, row by row, computed by all the workers.
+	returns the sum of the iteration counts */
+std::uint64_t computeFractal(const FractalSettings &settings, const DeepView &view, int width, int height,
+	std::vector<float> &values);
+
+/* the colours of the values, 3 bytes per pixel, with the ramp of colorMandelbrot */
+void colorFractal(const float *values, std::size_t count, int maxIteration, unsigned char *rgb);
+
+/* the #define lines that select the variant of data/fractal.fs for the settings */
+std::string getFractalDefines(const FractalSettings &settings, int maxIteration);
+
+/* the settings for a name: mandelbrot, julia, ship or multibrotN.
+	return false if the name is none of them */
+bool parseFractalFormula(const std::string &name, FractalSettings &settings);
+
+/* the name parseFractalFormula reads back */
+std::string getFractalName(const FractalSettings &settings);
+
+#endif
@@ -12,6 +12,35 @@ GLint Program::getUniformLoc(const std::string &s)
 	return i != uniforms.end() ? i->second : -1;
 }
 
+GLenum getIndexType(std::size_t vertexCount)
+{
+	return vertexCount <= 65536 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+GLenum uploadIndices(const std::vector<GLuint> &indices, std::size_t vertexCount, GLenum usage)
+{
+	return uploadIndices(indices.empty() ? NULL : &indices[0], indices.size(), vertexCount, usage);
+}
+
+GLenum uploadIndices(const GLuint *indices, std::size_t count, std::size_t vertexCount, GLenum usage)
+{
+	GLenum type = getIndexType(vertexCount);
+	if(count == 0)
+	{
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, 0, NULL, usage);
+	}
+	else if(type == GL_UNSIGNED_SHORT)
+	{
+		std::vector<GLushort> narrow(indices, indices + count);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, narrow.size() * sizeof(GLushort), &narrow[0], usage);
+	}
+	else
+	{
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(GLuint), indices, usage);
+	}
+	return type;
+}
+
 void IndexedVertexArray::addVertex(float x, float y, float z, float nx, float ny, float nz, float u, float v)
 {
 	positions.push_back(glm::vec3(x, y, z));
@@ -19,14 +48,14 @@ void IndexedVertexArray::addVertex(float x, float y, float z, float nx, float ny
 	texels.push_back(glm::vec2(u, v));
 }
 
-void IndexedVertexArray::addTriangle(GLushort i0, GLushort i1, GLushort i2)
+void IndexedVertexArray::addTriangle(GLuint i0, GLuint i1, GLuint i2)
 {
 	indices.push_back(i0);
 	indices.push_back(i1);
 	indices.push_back(i2);
 }
 
-void IndexedVertexArray::addQuad(GLushort i0, GLushort i1, GLushort i2, GLushort i3)
+void IndexedVertexArray::addQuad(GLuint i0, GLuint i1, GLuint i2, GLuint i3)
 {
 	addTriangle(i0, i1, i2);
 	addTriangle(i2, i3, i0);
@@ -34,6 +63,7 @@ void IndexedVertexArray::addQuad(GLushort i0, GLushort i1, GLushort i2, GLushort
 
 void IndexedVertexArray::clear()
 {
+	indices.clear();
 	positions.clear();
 	normals.clear();
 	texels.clear();
@@ -18,19 +18,30 @@ struct Program
 	GLint getUniformLoc(const std::string &s);
 };
 
+/* returns GL_UNSIGNED_SHORT if every index of a mesh with vertexCount vertices
+	fits in 16 bits, GL_UNSIGNED_INT otherwise */
+GLenum getIndexType(std::size_t vertexCount);
+
+/* uploads the indices to the currently bound element array buffer, narrowed to 16 bits
+	when getIndexType(vertexCount) allows it, so small meshes keep the bandwidth savings.
+	returns the index type to pass to glDrawElements */
+GLenum uploadIndices(const std::vector<GLuint> &indices, std::size_t vertexCount, GLenum usage);
+GLenum uploadIndices(const GLuint *indices, std::size_t count, std::size_t vertexCount, GLenum usage);
+
 class IndexedVertexArray
 {
 public:
-	std::vector<GLushort> indices;
+	std::vector<GLuint> indices;
 	std::vector<glm::vec3> positions;
 	std::vector<glm::vec3> normals;
 	std::vector<glm::vec2> texels;
 
 	void clear();
 	void addVertex(float x, float y, float z, float nx, float ny, float nz, float u, float v);
-	void addTriangle(GLushort i0, GLushort i1, GLushort i2);
-	void addQuad(GLushort i0, GLushort i1, GLushort i2, GLushort i3);
-	GLushort getLastVertexIndex() const { return positions.size() - 1; }
+	void addTriangle(GLuint i0, GLuint i1, GLuint i2);
+	void addQuad(GLuint i0, GLuint i1, GLuint i2, GLuint i3);
+	GLuint getLastVertexIndex() const { return positions.size() - 1; }
+	GLenum getIndexType() const { return ::getIndexType(positions.size()); }
 };
 
 #endif
\ No newline at end of file
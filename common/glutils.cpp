@@ -79,6 +79,16 @@ GLuint getShader(GLenum shaderType, const std::string &shaderSrc)
 	return shader;
 }
 
+std::string addShaderDefines(const std::string &shaderSrc, const std::string &defines)
+{
+	if(shaderSrc.compare(0, 8, "#version") != 0)
+		return defines + shaderSrc;
+	std::size_t end = shaderSrc.find('\n');
+	if(end == std::string::npos)
+		return shaderSrc + "\n" + defines;
+	return shaderSrc.substr(0, end + 1) + defines + shaderSrc.substr(end + 1);
+}
+
 GLuint getProgram(GLuint vertexShader, GLuint fragmentShader, GLuint geometryShader)
 {
 	GLuint program = glCreateProgram();
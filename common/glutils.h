@@ -48,6 +48,10 @@ int depth = 24, int stencil = 8, int fsaa = 0, bool fullscreen = false);
 	return 0 otherwise */
 GLuint getShader(GLenum shaderType, const std::string &shaderSrc);
 
+/* the shader source with the lines of defines after its #version line, which has to come first.
+	return the source with the defines at the start if it has none */
+std::string addShaderDefines(const std::string &shaderSrc, const std::string &defines);
+
 /* compile a program using the vertex, fragment and optional geometry shader objects.
 	return the program if link was successful.
 	return 0 otherwise */
@@ -0,0 +1,186 @@
+#include "imagefile.h"
+#include <algorithm>
+#include <cctype>
+#include <vector>
+
+static bool hasExtension(const std::string &filename, const std::string &extension)
+{
+	if(filename.size() < extension.size())
+		return false;
+	std::string end = filename.substr(filename.size() - extension.size());
+	std::transform(end.begin(), end.end(), end.begin(), ::tolower);
+	return end == extension;
+}
+
+static void putBigEndian(std::vector<unsigned char> &out, std::uint32_t value)
+{
+	for(int shift = 24; shift >= 0; shift -= 8)
+		out.push_back((unsigned char)(value >> shift));
+}
+
+static std::uint32_t updateCrc(std::uint32_t crc, const unsigned char *data, std::size_t size)
+{
+	static std::uint32_t table[256];
+	static bool tableReady = false;
+	if(!tableReady)
+	{
+		for(std::uint32_t n = 0; n < 256; ++n)
+		{
+			std::uint32_t c = n;
+			for(int k = 0; k < 8; ++k)
+				c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+			table[n] = c;
+		}
+		tableReady = true;
+	}
+	for(std::size_t i = 0; i < size; ++i)
+		crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	return crc;
+}
+
+static std::uint32_t updateAdler(std::uint32_t adler, const unsigned char *data, std::size_t size)
+{
+	// 5552 bytes is the most that can be summed before the sums can overflow
+	std::uint32_t a = adler & 0xffff, b = adler >> 16;
+	while(size > 0)
+	{
+		std::size_t count = std::min<std::size_t>(size, 5552);
+		for(std::size_t i = 0; i < count; ++i)
+		{
+			a += data[i];
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+		data += count;
+		size -= count;
+	}
+	return (b << 16) | a;
+}
+
+ImageFileWriter::ImageFileWriter() : png(false), width(0), height(0), rowsWritten(0), adler(1)
+{
+}
+
+ImageFileWriter::~ImageFileWriter()
+{
+	if(file.is_open())
+		close();
+}
+
+bool ImageFileWriter::open(const std::string &filename, int width, int height)
+{
+	this->width = width;
+	this->height = height;
+	rowsWritten = 0;
+	adler = 1;
+	png = hasExtension(filename, ".png");
+	if(!png && !hasExtension(filename, ".ppm"))
+		return false;
+
+	file.open(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if(!file.is_open())
+		return false;
+
+	if(!png)
+	{
+		file<<"P6\n"<<width<<" "<<height<<"\n255\n";
+		return file.good();
+	}
+
+	const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	file.write((const char*)signature, sizeof(signature));
+	std::vector<unsigned char> header;
+	putBigEndian(header, std::uint32_t(width));
+	putBigEndian(header, std::uint32_t(height));
+	const unsigned char format[5] = { 8, 2, 0, 0, 0 }; // 8 bit RGB, deflate, no filtering, not interlaced
+	header.insert(header.end(), format, format + 5);
+	writeChunk("IHDR", &header[0], header.size());
+
+	// The zlib header. It declares the usual 32K window, though stored blocks never refer back
+	const unsigned char zlibHeader[2] = { 0x78, 0x01 };
+	writeChunk("IDAT", zlibHeader, sizeof(zlibHeader));
+	return file.good();
+}
+
+void ImageFileWriter::writeRows(const unsigned char *rgb, int rows)
+{
+	rows = std::min(rows, height - rowsWritten);
+	if(rows <= 0)
+		return;
+	rowsWritten += rows;
+	std::size_t rowBytes = std::size_t(width) * 3;
+	if(!png)
+	{
+		file.write((const char*)rgb, rowBytes * rows);
+		return;
+	}
+
+	// Every row starts with its filter type, none
+	std::vector<unsigned char> raw;
+	raw.reserve((rowBytes + 1) * rows);
+	for(int y = 0; y < rows; ++y)
+	{
+		raw.push_back(0);
+		raw.insert(raw.end(), rgb + y * rowBytes, rgb + (y + 1) * rowBytes);
+	}
+	adler = updateAdler(adler, &raw[0], raw.size());
+
+	// Stored deflate blocks hold at most 65535 bytes, the last one is written by close
+	std::vector<unsigned char> blocks;
+	blocks.reserve(raw.size() + (raw.size() / 65535 + 1) * 5);
+	for(std::size_t i = 0; i < raw.size(); i += 65535)
+	{
+		std::size_t size = std::min<std::size_t>(65535, raw.size() - i);
+		const unsigned char header[5] = { 0, (unsigned char)size, (unsigned char)(size >> 8),
+			(unsigned char)~size, (unsigned char)(~size >> 8) };
+		blocks.insert(blocks.end(), header, header + 5);
+		blocks.insert(blocks.end(), raw.begin() + i, raw.begin() + i + size);
+	}
+	// The length of a chunk has 31 bits, a PNG can have any number of IDAT chunks
+	const std::size_t maxChunkSize = std::size_t(1) << 30;
+	for(std::size_t i = 0; i < blocks.size(); i += maxChunkSize)
+		writeChunk("IDAT", &blocks[i], std::min(maxChunkSize, blocks.size() - i));
+}
+
+bool ImageFileWriter::close()
+{
+	bool ok = rowsWritten == height;
+	if(png)
+	{
+		std::vector<unsigned char> end;
+		const unsigned char finalBlock[5] = { 1, 0, 0, 0xff, 0xff };
+		end.insert(end.end(), finalBlock, finalBlock + 5);
+		putBigEndian(end, adler);
+		writeChunk("IDAT", &end[0], end.size());
+		writeChunk("IEND", NULL, 0);
+	}
+	ok = ok && file.good();
+	file.close();
+	return ok;
+}
+
+void ImageFileWriter::writeChunk(const char *type, const unsigned char *data, std::size_t size)
+{
+	std::vector<unsigned char> length;
+	putBigEndian(length, std::uint32_t(size));
+	file.write((const char*)&length[0], 4);
+	file.write(type, 4);
+	if(size > 0)
+		file.write((const char*)data, size);
+
+	std::uint32_t crc = updateCrc(0xffffffffu, (const unsigned char*)type, 4);
+	crc = updateCrc(crc, data, size) ^ 0xffffffffu;
+	std::vector<unsigned char> checksum;
+	putBigEndian(checksum, crc);
+	file.write((const char*)&checksum[0], 4);
+}
+
+bool writeImageFile(const std::string &filename, int width, int height, const unsigned char *rgb)
+{
+	ImageFileWriter writer;
+	if(!writer.open(filename, width, height))
+		return false;
+	writer.writeRows(rgb, height);
+	return writer.close();
+}
@@ -0,0 +1,60 @@
+/*
+OpenGL examples - Image files
+
+Writes 8 bit RGB images, row by row from the top, as
+	.ppm	binary portable pixmap (P6)
+	.png	PNG whose image data is stored rather than compressed, so no zlib is needed.
+			The files are as large as the raw pixels, but every viewer reads them
+chosen by the extension of the filename. ImageFileWriter takes the rows in bands as
+they are produced, so an image never has to be in memory as a whole, and keeps only
+the running checksums of the PNG between bands.
+*/
+
+#ifndef IMAGE_FILE_H
+#define IMAGE_FILE_H
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+class ImageFileWriter
+{
+public:
+	ImageFileWriter();
+	~ImageFileWriter();
+
+	/* creates the file and writes its header.
+		return false if the file could not be created or the extension is neither .png nor .ppm */
+	bool open(const std::string &filename, int width, int height);
+
+	/* appends rows of width * 3 bytes each */
+	void writeRows(const unsigned char *rgb, int rows);
+
+	/* ends the file and closes it.
+		return false if any write failed or fewer rows than the height were written */
+	bool close();
+
+	int getRowsWritten() const { return rowsWritten; }
+
+	/* false once a write has failed */
+	bool isGood() const { return file.good(); }
+
+private:
+	ImageFileWriter(const ImageFileWriter &);
+	ImageFileWriter &operator=(const ImageFileWriter &);
+
+	void writeChunk(const char *type, const unsigned char *data, std::size_t size);
+
+	std::ofstream file;
+	bool png;
+	int width;
+	int height;
+	int rowsWritten;
+	std::uint32_t adler;
+};
+
+/* writes a whole width x height image of 3 bytes per pixel.
+	return true if successful.
+	return false otherwise */
+bool writeImageFile(const std::string &filename, int width, int height, const unsigned char *rgb);
+
+#endif
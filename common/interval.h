@@ -0,0 +1,77 @@
+/*
+OpenGL examples - Interval arithmetic
+
+An Interval [lo, hi] behaves like a float under + - * /, min, max, abs, sqrt and square(), but
+the result bounds every value the expression can take when each operand
+varies within its interval. Evaluating a field template (see field.h) on
+the intervals spanned by a box therefore bounds the field over the box.
+The bounds are not outward rounded, which is fine for culling at the
+tolerances used by the examples.
+*/
+
+#ifndef INTERVAL_H
+#define INTERVAL_H
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+struct Interval
+{
+	float lo;
+	float hi;
+
+	Interval() { }
+	Interval(float s) : lo(s), hi(s) { }
+	Interval(float l, float h) : lo(l), hi(h) { }
+
+	bool contains(float s) const { return lo <= s && s <= hi; }
+};
+
+inline Interval operator+(const Interval &a, const Interval &b) { return Interval(a.lo + b.lo, a.hi + b.hi); }
+inline Interval operator-(const Interval &a, const Interval &b) { return Interval(a.lo - b.hi, a.hi - b.lo); }
+inline Interval operator-(const Interval &a) { return Interval(-a.hi, -a.lo); }
+
+inline Interval operator*(const Interval &a, const Interval &b)
+{
+	float p0 = a.lo * b.lo;
+	float p1 = a.lo * b.hi;
+	float p2 = a.hi * b.lo;
+	float p3 = a.hi * b.hi;
+	return Interval(std::min(std::min(p0, p1), std::min(p2, p3)), std::max(std::max(p0, p1), std::max(p2, p3)));
+}
+
+/* the whole real line if b contains 0 */
+inline Interval operator/(const Interval &a, const Interval &b)
+{
+	if(b.lo <= 0.0f && b.hi >= 0.0f)
+		return Interval(-std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity());
+	return a * Interval(1.0f / b.hi, 1.0f / b.lo);
+}
+
+inline Interval min(const Interval &a, const Interval &b) { return Interval(std::min(a.lo, b.lo), std::min(a.hi, b.hi)); }
+inline Interval max(const Interval &a, const Interval &b) { return Interval(std::max(a.lo, b.lo), std::max(a.hi, b.hi)); }
+
+inline Interval abs(const Interval &a)
+{
+	if(a.lo >= 0.0f) return a;
+	if(a.hi <= 0.0f) return -a;
+	return Interval(0.0f, std::max(-a.lo, a.hi));
+}
+
+/* the negative part of a is ignored */
+inline Interval sqrt(const Interval &a)
+{
+	return Interval(std::sqrt(std::max(a.lo, 0.0f)), std::sqrt(std::max(a.hi, 0.0f)));
+}
+
+/* tighter than a * a, which cannot know that both operands are the same value */
+inline Interval square(const Interval &a)
+{
+	float l = a.lo * a.lo;
+	float h = a.hi * a.hi;
+	if(a.lo >= 0.0f) return Interval(l, h);
+	if(a.hi <= 0.0f) return Interval(h, l);
+	return Interval(0.0f, std::max(l, h));
+}
+
+#endif
@@ -0,0 +1,800 @@
+#include "isosurface.h"
+#include "parallel.h"
+#include <algorithm>
+using namespace glm;
+
+static void resetGrid(SampleGrid &grid, int resolution, float min, float max)
+{
+	grid.resolution = resolution;
+	grid.min = min;
+	grid.max = max;
+	grid.brickSlots.assign(grid.brickCount(), -1);
+	grid.brickFill.assign(grid.brickCount(), 0.0f);
+	grid.samples.clear();
+}
+
+// Evaluates the brickVolume points of the brick. Bricks at the far end of the lattice stick
+// out of it, those points are evaluated anyway so that each plane is a full batch.
+static void sampleBrick(const SampleGrid &grid, const SurfaceField &field, int brick, float *out)
+{
+	const int b = SampleGrid::brickSize;
+	int nb = grid.bricksPerAxis();
+	int sx0 = (brick / (nb * nb)) * b;
+	int sy0 = ((brick / nb) % nb) * b;
+	int sz0 = (brick % nb) * b;
+
+	// One batch per x plane of the brick, so per call costs are shared by b * b points
+	float xs[b * b], ys[b * b], zs[b * b];
+	for(int j = 0; j < b; ++j)
+		for(int k = 0; k < b; ++k)
+		{
+			ys[j * b + k] = grid.position(sy0 + j - 1);
+			zs[j * b + k] = grid.position(sz0 + k - 1);
+		}
+	for(int i = 0; i < b; ++i, out += b * b)
+	{
+		std::fill(xs, xs + b * b, grid.position(sx0 + i - 1));
+		field.evaluateBatch(xs, ys, zs, out, b * b);
+	}
+}
+
+// Samples every listed brick into consecutive slots
+static void sampleBricks(SampleGrid &grid, const SurfaceField &field, const std::vector<int> &bricks)
+{
+	grid.samples.resize(bricks.size() * SampleGrid::brickVolume);
+	parallelFor(int(bricks.size()), [&](int slot)
+	{
+		grid.brickSlots[bricks[slot]] = slot;
+		sampleBrick(grid, field, bricks[slot], &grid.samples[std::size_t(slot) * SampleGrid::brickVolume]);
+	});
+}
+
+void sampleGrid(SampleGrid &grid, const SurfaceField &field, int resolution, float min, float max)
+{
+	resetGrid(grid, resolution, min, max);
+	std::vector<int> bricks(grid.brickCount());
+	for(int i = 0; i < grid.brickCount(); ++i)
+		bricks[i] = i;
+	sampleBricks(grid, field, bricks);
+}
+
+// Recursively visits the octree node covering bricks [b0, b0 + span)^3. Nodes whose field
+// bounds exclude [-epsilon, epsilon] are filled, surviving single bricks are collected.
+// The bounds are taken over the node expanded by one lattice step, so the neighbours of
+// a filled point have the same sign as it, and no sign change ever involves a filled point.
+static void cullNode(SampleGrid &grid, const SurfaceField &field, float epsilon,
+int bx0, int by0, int bz0, int span, std::vector<int> &survivors)
+{
+	int nb = grid.bricksPerAxis();
+	if(bx0 >= nb || by0 >= nb || bz0 >= nb)
+		return;
+	int bx1 = std::min(bx0 + span, nb);
+	int by1 = std::min(by0 + span, nb);
+	int bz1 = std::min(bz0 + span, nb);
+
+	// Storage index s is lattice point s - 1
+	const int b = SampleGrid::brickSize;
+	Interval x(grid.position(bx0 * b - 2), grid.position(bx1 * b - 1));
+	Interval y(grid.position(by0 * b - 2), grid.position(by1 * b - 1));
+	Interval z(grid.position(bz0 * b - 2), grid.position(bz1 * b - 1));
+	Interval f = field.evaluateInterval(x, y, z);
+	if(f.lo > epsilon || f.hi < -epsilon)
+	{
+		float fill = f.lo > epsilon ? f.lo : f.hi;
+		for(int bx = bx0; bx < bx1; ++bx)
+			for(int by = by0; by < by1; ++by)
+				for(int bz = bz0; bz < bz1; ++bz)
+					grid.brickFill[grid.brickIndex(bx, by, bz)] = fill;
+		return;
+	}
+
+	if(span == 1)
+	{
+		survivors.push_back(grid.brickIndex(bx0, by0, bz0));
+		return;
+	}
+
+	int h = span / 2;
+	for(int i = 0; i < 8; ++i)
+		cullNode(grid, field, epsilon, bx0 + (i & 1) * h, by0 + ((i >> 1) & 1) * h, bz0 + ((i >> 2) & 1) * h, h, survivors);
+}
+
+void sampleGridCulled(SampleGrid &grid, const SurfaceField &field, int resolution, float min, float max, float epsilon)
+{
+	if(!field.evaluateInterval)
+	{
+		sampleGrid(grid, field, resolution, min, max);
+		return;
+	}
+
+	resetGrid(grid, resolution, min, max);
+	int span = 1;
+	while(span < grid.bricksPerAxis())
+		span *= 2;
+	std::vector<int> survivors;
+	cullNode(grid, field, epsilon, 0, 0, 0, span, survivors);
+
+	// Keep the slots in brick order, the meshers walk the bricks in that order
+	std::sort(survivors.begin(), survivors.end());
+	sampleBricks(grid, field, survivors);
+}
+
+void resampleRegion(SampleGrid &grid, const SurfaceField &field,
+const vec3 &boxMin, const vec3 &boxMax, std::vector<int> &changed)
+{
+	const int b = SampleGrid::brickSize;
+	int nb = grid.bricksPerAxis();
+
+	// Brick k holds the lattice points k * b - 1 to k * b + b - 2, resample it if those
+	// points expanded by one step overlap the lattice span of the box
+	int first[3], last[3];
+	for(int a = 0; a < 3; ++a)
+	{
+		int lo = int(std::floor((boxMin[a] - grid.min) / grid.blockSize()));
+		int hi = int(std::ceil((boxMax[a] - grid.min) / grid.blockSize()));
+		first[a] = nb;
+		last[a] = -1;
+		for(int k = 0; k < nb; ++k)
+		{
+			if(k * b - 2 <= hi && k * b + b - 1 >= lo)
+			{
+				first[a] = std::min(first[a], k);
+				last[a] = k;
+			}
+		}
+	}
+
+	std::vector<int> bricks;
+	std::vector<unsigned char> wasSampled;
+	for(int bx = first[0]; bx <= last[0]; ++bx)
+		for(int by = first[1]; by <= last[1]; ++by)
+			for(int bz = first[2]; bz <= last[2]; ++bz)
+			{
+				int brick = grid.brickIndex(bx, by, bz);
+				bricks.push_back(brick);
+				wasSampled.push_back(grid.isSampled(brick));
+				if(!grid.isSampled(brick))
+				{
+					grid.brickSlots[brick] = grid.sampledBrickCount();
+					grid.samples.resize(grid.samples.size() + SampleGrid::brickVolume);
+				}
+			}
+
+	std::vector<unsigned char> brickChanged(bricks.size(), 0);
+	parallelFor(int(bricks.size()), [&](int i)
+	{
+		float fresh[SampleGrid::brickVolume];
+		sampleBrick(grid, field, bricks[i], fresh);
+		float *stored = &grid.samples[std::size_t(grid.brickSlots[bricks[i]]) * SampleGrid::brickVolume];
+		for(int j = 0; j < SampleGrid::brickVolume; ++j)
+		{
+			float old = wasSampled[i] ? stored[j] : grid.brickFill[bricks[i]];
+			if(fresh[j] != old)
+				brickChanged[i] = 1;
+			stored[j] = fresh[j];
+		}
+	});
+
+	changed.clear();
+	for(std::size_t i = 0; i < bricks.size(); ++i)
+		if(brickChanged[i])
+			changed.push_back(bricks[i]);
+}
+
+// Appends a clockwise oriented quad to the list of positions and indices
+static void addQuad(const vec3 &v0, const vec3 &v1, const vec3 &v2, const vec3 &v3,
+std::vector<vec3> &positions, std::vector<GLuint> &indices)
+{
+	GLuint i = positions.size();
+	positions.push_back(v0);
+	positions.push_back(v1);
+	positions.push_back(v2);
+	positions.push_back(v3);
+	indices.push_back(i + 0);
+	indices.push_back(i + 1);
+	indices.push_back(i + 2);
+	indices.push_back(i + 2);
+	indices.push_back(i + 3);
+	indices.push_back(i + 0);
+}
+
+// Polygonizes the lattice points inside the given brick
+static void polygonizeVoxelBrick(const SampleGrid &grid, float epsilon, int brick,
+std::vector<vec3> &positions, std::vector<GLuint> &indices)
+{
+	const int b = SampleGrid::brickSize;
+	int nb = grid.bricksPerAxis();
+	int res = grid.resolution;
+	int gx0 = (brick / (nb * nb)) * b - 1;
+	int gy0 = ((brick / nb) % nb) * b - 1;
+	int gz0 = (brick % nb) * b - 1;
+	float h = grid.blockSize() / 2.0f;
+	for(int gx = std::max(gx0, 0); gx < std::min(gx0 + b, res + 1); ++gx)
+	{
+		for(int gy = std::max(gy0, 0); gy < std::min(gy0 + b, res + 1); ++gy)
+		{
+			for(int gz = std::max(gz0, 0); gz < std::min(gz0 + b, res + 1); ++gz)
+			{
+				// We approximate the level surface f(x, y, z) = 0 by
+				// adding voxels where |f(x, y, z)| <= epsilon
+				if(std::abs(grid.at(gx, gy, gz)) > epsilon)
+					continue;
+
+				float x = grid.position(gx);
+				float y = grid.position(gy);
+				float z = grid.position(gz);
+
+				// Front facing orientation is clockwise, a face is only added
+				// if the neighbouring voxel on that side is empty
+				// Front and back
+				if(std::abs(grid.at(gx, gy, gz + 1)) > epsilon)
+					addQuad(vec3(x-h, y-h, z+h), vec3(x-h, y+h, z+h), vec3(x+h, y+h, z+h), vec3(x+h, y-h, z+h), positions, indices);
+				if(std::abs(grid.at(gx, gy, gz - 1)) > epsilon)
+					addQuad(vec3(x-h, y-h, z-h), vec3(x+h, y-h, z-h), vec3(x+h, y+h, z-h), vec3(x-h, y+h, z-h), positions, indices);
+
+				// Top and bottom
+				if(std::abs(grid.at(gx, gy + 1, gz)) > epsilon)
+					addQuad(vec3(x-h, y+h, z+h), vec3(x-h, y+h, z-h), vec3(x+h, y+h, z-h), vec3(x+h, y+h, z+h), positions, indices);
+				if(std::abs(grid.at(gx, gy - 1, gz)) > epsilon)
+					addQuad(vec3(x-h, y-h, z+h), vec3(x+h, y-h, z+h), vec3(x+h, y-h, z-h), vec3(x-h, y-h, z-h), positions, indices);
+
+				// Left and right
+				if(std::abs(grid.at(gx - 1, gy, gz)) > epsilon)
+					addQuad(vec3(x-h, y-h, z-h), vec3(x-h, y+h, z-h), vec3(x-h, y+h, z+h), vec3(x-h, y-h, z+h), positions, indices);
+				if(std::abs(grid.at(gx + 1, gy, gz)) > epsilon)
+					addQuad(vec3(x+h, y-h, z+h), vec3(x+h, y+h, z+h), vec3(x+h, y+h, z-h), vec3(x+h, y-h, z-h), positions, indices);
+			}
+		}
+	}
+}
+
+// Bricks that were not sampled are bounded away from the surface and contain no voxels
+static void getSampledBricks(const SampleGrid &grid, std::vector<int> &bricks)
+{
+	bricks.clear();
+	for(int brick = 0; brick < grid.brickCount(); ++brick)
+		if(grid.isSampled(brick))
+			bricks.push_back(brick);
+}
+
+void polygonizeVoxels(const SampleGrid &grid, float epsilon,
+std::vector<vec3> &positions, std::vector<GLuint> &indices)
+{
+	std::vector<int> bricks;
+	getSampledBricks(grid, bricks);
+	positions.clear();
+	indices.clear();
+	for(std::size_t i = 0; i < bricks.size(); ++i)
+		polygonizeVoxelBrick(grid, epsilon, bricks[i], positions, indices);
+}
+
+// Concatenating the bricks in order reproduces the serial loop order,
+// so only the indices need to be offset when stitching.
+void polygonizeVoxelsParallel(const SampleGrid &grid, float epsilon,
+std::vector<vec3> &positions, std::vector<GLuint> &indices)
+{
+	std::vector<int> bricks;
+	getSampledBricks(grid, bricks);
+	int brickCount = int(bricks.size());
+	std::vector< std::vector<vec3> > brickPositions(brickCount);
+	std::vector< std::vector<GLuint> > brickIndices(brickCount);
+	parallelFor(brickCount, [&](int i)
+	{
+		polygonizeVoxelBrick(grid, epsilon, bricks[i], brickPositions[i], brickIndices[i]);
+	});
+
+	std::size_t vertexCount = 0;
+	std::size_t indexCount = 0;
+	for(int i = 0; i < brickCount; ++i)
+	{
+		vertexCount += brickPositions[i].size();
+		indexCount += brickIndices[i].size();
+	}
+
+	positions.clear();
+	indices.clear();
+	positions.reserve(vertexCount);
+	indices.reserve(indexCount);
+	for(int i = 0; i < brickCount; ++i)
+	{
+		GLuint offset = positions.size();
+		positions.insert(positions.end(), brickPositions[i].begin(), brickPositions[i].end());
+		for(std::size_t j = 0; j < brickIndices[i].size(); ++j)
+			indices.push_back(brickIndices[i][j] + offset);
+	}
+}
+
+// Corner c of a cell is offset by (c & 1, (c >> 1) & 1, (c >> 2) & 1) from its minimum corner.
+// The cube edges are numbered by axis, edge e runs along axis e / 4 from its first corner.
+static const int cubeEdgeCorners[12][2] = {
+	{0, 1}, {2, 3}, {4, 5}, {6, 7},
+	{0, 2}, {1, 3}, {4, 6}, {5, 7},
+	{0, 4}, {1, 5}, {2, 6}, {3, 7}
+};
+
+static vec3 cornerOffset(int c)
+{
+	return vec3(float(c & 1), float((c >> 1) & 1), float((c >> 2) & 1));
+}
+
+// Samples the corners of the cell and returns the mask of corners inside the surface (f < 0)
+static int getCellCorners(const SampleGrid &grid, int gx, int gy, int gz, float f[8])
+{
+	int mask = 0;
+	for(int c = 0; c < 8; ++c)
+	{
+		f[c] = grid.at(gx + (c & 1), gy + ((c >> 1) & 1), gz + ((c >> 2) & 1));
+		if(f[c] < 0.0f)
+			mask |= 1 << c;
+	}
+	return mask;
+}
+
+// Visits the cells whose minimum corner lies in a sampled brick. A cell whose minimum corner
+// was culled has all its corners on the same side of the surface (see cullNode).
+template <typename Visit>
+static void forEachSampledCell(const SampleGrid &grid, const Visit &visit)
+{
+	const int b = SampleGrid::brickSize;
+	int nb = grid.bricksPerAxis();
+	int res = grid.resolution;
+	for(int brick = 0; brick < grid.brickCount(); ++brick)
+	{
+		if(!grid.isSampled(brick))
+			continue;
+		int gx0 = (brick / (nb * nb)) * b - 1;
+		int gy0 = ((brick / nb) % nb) * b - 1;
+		int gz0 = (brick % nb) * b - 1;
+		for(int gx = std::max(gx0, 0); gx < std::min(gx0 + b, res); ++gx)
+			for(int gy = std::max(gy0, 0); gy < std::min(gy0 + b, res); ++gy)
+				for(int gz = std::max(gz0, 0); gz < std::min(gz0 + b, res); ++gz)
+					visit(gx, gy, gz);
+	}
+}
+
+static void addQuadIndices(GLuint i0, GLuint i1, GLuint i2, GLuint i3, std::vector<GLuint> &indices)
+{
+	indices.push_back(i0);
+	indices.push_back(i1);
+	indices.push_back(i2);
+	indices.push_back(i2);
+	indices.push_back(i3);
+	indices.push_back(i0);
+}
+
+void polygonizeSurfaceNets(const SampleGrid &grid,
+std::vector<vec3> &positions, std::vector<GLuint> &indices)
+{
+	positions.clear();
+	indices.clear();
+	float s = grid.blockSize();
+
+	// Place one vertex in every cell crossed by the surface
+	std::vector<int> cellVertices(grid.samples.size(), -1);
+	forEachSampledCell(grid, [&](int gx, int gy, int gz)
+	{
+		float f[8];
+		int mask = getCellCorners(grid, gx, gy, gz, f);
+		if(mask == 0 || mask == 255)
+			return;
+
+		vec3 sum(0.0f);
+		int crossings = 0;
+		for(int e = 0; e < 12; ++e)
+		{
+			int c0 = cubeEdgeCorners[e][0];
+			int c1 = cubeEdgeCorners[e][1];
+			if(((mask >> c0) & 1) == ((mask >> c1) & 1))
+				continue;
+			float t = f[c0] / (f[c0] - f[c1]);
+			sum += mix(cornerOffset(c0), cornerOffset(c1), t);
+			++crossings;
+		}
+
+		cellVertices[grid.sampleIndex(gx, gy, gz)] = positions.size();
+		positions.push_back(vec3(grid.position(gx), grid.position(gy), grid.position(gz)) + sum * (s / float(crossings)));
+	});
+
+	// Join the four cells around every crossed lattice edge. The edge from p along axis a
+	// is shared by the cells p, p - u, p - u - v and p - v, where u and v are the other axes.
+	int res = grid.resolution;
+	forEachSampledCell(grid, [&](int gx, int gy, int gz)
+	{
+		int p[3] = { gx, gy, gz };
+		bool inside = grid.at(gx, gy, gz) < 0.0f;
+		for(int a = 0; a < 3; ++a)
+		{
+			int u = (a + 1) % 3;
+			int v = (a + 2) % 3;
+			if(p[u] < 1 || p[v] < 1 || p[u] >= res || p[v] >= res)
+				continue;
+
+			int q[3] = { gx, gy, gz };
+			q[a] += 1;
+			if((grid.at(q[0], q[1], q[2]) < 0.0f) == inside)
+				continue;
+
+			int c[4][3];
+			for(int k = 0; k < 4; ++k)
+			{
+				c[k][a] = p[a];
+				c[k][u] = p[u] - (k == 1 || k == 2 ? 1 : 0);
+				c[k][v] = p[v] - (k >= 2 ? 1 : 0);
+			}
+			GLuint i[4];
+			for(int k = 0; k < 4; ++k)
+				i[k] = cellVertices[grid.sampleIndex(c[k][0], c[k][1], c[k][2])];
+
+			// Wind the quad clockwise as seen from outside (f > 0)
+			if(inside)
+				addQuadIndices(i[0], i[3], i[2], i[1], indices);
+			else
+				addQuadIndices(i[0], i[1], i[2], i[3], indices);
+		}
+	});
+}
+
+// Marching cubes triangles for each of the 256 corner masks, as triples of cube edges
+// terminated by -1. The table is derived rather than spelled out: on every face of the cube
+// each run of consecutive inside corners is cut off by a segment between the two crossed
+// edges around it. The two inside corners of an ambiguous face are thus always separated,
+// so neighbouring cells split their shared face the same way. The segments of the six faces
+// form closed polygons, which are fanned into triangles wound clockwise as seen from outside.
+struct MarchingCubesTable
+{
+	signed char triangles[256][16];
+
+	MarchingCubesTable()
+	{
+		// The corners of each face in counterclockwise order seen from outside the cube
+		int faces[6][4];
+		for(int a = 0; a < 3; ++a)
+		{
+			int u = 1 << ((a + 1) % 3);
+			int v = 1 << ((a + 2) % 3);
+			int ccw[4] = { 0, u, u | v, v };
+			for(int k = 0; k < 4; ++k)
+			{
+				faces[2 * a + 1][k] = ccw[k] | (1 << a);
+				faces[2 * a][k] = ccw[3 - k];
+			}
+		}
+
+		for(int mask = 0; mask < 256; ++mask)
+		{
+			int next[12];
+			for(int e = 0; e < 12; ++e)
+				next[e] = -1;
+
+			for(int face = 0; face < 6; ++face)
+			{
+				const int *fc = faces[face];
+				bool in[4];
+				for(int k = 0; k < 4; ++k)
+					in[k] = ((mask >> fc[k]) & 1) != 0;
+				for(int k = 0; k < 4; ++k)
+				{
+					if(!in[k] || in[(k + 3) % 4])
+						continue;
+					int j = k;
+					while(in[(j + 1) % 4])
+						j = (j + 1) % 4;
+					next[getEdge(fc[(k + 3) % 4], fc[k])] = getEdge(fc[j], fc[(j + 1) % 4]);
+				}
+			}
+
+			int count = 0;
+			bool visited[12] = { false };
+			for(int e = 0; e < 12; ++e)
+			{
+				if(next[e] < 0 || visited[e])
+					continue;
+				int polygon[12];
+				int n = 0;
+				for(int i = e; !visited[i]; i = next[i])
+				{
+					visited[i] = true;
+					polygon[n++] = i;
+				}
+				for(int k = 1; k + 1 < n; ++k)
+				{
+					triangles[mask][count++] = polygon[0];
+					triangles[mask][count++] = polygon[k + 1];
+					triangles[mask][count++] = polygon[k];
+				}
+			}
+			for(; count < 16; ++count)
+				triangles[mask][count] = -1;
+		}
+	}
+
+	static int getEdge(int c0, int c1)
+	{
+		for(int e = 0; e < 12; ++e)
+			if((cubeEdgeCorners[e][0] == c0 && cubeEdgeCorners[e][1] == c1) ||
+				(cubeEdgeCorners[e][0] == c1 && cubeEdgeCorners[e][1] == c0))
+				return e;
+		return -1;
+	}
+};
+
+void polygonizeMarchingCubes(const SampleGrid &grid,
+std::vector<vec3> &positions, std::vector<GLuint> &indices)
+{
+	static const MarchingCubesTable table;
+	positions.clear();
+	indices.clear();
+
+	// One vertex per crossed lattice edge, keyed by the edge's first point and axis
+	std::vector<int> edgeVertices(grid.samples.size() * 3, -1);
+	forEachSampledCell(grid, [&](int gx, int gy, int gz)
+	{
+		float f[8];
+		int mask = getCellCorners(grid, gx, gy, gz, f);
+		if(mask == 0 || mask == 255)
+			return;
+
+		const signed char *edges = table.triangles[mask];
+		for(int i = 0; edges[i] >= 0; ++i)
+		{
+			int e = edges[i];
+			int c0 = cubeEdgeCorners[e][0];
+			int c1 = cubeEdgeCorners[e][1];
+			int px = gx + (c0 & 1);
+			int py = gy + ((c0 >> 1) & 1);
+			int pz = gz + ((c0 >> 2) & 1);
+			int &vertex = edgeVertices[grid.sampleIndex(px, py, pz) * 3 + e / 4];
+			if(vertex < 0)
+			{
+				float t = f[c0] / (f[c0] - f[c1]);
+				vec3 p0(grid.position(px), grid.position(py), grid.position(pz));
+				vertex = positions.size();
+				positions.push_back(p0 + (cornerOffset(c1) - cornerOffset(c0)) * (t * grid.blockSize()));
+			}
+			indices.push_back(vertex);
+		}
+	});
+}
+
+void polygonizeMarchingCubesBrick(const SampleGrid &grid, int brick,
+std::vector<vec3> &positions, std::vector<GLuint> &indices)
+{
+	static const MarchingCubesTable table;
+	const int b = SampleGrid::brickSize;
+	positions.clear();
+	indices.clear();
+	if(!grid.isSampled(brick))
+		return;
+
+	int nb = grid.bricksPerAxis();
+	int res = grid.resolution;
+	int gx0 = (brick / (nb * nb)) * b - 1;
+	int gy0 = ((brick / nb) % nb) * b - 1;
+	int gz0 = (brick % nb) * b - 1;
+
+	// The edges start at most one point past the brick, key them locally
+	const int n = b + 1;
+	std::vector<int> edgeVertices(n * n * n * 3, -1);
+	for(int gx = std::max(gx0, 0); gx < std::min(gx0 + b, res); ++gx)
+		for(int gy = std::max(gy0, 0); gy < std::min(gy0 + b, res); ++gy)
+			for(int gz = std::max(gz0, 0); gz < std::min(gz0 + b, res); ++gz)
+			{
+				float f[8];
+				int mask = getCellCorners(grid, gx, gy, gz, f);
+				if(mask == 0 || mask == 255)
+					continue;
+
+				const signed char *edges = table.triangles[mask];
+				for(int i = 0; edges[i] >= 0; ++i)
+				{
+					int e = edges[i];
+					int c0 = cubeEdgeCorners[e][0];
+					int c1 = cubeEdgeCorners[e][1];
+					int px = gx + (c0 & 1);
+					int py = gy + ((c0 >> 1) & 1);
+					int pz = gz + ((c0 >> 2) & 1);
+					int &vertex = edgeVertices[(((px - gx0) * n + (py - gy0)) * n + (pz - gz0)) * 3 + e / 4];
+					if(vertex < 0)
+					{
+						float t = f[c0] / (f[c0] - f[c1]);
+						vec3 p0(grid.position(px), grid.position(py), grid.position(pz));
+						vertex = positions.size();
+						positions.push_back(p0 + (cornerOffset(c1) - cornerOffset(c0)) * (t * grid.blockSize()));
+					}
+					indices.push_back(vertex);
+				}
+			}
+}
+
+// A slice of the lattice at constant z, x fastest, and the vertices on the x and y edges
+// starting at each of its points
+struct StreamSlice
+{
+	std::vector<float> samples;
+	std::vector<GLuint> edgeVertices;
+};
+
+std::size_t polygonizeMarchingCubesStreaming(const SurfaceField &field, int resolution, float min, float max,
+const MeshChunkCallback &emit)
+{
+	static const MarchingCubesTable table;
+	static const GLuint noVertex = ~GLuint(0);
+	const int t = SampleGrid::brickSize; // cells per tile along x and y
+	int n = resolution + 1;
+	int tiles = (resolution + t - 1) / t;
+	float s = (max - min) / float(resolution);
+	auto position = [&](int g) { return min + (max - min) * (g / float(resolution)); };
+
+	// A slab tile is active unless its field is bounded away from 0, as the cells of an
+	// inactive tile have all their corners on the same side of the surface
+	auto cullSlab = [&](int z, std::vector<char> &active)
+	{
+		active.assign(tiles * tiles, z >= 0 && z < resolution);
+		if(z < 0 || z >= resolution || !field.evaluateInterval)
+			return;
+		Interval zi(position(z), position(z + 1));
+		parallelFor(tiles * tiles, [&](int tile)
+		{
+			int tx = tile % tiles;
+			int ty = tile / tiles;
+			Interval xi(position(tx * t), position(std::min(tx * t + t, resolution)));
+			Interval yi(position(ty * t), position(std::min(ty * t + t, resolution)));
+			Interval f = field.evaluateInterval(xi, yi, zi);
+			active[tile] = !(f.lo > 0.0f || f.hi < 0.0f);
+		});
+	};
+
+	// The tiles [k0, k1] containing lattice coordinate g, tiles share their border points
+	auto tileRange = [&](int g, int &k0, int &k1)
+	{
+		k1 = std::min(g / t, tiles - 1);
+		k0 = (g % t == 0 && g > 0) ? g / t - 1 : k1;
+	};
+
+	// Samples the points of slice z used by an active tile of the slab below or above it
+	auto sampleSlice = [&](int z, const std::vector<char> &below, const std::vector<char> &above, StreamSlice &slice)
+	{
+		parallelFor(n, [&](int y)
+		{
+			int ky0, ky1;
+			tileRange(y, ky0, ky1);
+			std::vector<float> xs(n), ys(n, position(y)), zs(n, position(z));
+			for(int x = 0; x < n; ++x)
+				xs[x] = position(x);
+
+			// Evaluate the points of each run of used tiles along the row
+			float *out = &slice.samples[std::size_t(y) * n];
+			for(int kx = 0; kx < tiles;)
+			{
+				int end = kx;
+				for(; end < tiles; ++end)
+				{
+					bool used = false;
+					for(int ky = ky0; ky <= ky1; ++ky)
+						used = used || below[ky * tiles + end] || above[ky * tiles + end];
+					if(!used)
+						break;
+				}
+				if(end > kx)
+				{
+					int x0 = kx * t;
+					int x1 = std::min(end * t, resolution);
+					field.evaluateBatch(&xs[x0], &ys[x0], &zs[x0], out + x0, x1 - x0 + 1);
+				}
+				kx = end + 1;
+			}
+		});
+	};
+
+	StreamSlice slices[2];
+	for(int i = 0; i < 2; ++i)
+	{
+		slices[i].samples.resize(std::size_t(n) * n);
+		slices[i].edgeVertices.assign(std::size_t(n) * n * 2, noVertex);
+	}
+	std::vector<GLuint> zEdgeVertices(std::size_t(n) * n, noVertex);
+	std::vector<char> previousActive, active, nextActive;
+	cullSlab(-1, previousActive);
+	cullSlab(0, active);
+	sampleSlice(0, previousActive, active, slices[0]);
+
+	MeshChunk chunk;
+	chunk.firstVertex = 0;
+	std::size_t vertexCount = 0;
+	for(int z = 0; z < resolution; ++z)
+	{
+		cullSlab(z + 1, nextActive);
+		sampleSlice(z + 1, active, nextActive, slices[1]);
+
+		for(int tile = 0; tile < tiles * tiles; ++tile)
+		{
+			if(!active[tile])
+				continue;
+			int x0 = (tile % tiles) * t;
+			int y0 = (tile / tiles) * t;
+			for(int y = y0; y < std::min(y0 + t, resolution); ++y)
+				for(int x = x0; x < std::min(x0 + t, resolution); ++x)
+				{
+					float f[8];
+					int mask = 0;
+					for(int c = 0; c < 8; ++c)
+					{
+						f[c] = slices[(c >> 2) & 1].samples[std::size_t(y + ((c >> 1) & 1)) * n + x + (c & 1)];
+						if(f[c] < 0.0f)
+							mask |= 1 << c;
+					}
+					if(mask == 0 || mask == 255)
+						continue;
+
+					const signed char *edges = table.triangles[mask];
+					for(int i = 0; edges[i] >= 0; ++i)
+					{
+						int e = edges[i];
+						int c0 = cubeEdgeCorners[e][0];
+						int c1 = cubeEdgeCorners[e][1];
+						int px = x + (c0 & 1);
+						int py = y + ((c0 >> 1) & 1);
+						int pz = (c0 >> 2) & 1;
+						std::size_t point = std::size_t(py) * n + px;
+						GLuint &vertex = e / 4 == 2 ? zEdgeVertices[point] : slices[pz].edgeVertices[point * 2 + e / 4];
+						if(vertex == noVertex)
+						{
+							float ft = f[c0] / (f[c0] - f[c1]);
+							vec3 p0(position(px), position(py), position(z + pz));
+							vertex = chunk.firstVertex + chunk.positions.size();
+							chunk.positions.push_back(p0 + (cornerOffset(c1) - cornerOffset(c0)) * (ft * s));
+						}
+						chunk.indices.push_back(vertex);
+					}
+				}
+		}
+
+		if(!chunk.indices.empty())
+		{
+			computeFieldNormals(field, 0.5f * s, chunk.positions, chunk.normals);
+			emit(chunk);
+			vertexCount += chunk.positions.size();
+			chunk.firstVertex = GLuint(vertexCount);
+			chunk.positions.clear();
+			chunk.normals.clear();
+			chunk.indices.clear();
+		}
+
+		// Slice z + 1 is the bottom of the next slab. Slice z only has vertices in the tiles
+		// active in the slabs below and above it, and the z edges only in the tiles of slab z
+		std::swap(slices[0], slices[1]);
+		for(int tile = 0; tile < tiles * tiles; ++tile)
+		{
+			if(!active[tile] && !previousActive[tile])
+				continue;
+			int x0 = (tile % tiles) * t;
+			int y0 = (tile / tiles) * t;
+			for(int y = y0; y <= std::min(y0 + t, resolution); ++y)
+			{
+				std::size_t row = std::size_t(y) * n;
+				int x1 = std::min(x0 + t, resolution);
+				std::fill(&zEdgeVertices[row + x0], &zEdgeVertices[row + x1] + 1, noVertex);
+				std::fill(&slices[1].edgeVertices[(row + x0) * 2], &slices[1].edgeVertices[(row + x1) * 2] + 2, noVertex);
+			}
+		}
+		previousActive.swap(active);
+		active.swap(nextActive);
+	}
+	return vertexCount;
+}
+
+void computeFieldNormals(const SurfaceField &field, float h,
+const std::vector<vec3> &positions, std::vector<vec3> &normals)
+{
+	normals.resize(positions.size());
+	for(std::size_t i = 0; i < positions.size(); ++i)
+	{
+		const vec3 &p = positions[i];
+		vec3 gradient(
+			field.evaluate(p.x + h, p.y, p.z) - field.evaluate(p.x - h, p.y, p.z),
+			field.evaluate(p.x, p.y + h, p.z) - field.evaluate(p.x, p.y - h, p.z),
+			field.evaluate(p.x, p.y, p.z + h) - field.evaluate(p.x, p.y, p.z - h));
+		float l = length(gradient);
+		normals[i] = l > 0.0f ? gradient / l : vec3(0.0f);
+	}
+}
@@ -0,0 +1,161 @@
+/*
+OpenGL examples - Isosurface
+
+Polygonization of implicit surfaces f(x, y, z) = 0 over a cubical domain.
+The field is first sampled once per lattice point into a SampleGrid by
+	sampleGrid(grid, field, resolution, min, max),
+and the meshers only ever read from that cache, so neighbouring cells
+never evaluate the same point twice. Sampling uses the batch evaluator
+of the field (see field.h) one brick plane at a time.
+
+	sampleGridCulled(grid, field, resolution, min, max, epsilon)
+samples only the bricks of the lattice that may lie within epsilon of the
+surface. An octree over the bricks bounds the field on each node with
+interval arithmetic and discards nodes that cannot contain |f| <= epsilon.
+Discarded bricks store a single value of the right sign with |f| > epsilon,
+and the meshers skip them, so both time and memory scale with the surface
+area rather than the volume.
+
+Three meshers read the grid:
+	polygonizeVoxels		blocky faces of the voxels where |f| <= epsilon,
+							four unshared vertices per face
+	polygonizeSurfaceNets	one vertex per cell crossed by the surface, placed at
+							the mean of the edge crossings, and one quad per
+							crossed lattice edge connecting the four cells around it
+	polygonizeMarchingCubes	one vertex per crossed lattice edge, triangles from the
+							marching cubes case of each cell
+The smooth meshers look up the vertex of a cell or edge in a map indexed like
+the samples, so every vertex is shared by all the faces that use it.
+
+Grids too large for memory are polygonized without a SampleGrid by
+	polygonizeMarchingCubesStreaming(field, resolution, min, max, emit),
+which samples one z slice at a time and hands the mesh to emit one slab of
+cells at a time (see meshfile.h to write it to disk).
+*/
+
+#ifndef ISOSURFACE_H
+#define ISOSURFACE_H
+#include "glutils.h"
+#include "field.h"
+#include <functional>
+#include <vector>
+
+/* The field sampled at the (resolution + 1)^3 lattice points spanning [min, max]^3,
+	plus a one point border on each side so that the neighbours of every lattice
+	point can be looked up without bounds checks. Lattice coordinates therefore
+	range from -1 to resolution + 1 along each axis.
+
+	The stored points are grouped into bricks of brickSize^3 points, starting at
+	the border. A sampled brick owns brickVolume consecutive samples (z fastest),
+	starting at brickSlots[brick] * brickVolume. Bricks that were not sampled
+	have a slot of -1 and read as brickFill[brick] everywhere. */
+struct SampleGrid
+{
+	static const int brickShift = 3;
+	static const int brickSize = 1 << brickShift;
+	static const int brickVolume = brickSize * brickSize * brickSize;
+
+	int resolution;
+	float min;
+	float max;
+	std::vector<int> brickSlots;
+	std::vector<float> brickFill;
+	std::vector<float> samples;
+
+	SampleGrid() : resolution(0), min(0.0f), max(0.0f) { }
+
+	int size() const { return resolution + 3; }
+	int bricksPerAxis() const { return (size() + brickSize - 1) >> brickShift; }
+	int brickCount() const { return bricksPerAxis() * bricksPerAxis() * bricksPerAxis(); }
+	int brickIndex(int bx, int by, int bz) const { return (bx * bricksPerAxis() + by) * bricksPerAxis() + bz; }
+	int sampledBrickCount() const { return int(samples.size() / brickVolume); }
+	bool isSampled(int brick) const { return brickSlots[brick] >= 0; }
+
+	float blockSize() const { return (max - min) / float(resolution); }
+	float position(int g) const { return min + (max - min) * (g / float(resolution)); }
+
+	/* returns the position of the lattice point in samples, or -1 if its brick was not sampled */
+	std::ptrdiff_t sampleIndex(int gx, int gy, int gz) const
+	{
+		int sx = gx + 1, sy = gy + 1, sz = gz + 1;
+		int slot = brickSlots[brickIndex(sx >> brickShift, sy >> brickShift, sz >> brickShift)];
+		if(slot < 0)
+			return -1;
+		int m = brickSize - 1;
+		return std::ptrdiff_t(slot) * brickVolume + ((((sx & m) << brickShift) + (sy & m)) << brickShift) + (sz & m);
+	}
+
+	float at(int gx, int gy, int gz) const
+	{
+		std::ptrdiff_t i = sampleIndex(gx, gy, gz);
+		if(i < 0)
+			return brickFill[brickIndex((gx + 1) >> brickShift, (gy + 1) >> brickShift, (gz + 1) >> brickShift)];
+		return samples[i];
+	}
+};
+
+/* evaluates the field once for every point of the lattice (including the border).
+	the bricks are distributed across the worker threads */
+void sampleGrid(SampleGrid &grid, const SurfaceField &field, int resolution, float min, float max);
+
+/* like sampleGrid, but skips the bricks where the field is bounded away from [-epsilon, epsilon].
+	falls back to sampleGrid if the field has no interval evaluator */
+void sampleGridCulled(SampleGrid &grid, const SurfaceField &field, int resolution, float min, float max, float epsilon);
+
+/* resamples every brick within one lattice step of the box [boxMin, boxMax] and returns
+	the bricks whose samples changed. The box must cover every point where the field changed,
+	culled bricks outside of it keep their fill value */
+void resampleRegion(SampleGrid &grid, const SurfaceField &field,
+	const glm::vec3 &boxMin, const glm::vec3 &boxMax, std::vector<int> &changed);
+
+/* approximates the level surface by the faces of the voxels where |f| <= epsilon,
+	skipping faces shared with another such voxel. Reads only from the grid. */
+void polygonizeVoxels(const SampleGrid &grid, float epsilon,
+	std::vector<glm::vec3> &positions, std::vector<GLuint> &indices);
+
+/* same result as polygonizeVoxels, computed brick by brick on the worker threads */
+void polygonizeVoxelsParallel(const SampleGrid &grid, float epsilon,
+	std::vector<glm::vec3> &positions, std::vector<GLuint> &indices);
+
+/* naive surface nets of the level surface f = 0 */
+void polygonizeSurfaceNets(const SampleGrid &grid,
+	std::vector<glm::vec3> &positions, std::vector<GLuint> &indices);
+
+/* marching cubes of the level surface f = 0. Faces shared by two cells are
+	split the same way from both sides, so the mesh has no cracks */
+void polygonizeMarchingCubes(const SampleGrid &grid,
+	std::vector<glm::vec3> &positions, std::vector<GLuint> &indices);
+
+/* marching cubes of the cells whose minimum corner lies in the brick. The vertices are only
+	shared within the brick, so the mesh of a brick depends on nothing but its own samples
+	and the first layer of samples of the bricks after it along each axis */
+void polygonizeMarchingCubesBrick(const SampleGrid &grid, int brick,
+	std::vector<glm::vec3> &positions, std::vector<GLuint> &indices);
+
+/* the part of a mesh produced by one slab of polygonizeMarchingCubesStreaming.
+	The indices refer to the vertices of every chunk so far, the first vertex
+	of this chunk has index firstVertex */
+struct MeshChunk
+{
+	GLuint firstVertex;
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<GLuint> indices;
+};
+
+typedef std::function<void(const MeshChunk &chunk)> MeshChunkCallback;
+
+/* the same mesh as polygonizeMarchingCubes of a grid sampled at resolution over [min, max]^3,
+	with field normals, computed one slab of cells at a time. Only two slices of samples and
+	the mesh of one slab are kept, so the memory used grows with resolution^2, not resolution^3.
+	Tiles of the slab that interval arithmetic proves empty are neither sampled nor meshed.
+	returns the number of vertices, which must fit in a GLuint */
+std::size_t polygonizeMarchingCubesStreaming(const SurfaceField &field, int resolution, float min, float max,
+	const MeshChunkCallback &emit);
+
+/* sets each normal to the normalized gradient of the field at the vertex,
+	estimated with central differences of step h */
+void computeFieldNormals(const SurfaceField &field, float h,
+	const std::vector<glm::vec3> &positions, std::vector<glm::vec3> &normals);
+
+#endif
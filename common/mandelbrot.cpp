@@ -0,0 +1,196 @@
+#include "mandelbrot.h"
+#include "parallel.h"
+#include "simd.h"
+#include <algorithm>
+using namespace glm;
+
+// The rectangle of the complex plane the shader maps its quad to, before zooming
+static const float left = -2.5f;
+static const float right = 1.0f;
+static const float bottom = -1.0f;
+static const float top = 1.0f;
+
+vec2 getMandelbrotPoint(const MandelbrotView &view, int width, int height, float x, float y)
+{
+	float u = x / float(width);
+	float v = 1.0f - y / float(height);
+	return vec2(left + (right - left) * u, bottom + (top - bottom) * v) * (1.0f - view.zoom) + view.offset;
+}
+
+// Orbits closer than this to an earlier point of theirs are periodic. Far above the
+// rounding of floats, and small enough that escaping orbits near the boundary get by
+static const floatv cycleDistance2(1e-12f);
+
+std::uint64_t iterateMandelbrot(const MandelbrotView &view, int width, int height,
+int x0, int y0, int x1, int y1, int *counts, int stride)
+{
+	const int w = floatv::width;
+	const floatv two(2.0f), four(4.0f), one(1.0f);
+	const floatv maxCount(float(view.maxIteration));
+	float cx[w], cy[w], n[w], done[w];
+	int offsets[w];
+
+	// The lanes take the pixels in row order and wrap to the next row, so the narrow
+	// rectangles of subdivideCounts keep them all busy. The last group repeats its last pixel
+	const int columns = x1 - x0;
+	const int pixels = columns * (y1 - y0);
+	std::uint64_t sum = 0;
+	for(int p = 0; p < pixels; p += w)
+	{
+		for(int lane = 0; lane < w; ++lane)
+		{
+			int q = std::min(p + lane, pixels - 1);
+			int x = x0 + q % columns, y = y0 + q / columns;
+			vec2 point = getMandelbrotPoint(view, width, height, float(x) + 0.5f, float(y) + 0.5f);
+			cx[lane] = point.x;
+			cy[lane] = point.y;
+			offsets[lane] = (y - y0) * stride + (x - x0);
+		}
+
+		// The lanes the checks stop keep the iterations they did, none inside the bulbs
+		floatv zx(0.0f), zy(0.0f), count(0.0f), iterated(0.0f), stopped(0.0f);
+		floatv c = floatv::load(cx), ci = floatv::load(cy);
+		floatv active = floatv(0.0f) < one; // every lane
+		if(view.interiorChecks)
+		{
+			stopped = isInsideBulbs(c, ci);
+			count = select(stopped, maxCount, count);
+			active = andNot(stopped, active);
+		}
+
+		floatv savedX(0.0f), savedY(0.0f);
+		int checkpoint = 1;
+		for(int i = 0; i < view.maxIteration; ++i)
+		{
+			floatv x2 = zx * zx, y2 = zy * zy;
+			active = active & (x2 + y2 < four);
+			if(!any(active))
+				break;
+			count = count + (active & one);
+			zy = two * zx * zy + ci;
+			zx = x2 - y2 + c;
+
+			if(!view.interiorChecks)
+				continue;
+			floatv dx = zx - savedX, dy = zy - savedY;
+			floatv periodic = active & (dx * dx + dy * dy < cycleDistance2);
+			if(any(periodic))
+			{
+				iterated = select(periodic, count, iterated);
+				stopped = stopped | periodic;
+				count = select(periodic, maxCount, count);
+				active = andNot(periodic, active);
+			}
+			if(i + 1 == checkpoint)
+			{
+				savedX = zx;
+				savedY = zy;
+				checkpoint *= 2;
+			}
+		}
+
+		count.store(n);
+		select(stopped, iterated, count).store(done);
+		for(int lane = 0; lane < w && p + lane < pixels; ++lane)
+		{
+			counts[offsets[lane]] = int(n[lane]);
+			sum += std::uint64_t(done[lane]);
+		}
+	}
+	return sum;
+}
+
+std::uint64_t subdivideCounts(const CountKernel &kernel, int x0, int y0, int x1, int y1, int *counts, int stride)
+{
+	// Below this the border is most of the rectangle
+	const int minSize = 6;
+	int w = x1 - x0, h = y1 - y0;
+	if(w <= minSize || h <= minSize)
+		return kernel(x0, y0, x1, y1, counts, stride);
+
+	int *bottom = counts + std::size_t(h - 1) * stride;
+	std::uint64_t sum = kernel(x0, y0, x1, y0 + 1, counts, stride);
+	sum += kernel(x0, y1 - 1, x1, y1, bottom, stride);
+	sum += kernel(x0, y0 + 1, x0 + 1, y1 - 1, counts + stride, stride);
+	sum += kernel(x1 - 1, y0 + 1, x1, y1 - 1, counts + stride + w - 1, stride);
+
+	int border = counts[0];
+	bool same = true;
+	for(int x = 0; x < w && same; ++x)
+		same = counts[x] == border && bottom[x] == border;
+	for(int y = 1; y < h - 1 && same; ++y)
+		same = counts[std::size_t(y) * stride] == border && counts[std::size_t(y) * stride + w - 1] == border;
+
+	int *inside = counts + stride + 1;
+	if(same)
+	{
+		for(int y = 0; y < h - 2; ++y)
+			std::fill(inside + std::size_t(y) * stride, inside + std::size_t(y) * stride + w - 2, border);
+		return sum;
+	}
+
+	// The inside in two halves across its longer side, each with a border of its own
+	if(w >= h)
+	{
+		int mid = (x0 + 1 + x1 - 1) / 2;
+		sum += subdivideCounts(kernel, x0 + 1, y0 + 1, mid, y1 - 1, inside, stride);
+		sum += subdivideCounts(kernel, mid, y0 + 1, x1 - 1, y1 - 1, inside + (mid - x0 - 1), stride);
+	}
+	else
+	{
+		int mid = (y0 + 1 + y1 - 1) / 2;
+		sum += subdivideCounts(kernel, x0 + 1, y0 + 1, x1 - 1, mid, inside, stride);
+		sum += subdivideCounts(kernel, x0 + 1, mid, x1 - 1, y1 - 1, inside + std::size_t(mid - y0 - 1) * stride, stride);
+	}
+	return sum;
+}
+
+CountKernel getMandelbrotKernel(const MandelbrotView &view, int width, int height)
+{
+	CountKernel kernel = [&view, width, height](int x0, int y0, int x1, int y1, int *counts, int stride)
+	{
+		return iterateMandelbrot(view, width, height, x0, y0, x1, y1, counts, stride);
+	};
+	if(!view.subdivide)
+		return kernel;
+	return [kernel](int x0, int y0, int x1, int y1, int *counts, int stride)
+	{
+		return subdivideCounts(kernel, x0, y0, x1, y1, counts, stride);
+	};
+}
+
+std::uint64_t computeMandelbrot(const MandelbrotView &view, int width, int height, std::vector<int> &counts)
+{
+	counts.resize(std::size_t(width) * height);
+	if(counts.empty())
+		return 0;
+
+	CountKernel kernel = getMandelbrotKernel(view, width, height);
+	return parallelTiles(width, 0, height, mandelbrotTileSize, [&](int x0, int y0, int x1, int y1)
+	{
+		return kernel(x0, y0, x1, y1, &counts[std::size_t(y0) * width + x0], width);
+	});
+}
+
+// What the framebuffer stores of the colour of the shader, rounded to 8 bits
+template <typename Count>
+static void colorCounts(const Count *counts, std::size_t count, int maxIteration, unsigned char *rgb)
+{
+	const float ramp[3] = { 20.0f, 190.0f, 255.0f };
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		float alpha = float(counts[i]) / float(maxIteration);
+		for(int k = 0; k < 3; ++k)
+			rgb[3 * i + k] = (unsigned char)(alpha * ramp[k] + 0.5f);
+	}
+}
+
+void colorMandelbrot(const int *counts, std::size_t count, int maxIteration, unsigned char *rgb)
+{
+	colorCounts(counts, count, maxIteration, rgb);
+}
+
+void colorMandelbrot(const float *counts, std::size_t count, int maxIteration, unsigned char *rgb)
+{
+	colorCounts(counts, count, maxIteration, rgb);
+}
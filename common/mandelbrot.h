@@ -0,0 +1,94 @@
+/*
+OpenGL examples - Mandelbrot
+
+The Mandelbrot variant of data/fractal.fs computed on the CPU, for machines without a GPU
+and for comparing the two (see fractal.h for the other formulas). The pixel (x, y) of a
+width x height image, row 0 at the top, samples
+	c = (-2.5 + 3.5 u, -1 + 2 v) * (1 - zoom) + offset
+at u = (x + 0.5) / width and v = 1 - (y + 0.5) / height, like the shader, and counts the
+iterations of z = z^2 + c from 0 while |z| < 2, up to maxIteration. The counts are coloured
+with the same ramp, count / maxIteration times (20, 190, 255).
+
+The pixels of a row are iterated floatv::width at a time (see simd.h), 8 with AVX. A group
+of lanes stops once every lane has escaped, and the lanes that escaped earlier stop counting.
+computeMandelbrot splits the image into tiles and spreads them over the workers (see
+parallel.h), so the slow tiles around the set do not hold up the others. Everything is
+computed in single precision, as in the shader.
+
+The points inside the set are the slowest, they run to maxIteration. With interiorChecks,
+as the shader does, the main cardioid and the period 2 bulb are recognized before
+iterating, and an orbit that returns to where it was at the last power of two iteration
+(Brent's cycle detection) is taken as periodic and stops. Both count as maxIteration.
+With subdivide, each tile is filled by subdivideCounts: a rectangle whose border has a
+single count takes it everywhere inside (Mariani-Silver), which is exact for the set
+itself since it has no holes. The kernels return the iterations they actually did, which
+leave out what the checks and the filled rectangles skip, so the rates they give are of
+work done rather than of the counts.
+*/
+
+#ifndef MANDELBROT_H
+#define MANDELBROT_H
+#include "glutils.h"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+struct MandelbrotView
+{
+	MandelbrotView() : zoom(0.0f), offset(0.0f), maxIteration(128), interiorChecks(true), subdivide(true) { }
+
+	float zoom; // the uniforms of the shader
+	glm::vec2 offset;
+	int maxIteration;
+	bool interiorChecks;
+	bool subdivide;
+};
+
+/* the side of the tiles the images are split into for the workers (see parallelTiles) */
+static const int mandelbrotTileSize = 64;
+
+/* writes the counts of the pixels [x0, x1) x [y0, y1) to counts, rows stride counts apart.
+	returns the iterations done */
+typedef std::function<std::uint64_t(int x0, int y0, int x1, int y1, int *counts, int stride)> CountKernel;
+
+/* the point of the complex plane sampled at (x, y), the center of a pixel is at (x + 0.5, y + 0.5) */
+glm::vec2 getMandelbrotPoint(const MandelbrotView &view, int width, int height, float x, float y);
+
+/* the lanes of c = (x, y) in the main cardioid or in the disk of the period 2 bulb, whose points
+	never escape. For floatv and doublev (see simd.h) */
+template <typename Real>
+Real isInsideBulbs(Real x, Real y)
+{
+	Real y2 = y * y;
+	Real xq = x - Real(0.25);
+	Real q = xq * xq + y2;
+	Real x1 = x + Real(1.0);
+	return (q * (q + xq) <= Real(0.25) * y2) | (x1 * x1 + y2 <= Real(0.0625));
+}
+
+/* writes the iteration counts of the pixels [x0, x1) x [y0, y1) of a width x height image to counts,
+	the first pixel of each row stride counts after the first of the one above.
+	returns the iterations done, the sum of the counts but for the pixels the interior checks stopped */
+std::uint64_t iterateMandelbrot(const MandelbrotView &view, int width, int height,
+	int x0, int y0, int x1, int y1, int *counts, int stride);
+
+/* the counts of the pixels [x0, x1) x [y0, y1) like the kernel, which it calls for the borders of
+	ever smaller rectangles, filling those with a single count on their border without it.
+	returns the iterations the kernel did */
+std::uint64_t subdivideCounts(const CountKernel &kernel, int x0, int y0, int x1, int y1, int *counts, int stride);
+
+/* iterateMandelbrot for a width x height image, through subdivideCounts if the view subdivides.
+	the view is referenced, not copied */
+CountKernel getMandelbrotKernel(const MandelbrotView &view, int width, int height);
+
+/* the counts of every pixel, row by row, computed by all the workers.
+	returns the iterations done */
+std::uint64_t computeMandelbrot(const MandelbrotView &view, int width, int height, std::vector<int> &counts);
+
+/* the colours of the counts, 3 bytes per pixel */
+void colorMandelbrot(const int *counts, std::size_t count, int maxIteration, unsigned char *rgb);
+
+/* the same for counts with a fraction, such as those of SmoothCount (see fractal.h) */
+void colorMandelbrot(const float *counts, std::size_t count, int maxIteration, unsigned char *rgb);
+
+#endif
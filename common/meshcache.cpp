@@ -0,0 +1,66 @@
+#include "meshcache.h"
+#include <cstdio>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+static const char *meshCacheDirectory = "meshcache";
+
+MeshCacheKey::MeshCacheKey() : hash(14695981039346656037ULL)
+{
+	add(meshCacheVersion);
+}
+
+void MeshCacheKey::addBytes(const void *bytes, std::size_t count)
+{
+	const unsigned char *b = (const unsigned char*)bytes;
+	for(std::size_t i = 0; i < count; ++i)
+	{
+		hash ^= b[i];
+		hash *= 1099511628211ULL;
+	}
+}
+
+MeshCacheKey &MeshCacheKey::add(const std::string &s)
+{
+	// Hash the length too, so that ("ab", "c") and ("a", "bc") differ
+	add(int(s.size()));
+	addBytes(s.data(), s.size());
+	return *this;
+}
+
+MeshCacheKey &MeshCacheKey::add(int i)
+{
+	addBytes(&i, sizeof(i));
+	return *this;
+}
+
+MeshCacheKey &MeshCacheKey::add(float f)
+{
+	addBytes(&f, sizeof(f));
+	return *this;
+}
+
+std::string MeshCacheKey::getFilename() const
+{
+	char name[64];
+	std::snprintf(name, sizeof(name), "%s/%016llx.mesh", meshCacheDirectory, (unsigned long long)hash);
+	return name;
+}
+
+bool loadCachedMesh(const MeshCacheKey &key, MappedMeshFile &file)
+{
+	return file.open(key.getFilename());
+}
+
+bool storeCachedMesh(const MeshCacheKey &key, const MeshData &mesh)
+{
+#ifdef _WIN32
+	_mkdir(meshCacheDirectory);
+#else
+	mkdir(meshCacheDirectory, 0755);
+#endif
+	return writeMeshFile(key.getFilename(), mesh.positions, mesh.normals, mesh.indices);
+}
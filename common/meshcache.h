@@ -0,0 +1,55 @@
+/*
+OpenGL examples - Mesh cache
+
+Generated meshes are stored in the meshcache directory under the hash of everything
+that determines them, so a later run with the same inputs maps the stored mesh
+instead of generating it again:
+	MeshCacheKey key;
+	key.add("isosurface").add(resolution).add(epsilon);
+	MappedMeshFile file;
+	if(!loadCachedMesh(key, file))
+		... generate mesh, then storeCachedMesh(key, mesh)
+Add every parameter of the generator to the key, and bump meshCacheVersion when a
+generator changes its output, so stale meshes are never found.
+*/
+
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+#include "meshfile.h"
+#include "meshjob.h"
+#include <cstdint>
+#include <string>
+
+static const int meshCacheVersion = 2;
+
+/* a 64 bit FNV-1a hash of the added values, starting from meshCacheVersion */
+class MeshCacheKey
+{
+public:
+	MeshCacheKey();
+
+	MeshCacheKey &add(const std::string &s);
+	MeshCacheKey &add(int i);
+	MeshCacheKey &add(float f);
+
+	/* the path of the cached mesh, meshcache/<hash>.mesh */
+	std::string getFilename() const;
+
+private:
+	void addBytes(const void *bytes, std::size_t count);
+
+	std::uint64_t hash;
+};
+
+/* maps the cached mesh of the key.
+	return true if it was found.
+	return false otherwise */
+bool loadCachedMesh(const MeshCacheKey &key, MappedMeshFile &file);
+
+/* stores the mesh under the key, creating the meshcache directory if needed.
+	safe to call from a worker thread.
+	return true if successful.
+	return false otherwise */
+bool storeCachedMesh(const MeshCacheKey &key, const MeshData &mesh);
+
+#endif
@@ -0,0 +1,263 @@
+#include "meshfile.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+using namespace glm;
+
+static const char meshMagic[4] = { 'M', 'E', 'S', 'H' };
+static const std::uint32_t meshVersion = 1;
+
+struct MeshFileHeader
+{
+	char magic[4];
+	std::uint32_t version;
+	std::uint64_t vertexCount;
+	std::uint64_t indexCount;
+};
+
+MeshFileWriter::MeshFileWriter() : vertexCount(0), indexCount(0)
+{
+}
+
+MeshFileWriter::~MeshFileWriter()
+{
+	if(file.is_open())
+		close();
+}
+
+bool MeshFileWriter::open(const std::string &filename)
+{
+	this->filename = filename;
+	vertexCount = 0;
+	indexCount = 0;
+	file.open(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	indexFile.open((filename + ".indices").c_str(), std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+	if(!file.is_open() || !indexFile.is_open())
+	{
+		file.close();
+		indexFile.close();
+		return false;
+	}
+
+	MeshFileHeader header = {};
+	file.write((const char*)&header, sizeof(header));
+	return file.good();
+}
+
+void MeshFileWriter::write(const MeshChunk &chunk)
+{
+	// Interleave the positions and normals a few thousand vertices at a time
+	const std::size_t batch = 1024;
+	vec3 vertices[2 * batch];
+	for(std::size_t i = 0; i < chunk.positions.size(); i += batch)
+	{
+		std::size_t count = std::min(batch, chunk.positions.size() - i);
+		for(std::size_t j = 0; j < count; ++j)
+		{
+			vertices[2 * j + 0] = chunk.positions[i + j];
+			vertices[2 * j + 1] = chunk.normals[i + j];
+		}
+		file.write((const char*)vertices, count * 2 * sizeof(vec3));
+	}
+	if(!chunk.indices.empty())
+		indexFile.write((const char*)&chunk.indices[0], chunk.indices.size() * sizeof(GLuint));
+	vertexCount += chunk.positions.size();
+	indexCount += chunk.indices.size();
+}
+
+bool MeshFileWriter::close()
+{
+	// Append the indices in blocks
+	indexFile.seekg(0, std::ios::beg);
+	std::vector<char> block(1 << 20);
+	std::uint64_t remaining = indexCount * sizeof(GLuint);
+	while(remaining > 0 && indexFile.good())
+	{
+		std::size_t size = std::size_t(std::min<std::uint64_t>(remaining, block.size()));
+		indexFile.read(&block[0], size);
+		file.write(&block[0], size);
+		remaining -= size;
+	}
+	bool ok = remaining == 0 && indexFile.good();
+	indexFile.close();
+	std::remove((filename + ".indices").c_str());
+
+	MeshFileHeader header;
+	std::memcpy(header.magic, meshMagic, sizeof(meshMagic));
+	header.version = meshVersion;
+	header.vertexCount = vertexCount;
+	header.indexCount = indexCount;
+	file.seekp(0, std::ios::beg);
+	file.write((const char*)&header, sizeof(header));
+	ok = ok && file.good();
+	file.close();
+	return ok;
+}
+
+bool readMeshFile(const std::string &filename, std::vector<vec3> &positions,
+std::vector<vec3> &normals, std::vector<GLuint> &indices)
+{
+	std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+	if(!in.is_open())
+		return false;
+
+	MeshFileHeader header;
+	in.read((char*)&header, sizeof(header));
+	if(!in.good() || std::memcmp(header.magic, meshMagic, sizeof(meshMagic)) != 0 || header.version != meshVersion)
+		return false;
+
+	std::vector<vec3> vertices(std::size_t(header.vertexCount) * 2);
+	indices.resize(std::size_t(header.indexCount));
+	if(!vertices.empty())
+		in.read((char*)&vertices[0], vertices.size() * sizeof(vec3));
+	if(!indices.empty())
+		in.read((char*)&indices[0], indices.size() * sizeof(GLuint));
+	if(!in.good())
+		return false;
+
+	positions.resize(std::size_t(header.vertexCount));
+	normals.resize(std::size_t(header.vertexCount));
+	for(std::size_t i = 0; i < positions.size(); ++i)
+	{
+		positions[i] = vertices[2 * i + 0];
+		normals[i] = vertices[2 * i + 1];
+	}
+	return true;
+}
+
+bool writeMeshFile(const std::string &filename, const std::vector<vec3> &positions,
+const std::vector<vec3> &normals, const std::vector<GLuint> &indices)
+{
+	std::string temporary = filename + ".tmp";
+	{
+		std::ofstream out(temporary.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if(!out.is_open())
+			return false;
+
+		MeshFileHeader header;
+		std::memcpy(header.magic, meshMagic, sizeof(meshMagic));
+		header.version = meshVersion;
+		header.vertexCount = positions.size();
+		header.indexCount = indices.size();
+		out.write((const char*)&header, sizeof(header));
+
+		std::vector<vec3> vertices(positions.size() * 2);
+		for(std::size_t i = 0; i < positions.size(); ++i)
+		{
+			vertices[2 * i + 0] = positions[i];
+			vertices[2 * i + 1] = normals[i];
+		}
+		if(!vertices.empty())
+			out.write((const char*)&vertices[0], vertices.size() * sizeof(vec3));
+		if(!indices.empty())
+			out.write((const char*)&indices[0], indices.size() * sizeof(GLuint));
+		if(!out.good())
+		{
+			out.close();
+			std::remove(temporary.c_str());
+			return false;
+		}
+	}
+
+	std::remove(filename.c_str());
+	return std::rename(temporary.c_str(), filename.c_str()) == 0;
+}
+
+MappedMeshFile::MappedMeshFile() : data(NULL), size(0), vertices(NULL), indices(NULL), vertexCount(0), indexCount(0)
+#ifdef _WIN32
+	, file(INVALID_HANDLE_VALUE), mapping(NULL)
+#endif
+{
+}
+
+MappedMeshFile::~MappedMeshFile()
+{
+	close();
+}
+
+bool MappedMeshFile::open(const std::string &filename)
+{
+	close();
+#ifdef _WIN32
+	file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER fileSize;
+	if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < LONGLONG(sizeof(MeshFileHeader)))
+	{
+		close();
+		return false;
+	}
+	size = std::size_t(fileSize.QuadPart);
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+#else
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if(fd < 0)
+		return false;
+	struct stat info;
+	if(fstat(fd, &info) != 0 || info.st_size < off_t(sizeof(MeshFileHeader)))
+	{
+		::close(fd);
+		return false;
+	}
+	size = std::size_t(info.st_size);
+	data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if(data == MAP_FAILED)
+		data = NULL;
+#endif
+	if(!data)
+	{
+		close();
+		return false;
+	}
+
+	// Reject files of another format or version, and truncated files
+	const MeshFileHeader *header = (const MeshFileHeader*)data;
+	std::uint64_t expected = sizeof(MeshFileHeader) + header->vertexCount * 2 * sizeof(vec3) + header->indexCount * sizeof(GLuint);
+	if(std::memcmp(header->magic, meshMagic, sizeof(meshMagic)) != 0 || header->version != meshVersion || expected != size)
+	{
+		close();
+		return false;
+	}
+
+	vertexCount = std::size_t(header->vertexCount);
+	indexCount = std::size_t(header->indexCount);
+	vertices = (const float*)((const char*)data + sizeof(MeshFileHeader));
+	indices = (const GLuint*)(vertices + vertexCount * 6);
+	return true;
+}
+
+void MappedMeshFile::close()
+{
+#ifdef _WIN32
+	if(data)
+		UnmapViewOfFile(data);
+	if(mapping)
+		CloseHandle(mapping);
+	if(file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+	mapping = NULL;
+	file = INVALID_HANDLE_VALUE;
+#else
+	if(data)
+		munmap(data, size);
+#endif
+	data = NULL;
+	size = 0;
+	vertices = NULL;
+	indices = NULL;
+	vertexCount = 0;
+	indexCount = 0;
+}
@@ -0,0 +1,106 @@
+/*
+OpenGL examples - Mesh files
+
+A simple binary format for meshes too large to keep in memory while they are built:
+	char magic[4]		"MESH"
+	uint32 version		1
+	uint64 vertexCount
+	uint64 indexCount
+	vertexCount vertices, each a position and a normal (6 floats)
+	indexCount uint32 triangle indices
+in the byte order of the machine that wrote it.
+
+MeshFileWriter appends the chunks of a streaming polygonizer as they are produced.
+The vertices go straight to the file and the indices to a temporary file next to it,
+which is appended when the writer is closed, so the memory used does not depend on
+the size of the mesh. MappedMeshFile maps a whole file into memory instead of reading
+it, so the vertices and indices can be handed to OpenGL without a copy.
+*/
+
+#ifndef MESH_FILE_H
+#define MESH_FILE_H
+#include "isosurface.h"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+class MeshFileWriter
+{
+public:
+	MeshFileWriter();
+	~MeshFileWriter();
+
+	/* creates the file and writes a placeholder header.
+		return false if the file could not be created */
+	bool open(const std::string &filename);
+
+	/* appends the vertices and indices of the chunk */
+	void write(const MeshChunk &chunk);
+
+	/* appends the indices, writes the final header and closes the file.
+		return false if any write failed */
+	bool close();
+
+	std::uint64_t getVertexCount() const { return vertexCount; }
+	std::uint64_t getIndexCount() const { return indexCount; }
+
+private:
+	MeshFileWriter(const MeshFileWriter &);
+	MeshFileWriter &operator=(const MeshFileWriter &);
+
+	std::string filename;
+	std::ofstream file;
+	std::fstream indexFile;
+	std::uint64_t vertexCount;
+	std::uint64_t indexCount;
+};
+
+/* writes a whole mesh, first to a temporary file that is then renamed, so that other
+	readers never see a partially written file.
+	return true if successful.
+	return false otherwise */
+bool writeMeshFile(const std::string &filename, const std::vector<glm::vec3> &positions,
+	const std::vector<glm::vec3> &normals, const std::vector<GLuint> &indices);
+
+class MappedMeshFile
+{
+public:
+	MappedMeshFile();
+	~MappedMeshFile();
+
+	/* maps the file and checks its header and size.
+		return true if successful.
+		return false otherwise */
+	bool open(const std::string &filename);
+	void close();
+
+	/* interleaved positions and normals, 6 floats per vertex */
+	const float *getVertices() const { return vertices; }
+	const GLuint *getIndices() const { return indices; }
+	std::size_t getVertexCount() const { return vertexCount; }
+	std::size_t getIndexCount() const { return indexCount; }
+
+private:
+	MappedMeshFile(const MappedMeshFile &);
+	MappedMeshFile &operator=(const MappedMeshFile &);
+
+	void *data;
+	std::size_t size;
+	const float *vertices;
+	const GLuint *indices;
+	std::size_t vertexCount;
+	std::size_t indexCount;
+#ifdef _WIN32
+	void *file;
+	void *mapping;
+#endif
+};
+
+/* reads a whole mesh file into memory.
+	return true if successful.
+	return false otherwise */
+bool readMeshFile(const std::string &filename, std::vector<glm::vec3> &positions,
+	std::vector<glm::vec3> &normals, std::vector<GLuint> &indices);
+
+#endif
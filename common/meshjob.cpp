@@ -0,0 +1,163 @@
+#include "meshjob.h"
+#include "globj.h"
+#include <chrono>
+using namespace glm;
+
+void MeshData::clear()
+{
+	positions.clear();
+	normals.clear();
+	indices.clear();
+	buildTime = 0.0;
+}
+
+MeshJob::MeshJob() : running(false), ready(false)
+{
+}
+
+MeshJob::~MeshJob()
+{
+	if(thread.joinable())
+		thread.join();
+}
+
+void MeshJob::start(const Builder &build)
+{
+	if(thread.joinable())
+		thread.join();
+	ready = false;
+	running = true;
+	result.clear();
+	thread = std::thread([this, build]()
+	{
+		auto start = std::chrono::steady_clock::now();
+		build(result);
+		result.buildTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		running = false;
+		// The result is complete before ready is set, which poll checks first
+		ready = true;
+	});
+}
+
+bool MeshJob::isRunning() const
+{
+	return running;
+}
+
+bool MeshJob::poll(MeshData &mesh)
+{
+	if(!ready)
+		return false;
+
+	// The worker is done, so this does not block
+	thread.join();
+	ready = false;
+	std::swap(mesh, result);
+	return true;
+}
+
+MeshBuffers::MeshBuffers() : front(0), positionAttrib(-1), normalAttrib(-1)
+{
+	for(int i = 0; i < 2; ++i)
+	{
+		sets[i].vao = sets[i].vbo = sets[i].ibo = 0;
+		sets[i].elementCount = 0;
+		sets[i].indexType = GL_UNSIGNED_INT;
+		sets[i].format = getPackedVertexFormat(vec3(-1.0f), vec3(1.0f), true, false, false, Directions8);
+	}
+}
+
+void MeshBuffers::create(GLint positionAttrib, GLint normalAttrib)
+{
+	this->positionAttrib = positionAttrib;
+	this->normalAttrib = normalAttrib;
+	for(int i = 0; i < 2; ++i)
+	{
+		glGenVertexArrays(1, &sets[i].vao);
+		glGenBuffers(1, &sets[i].vbo);
+		glGenBuffers(1, &sets[i].ibo);
+	}
+}
+
+void MeshBuffers::upload(const MeshData &mesh)
+{
+	BufferSet &back = sets[1 - front];
+	glBindVertexArray(back.vao);
+
+	vec3 boxMin, boxMax;
+	computeBounds(mesh.positions, boxMin, boxMax);
+	back.format = getPackedVertexFormat(boxMin, boxMax, true, false, false, Directions8);
+	std::vector<unsigned char> vertices;
+	packVertices(back.format, mesh.positions, &mesh.normals, NULL, NULL, vertices);
+
+	// The back buffers are not used by any pending draw call since the last swap,
+	// so reallocating them does not stall
+	glBindBuffer(GL_ARRAY_BUFFER, back.vbo);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size(), vertices.empty() ? NULL : &vertices[0], GL_STATIC_DRAW);
+	back.format.apply(positionAttrib, normalAttrib);
+
+	finishUpload(back, mesh.indices.empty() ? NULL : &mesh.indices[0], mesh.indices.size(), mesh.positions.size());
+}
+
+void MeshBuffers::uploadInterleaved(const float *vertices, std::size_t vertexCount,
+const GLuint *indices, std::size_t indexCount)
+{
+	BufferSet &back = sets[1 - front];
+	glBindVertexArray(back.vao);
+
+	const vec3 *source = (const vec3*)vertices;
+	vec3 boxMin = vertexCount > 0 ? source[0] : vec3(0.0f);
+	vec3 boxMax = boxMin;
+	for(std::size_t i = 0; i < vertexCount; ++i)
+	{
+		boxMin = min(boxMin, source[2 * i]);
+		boxMax = max(boxMax, source[2 * i]);
+	}
+	back.format = getPackedVertexFormat(boxMin, boxMax, true, false, false, Directions8);
+	std::vector<unsigned char> packed(vertexCount * back.format.stride);
+	for(std::size_t i = 0; i < vertexCount; ++i)
+		packVertex(back.format, source[2 * i], source[2 * i + 1], vec4(0.0f), vec2(0.0f), &packed[i * back.format.stride]);
+
+	glBindBuffer(GL_ARRAY_BUFFER, back.vbo);
+	glBufferData(GL_ARRAY_BUFFER, packed.size(), packed.empty() ? NULL : &packed[0], GL_STATIC_DRAW);
+	back.format.apply(positionAttrib, normalAttrib);
+
+	finishUpload(back, indices, indexCount, vertexCount);
+}
+
+// Uploads the indices of the bound back set, unbinds it and makes it the front set
+void MeshBuffers::finishUpload(BufferSet &set, const GLuint *indices, std::size_t indexCount, std::size_t vertexCount)
+{
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, set.ibo);
+	set.indexType = uploadIndices(indices, indexCount, vertexCount, GL_STATIC_DRAW);
+	set.elementCount = indexCount;
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	front = 1 - front;
+}
+
+void MeshBuffers::draw() const
+{
+	const BufferSet &set = sets[front];
+	if(set.elementCount == 0)
+		return;
+
+	glBindVertexArray(set.vao);
+	glDrawElements(GL_TRIANGLES, set.elementCount, set.indexType, 0);
+	glBindVertexArray(0);
+}
+
+void MeshBuffers::destroy()
+{
+	for(int i = 0; i < 2; ++i)
+	{
+		glDeleteBuffers(1, &sets[i].vbo);
+		glDeleteBuffers(1, &sets[i].ibo);
+		glDeleteVertexArrays(1, &sets[i].vao);
+		sets[i].vao = sets[i].vbo = sets[i].ibo = 0;
+		sets[i].elementCount = 0;
+	}
+}
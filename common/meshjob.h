@@ -0,0 +1,107 @@
+/*
+OpenGL examples - Mesh job
+
+Builds meshes on a worker thread so the frame loop never waits for them.
+	job.start(build)
+runs build(mesh) on a new thread, and
+	job.poll(mesh)
+hands the finished mesh to the render thread once, without blocking.
+
+MeshBuffers keeps two sets of buffers. A finished mesh is uploaded into the set
+that is not being drawn, and the sets are swapped once the upload is complete,
+so the previous mesh stays on screen until the new one is ready. The vertices are
+packed to 8 bytes each (see vertexpack.h), so the vertex shader has to decode the
+positions with the uniforms set by getVertexFormat().setPositionUniforms.
+*/
+
+#ifndef MESH_JOB_H
+#define MESH_JOB_H
+#include "glutils.h"
+#include "vertexpack.h"
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+struct MeshData
+{
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<GLuint> indices;
+	double buildTime; // seconds spent in the build function
+
+	MeshData() : buildTime(0.0) {}
+	void clear();
+};
+
+class MeshJob
+{
+public:
+	typedef std::function<void(MeshData &mesh)> Builder;
+
+	MeshJob();
+	~MeshJob();
+
+	/* runs build on a worker thread. if a previous build is still running,
+		waits for it first and discards its result */
+	void start(const Builder &build);
+
+	/* true while a build is running */
+	bool isRunning() const;
+
+	/* moves the finished mesh into mesh and returns true, once per build.
+		returns false without blocking if no mesh is ready */
+	bool poll(MeshData &mesh);
+
+private:
+	MeshJob(const MeshJob &);
+	MeshJob &operator=(const MeshJob &);
+
+	std::thread thread;
+	std::atomic<bool> running;
+	std::atomic<bool> ready;
+	MeshData result;
+};
+
+class MeshBuffers
+{
+public:
+	MeshBuffers();
+
+	/* generates both sets of buffers, drawn with the given attribute locations */
+	void create(GLint positionAttrib, GLint normalAttrib);
+
+	/* uploads the mesh into the back buffers and makes them the front buffers */
+	void upload(const MeshData &mesh);
+
+	/* the same for a mesh of interleaved positions and normals, 6 floats per vertex,
+		such as a MappedMeshFile (see meshfile.h) */
+	void uploadInterleaved(const float *vertices, std::size_t vertexCount,
+		const GLuint *indices, std::size_t indexCount);
+
+	/* binds the front vertex array object and draws it, if a mesh has been uploaded */
+	void draw() const;
+
+	void destroy();
+
+	GLsizei getElementCount() const { return sets[front].elementCount; }
+	const PackedVertexFormat &getVertexFormat() const { return sets[front].format; }
+
+private:
+	struct BufferSet
+	{
+		GLuint vao, vbo, ibo;
+		GLsizei elementCount;
+		GLenum indexType;
+		PackedVertexFormat format;
+	};
+
+	void finishUpload(BufferSet &set, const GLuint *indices, std::size_t indexCount, std::size_t vertexCount);
+
+	BufferSet sets[2];
+	int front;
+	GLint positionAttrib;
+	GLint normalAttrib;
+};
+
+#endif
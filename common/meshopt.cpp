@@ -0,0 +1,283 @@
+#include "meshopt.h"
+#include <algorithm>
+using namespace glm;
+
+// A FIFO cache of vertices, a vertex is cached while fewer than size others were added after it
+class VertexCache
+{
+public:
+	VertexCache(std::size_t vertexCount, int size) : stamps(vertexCount, 0), time(size + 1), size(size) {}
+
+	// returns true on a miss, which adds the vertex
+	bool access(GLuint v)
+	{
+		if(time - stamps[v] <= unsigned(size))
+			return false;
+		stamps[v] = time++;
+		return true;
+	}
+	bool contains(GLuint v) const { return time - stamps[v] <= unsigned(size); }
+	unsigned age(GLuint v) const { return time - stamps[v]; }
+	void flush() { time += size + 1; }
+
+private:
+	std::vector<unsigned> stamps;
+	unsigned time;
+	int size;
+};
+
+VertexCacheStats analyzeVertexCache(const std::vector<GLuint> &indices, std::size_t vertexCount, int cacheSize)
+{
+	VertexCache cache(vertexCount, cacheSize);
+	std::vector<bool> used(vertexCount, false);
+	std::size_t misses = 0;
+	std::size_t usedCount = 0;
+	for(std::size_t i = 0; i < indices.size(); ++i)
+	{
+		GLuint v = indices[i];
+		if(cache.access(v))
+			++misses;
+		if(!used[v])
+		{
+			used[v] = true;
+			++usedCount;
+		}
+	}
+
+	VertexCacheStats stats;
+	stats.acmr = indices.empty() ? 0.0f : float(misses) / float(indices.size() / 3);
+	stats.atvr = usedCount == 0 ? 0.0f : float(misses) / float(usedCount);
+	return stats;
+}
+
+void optimizeVertexCache(std::vector<GLuint> &indices, std::size_t vertexCount, int cacheSize,
+std::vector<std::size_t> *clusters)
+{
+	std::size_t triangleCount = indices.size() / 3;
+	if(clusters)
+		clusters->clear();
+	if(triangleCount == 0)
+		return;
+
+	// The triangles around each vertex, and how many of them are still to be emitted
+	std::vector<GLuint> live(vertexCount, 0);
+	for(std::size_t i = 0; i < 3 * triangleCount; ++i)
+		++live[indices[i]];
+	std::vector<std::size_t> offsets(vertexCount + 1, 0);
+	for(std::size_t v = 0; v < vertexCount; ++v)
+		offsets[v + 1] = offsets[v] + live[v];
+	std::vector<GLuint> adjacency(offsets[vertexCount]);
+	std::vector<std::size_t> fill(offsets.begin(), offsets.end() - 1);
+	for(std::size_t i = 0; i < 3 * triangleCount; ++i)
+		adjacency[fill[indices[i]]++] = GLuint(i / 3);
+
+	VertexCache cache(vertexCount, cacheSize);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<GLuint> deadEnds; // recently used vertices, to continue from when a fan runs out
+	std::vector<GLuint> result;
+	result.reserve(3 * triangleCount);
+	std::size_t cursor = 0;
+	while(live[cursor] == 0)
+		++cursor;
+	GLuint fanning = GLuint(cursor);
+	if(clusters)
+		clusters->push_back(0);
+
+	for(;;)
+	{
+		// Emit every remaining triangle around the fanning vertex
+		std::size_t candidates = deadEnds.size();
+		for(std::size_t a = offsets[fanning]; a < offsets[fanning + 1]; ++a)
+		{
+			GLuint t = adjacency[a];
+			if(emitted[t])
+				continue;
+			emitted[t] = true;
+			for(int k = 0; k < 3; ++k)
+			{
+				GLuint v = indices[3 * t + k];
+				result.push_back(v);
+				deadEnds.push_back(v);
+				--live[v];
+				cache.access(v);
+			}
+		}
+
+		// Continue from the oldest vertex of the fan that will still be cached after its
+		// remaining triangles are emitted, or failing that any vertex of the fan
+		int best = -1;
+		long bestPriority = -1;
+		for(std::size_t c = candidates; c < deadEnds.size(); ++c)
+		{
+			GLuint v = deadEnds[c];
+			if(live[v] == 0)
+				continue;
+			long priority = 0;
+			if(cache.age(v) + 2 * live[v] <= unsigned(cacheSize))
+				priority = long(cache.age(v));
+			if(priority > bestPriority)
+			{
+				bestPriority = priority;
+				best = int(v);
+			}
+		}
+
+		if(best < 0)
+		{
+			// A dead end, back up to a recent vertex or else the next unfinished one in order
+			while(!deadEnds.empty() && best < 0)
+			{
+				GLuint v = deadEnds.back();
+				deadEnds.pop_back();
+				if(live[v] > 0)
+					best = int(v);
+			}
+			while(best < 0 && cursor < vertexCount && live[cursor] == 0)
+				++cursor;
+			if(best < 0 && cursor == vertexCount)
+				break;
+			if(best < 0)
+				best = int(cursor);
+			if(clusters)
+				clusters->push_back(result.size() / 3);
+		}
+		fanning = GLuint(best);
+	}
+	indices.swap(result);
+}
+
+void optimizeOverdraw(std::vector<GLuint> &indices, const std::vector<vec3> &positions,
+const std::vector<std::size_t> &clusters, int cacheSize, float threshold, bool flip)
+{
+	std::size_t triangleCount = indices.size() / 3;
+	if(triangleCount == 0)
+		return;
+
+	// Split each cluster after the first run of triangles that is nearly as cache efficient
+	// as the whole cluster, so the pieces can be reordered at little cost
+	VertexCache cache(positions.size(), cacheSize);
+	std::vector<std::size_t> starts;
+	for(std::size_t c = 0; c < clusters.size(); ++c)
+	{
+		std::size_t first = clusters[c];
+		std::size_t last = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+		if(first >= last)
+			continue;
+
+		cache.flush();
+		std::size_t misses = 0;
+		for(std::size_t i = 3 * first; i < 3 * last; ++i)
+			misses += cache.access(indices[i]);
+		float limit = threshold * float(misses) / float(last - first);
+
+		cache.flush();
+		std::size_t start = first;
+		misses = 0;
+		for(std::size_t t = first; t < last; ++t)
+		{
+			for(int k = 0; k < 3; ++k)
+				misses += cache.access(indices[3 * t + k]);
+			if(t + 1 < last && float(misses) <= limit * float(t + 1 - start))
+			{
+				starts.push_back(start);
+				start = t + 1;
+				misses = 0;
+				cache.flush();
+			}
+		}
+		starts.push_back(start);
+	}
+
+	// The area weighted centroid and normal of every cluster
+	float sign = flip ? -1.0f : 1.0f;
+	std::vector<vec3> centroids(starts.size());
+	std::vector<vec3> normals(starts.size());
+	vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+	for(std::size_t c = 0; c < starts.size(); ++c)
+	{
+		std::size_t last = c + 1 < starts.size() ? starts[c + 1] : triangleCount;
+		vec3 centroid(0.0f), normal(0.0f);
+		float area = 0.0f;
+		for(std::size_t t = starts[c]; t < last; ++t)
+		{
+			const vec3 &p0 = positions[indices[3 * t + 0]];
+			const vec3 &p1 = positions[indices[3 * t + 1]];
+			const vec3 &p2 = positions[indices[3 * t + 2]];
+			vec3 n = cross(p1 - p0, p2 - p0);
+			float a = length(n);
+			centroid += (p0 + p1 + p2) * (a / 3.0f);
+			normal += n;
+			area += a;
+		}
+		meshCentroid += centroid;
+		meshArea += area;
+		centroids[c] = area > 0.0f ? centroid / area : positions[indices[3 * starts[c]]];
+		float l = length(normal);
+		normals[c] = l > 0.0f ? normal * (sign / l) : vec3(0.0f);
+	}
+	if(meshArea > 0.0f)
+		meshCentroid /= meshArea;
+
+	// Clusters facing away from the center are in front of the rest from most directions
+	std::vector<float> keys(starts.size());
+	std::vector<std::size_t> order(starts.size());
+	for(std::size_t c = 0; c < starts.size(); ++c)
+	{
+		keys[c] = dot(centroids[c] - meshCentroid, normals[c]);
+		order[c] = c;
+	}
+	std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return keys[a] > keys[b]; });
+
+	std::vector<GLuint> result;
+	result.reserve(indices.size());
+	for(std::size_t o = 0; o < order.size(); ++o)
+	{
+		std::size_t c = order[o];
+		std::size_t last = c + 1 < starts.size() ? starts[c + 1] : triangleCount;
+		result.insert(result.end(), indices.begin() + 3 * starts[c], indices.begin() + 3 * last);
+	}
+	indices.swap(result);
+}
+
+std::size_t optimizeVertexFetch(std::vector<GLuint> &indices, std::size_t vertexCount, std::vector<GLuint> &remap)
+{
+	remap.assign(vertexCount, GLuint(-1));
+	GLuint next = 0;
+	for(std::size_t i = 0; i < indices.size(); ++i)
+	{
+		GLuint &v = remap[indices[i]];
+		if(v == GLuint(-1))
+			v = next++;
+		indices[i] = v;
+	}
+	return next;
+}
+
+MeshOptimizeReport optimizeMesh(std::vector<vec3> &positions, std::vector<GLuint> &indices,
+bool overdraw, bool flip, std::vector<vec3> *normals, std::vector<vec2> *texels)
+{
+	MeshOptimizeReport report;
+	report.before = analyzeVertexCache(indices, positions.size());
+
+	std::vector<std::size_t> clusters;
+	optimizeVertexCache(indices, positions.size(), 16, overdraw ? &clusters : NULL);
+	if(overdraw)
+		optimizeOverdraw(indices, positions, clusters, 16, 1.05f, flip);
+
+	std::vector<GLuint> remap;
+	std::size_t vertexCount = optimizeVertexFetch(indices, positions.size(), remap);
+	remapVertices(positions, remap, vertexCount);
+	if(normals)
+		remapVertices(*normals, remap, vertexCount);
+	if(texels)
+		remapVertices(*texels, remap, vertexCount);
+
+	report.after = analyzeVertexCache(indices, vertexCount);
+	return report;
+}
+
+MeshOptimizeReport optimizeMesh(IndexedVertexArray &iva, bool overdraw, bool flip)
+{
+	return optimizeMesh(iva.positions, iva.indices, overdraw, flip, &iva.normals, &iva.texels);
+}
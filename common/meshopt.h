@@ -0,0 +1,79 @@
+/*
+OpenGL examples - Mesh optimizer
+
+Reorders indexed triangle meshes for the GPU before they are uploaded, without
+changing what is drawn:
+	optimizeVertexCache		reorders the triangles so that consecutive triangles reuse the
+							vertices still in the post transform cache (Tipsify, Sander et al.
+							2007). Triangles are emitted in fans around one vertex at a time,
+							moving to the oldest vertex of the fan that stays in the cache
+							while its remaining triangles are emitted, and backing up to a
+							recent vertex or the next unfinished one only at dead ends
+	optimizeOverdraw		splits the cache ordered triangles into clusters and sorts the
+							clusters so that the ones facing away from the center of the mesh
+							are drawn first, where they hide the rest, giving up a little cache
+							efficiency (threshold) for less overdraw
+	optimizeVertexFetch		renumbers the vertices in the order the triangles first use them,
+							so the vertex buffer is read front to back
+optimizeMesh runs all of them on a mesh and its vertex attributes.
+
+The cache is measured as the average number of vertices transformed per triangle
+(ACMR, between 0.5 and 3) and per vertex (ATVR, 1 at best), simulating a FIFO cache.
+*/
+
+#ifndef MESH_OPT_H
+#define MESH_OPT_H
+#include "globj.h"
+#include <vector>
+
+struct VertexCacheStats
+{
+	float acmr;
+	float atvr;
+};
+
+/* simulates drawing the triangles through a FIFO cache of cacheSize vertices */
+VertexCacheStats analyzeVertexCache(const std::vector<GLuint> &indices, std::size_t vertexCount, int cacheSize = 16);
+
+/* reorders the triangles for a cache of cacheSize vertices. if clusters is given, it receives
+	the first triangle of every run the optimizer could not continue from the previous one */
+void optimizeVertexCache(std::vector<GLuint> &indices, std::size_t vertexCount, int cacheSize = 16,
+	std::vector<std::size_t> *clusters = NULL);
+
+/* sorts the clusters found by optimizeVertexCache front to back, after splitting them where
+	the ACMR of the triangles so far is within threshold times the ACMR of the whole cluster.
+	flip is for meshes with clockwise triangles, as in computeNormals */
+void optimizeOverdraw(std::vector<GLuint> &indices, const std::vector<glm::vec3> &positions,
+	const std::vector<std::size_t> &clusters, int cacheSize = 16, float threshold = 1.05f, bool flip = false);
+
+/* renumbers the vertices in order of first use. remap receives the new index of every old
+	vertex, or GLuint(-1) for vertices no triangle uses, which are dropped.
+	returns the number of vertices left */
+std::size_t optimizeVertexFetch(std::vector<GLuint> &indices, std::size_t vertexCount, std::vector<GLuint> &remap);
+
+/* moves every vertex to its index in remap, as given by optimizeVertexFetch. Arrays of
+	another size than remap, such as attributes the mesh does not have, are left as they are */
+template <typename T>
+void remapVertices(std::vector<T> &vertices, const std::vector<GLuint> &remap, std::size_t newCount)
+{
+	if(vertices.size() != remap.size())
+		return;
+	std::vector<T> remapped(newCount);
+	for(std::size_t i = 0; i < remap.size(); ++i)
+		if(remap[i] != GLuint(-1))
+			remapped[remap[i]] = vertices[i];
+	vertices.swap(remapped);
+}
+
+struct MeshOptimizeReport
+{
+	VertexCacheStats before;
+	VertexCacheStats after;
+};
+
+/* runs the optimizers above on a mesh, remapping the attributes that are given and not empty */
+MeshOptimizeReport optimizeMesh(std::vector<glm::vec3> &positions, std::vector<GLuint> &indices,
+	bool overdraw, bool flip = false, std::vector<glm::vec3> *normals = NULL, std::vector<glm::vec2> *texels = NULL);
+MeshOptimizeReport optimizeMesh(IndexedVertexArray &iva, bool overdraw, bool flip = false);
+
+#endif
@@ -0,0 +1,191 @@
+#include "normals.h"
+#include "parallel.h"
+#include "simd.h"
+#include <cmath>
+using namespace glm;
+
+// The corners of floatv::width triangles, as one lane per triangle
+struct TriangleBatch
+{
+	floatv x[3], y[3], z[3];
+	GLuint vertices[3][floatv::width];
+	int count;
+};
+
+// Gathers triangles [first, first + count), a partial batch repeats its last triangle
+static void loadBatch(const std::vector<vec3> &positions, const std::vector<GLuint> &indices,
+std::size_t first, int count, TriangleBatch &batch)
+{
+	const int w = floatv::width;
+	float x[3][w], y[3][w], z[3][w];
+	for(int lane = 0; lane < w; ++lane)
+	{
+		std::size_t t = first + std::min(lane, count - 1);
+		for(int k = 0; k < 3; ++k)
+		{
+			GLuint j = indices[3 * t + k];
+			const vec3 &p = positions[j];
+			x[k][lane] = p.x;
+			y[k][lane] = p.y;
+			z[k][lane] = p.z;
+			batch.vertices[k][lane] = j;
+		}
+	}
+	for(int k = 0; k < 3; ++k)
+	{
+		batch.x[k] = floatv::load(x[k]);
+		batch.y[k] = floatv::load(y[k]);
+		batch.z[k] = floatv::load(z[k]);
+	}
+	batch.count = count;
+}
+
+// The cross product of the edges from corner 0, twice the area times the unit normal
+static void crossEdges(const TriangleBatch &batch, float nx[], float ny[], float nz[])
+{
+	floatv ax = batch.x[1] - batch.x[0], ay = batch.y[1] - batch.y[0], az = batch.z[1] - batch.z[0];
+	floatv bx = batch.x[2] - batch.x[0], by = batch.y[2] - batch.y[0], bz = batch.z[2] - batch.z[0];
+	(ay * bz - az * by).store(nx);
+	(az * bx - ax * bz).store(ny);
+	(ax * by - ay * bx).store(nz);
+}
+
+// The cosine of the angle of each triangle at corner k
+static floatv cornerCosine(const TriangleBatch &batch, int k)
+{
+	int k1 = (k + 1) % 3;
+	int k2 = (k + 2) % 3;
+	floatv ax = batch.x[k1] - batch.x[k], ay = batch.y[k1] - batch.y[k], az = batch.z[k1] - batch.z[k];
+	floatv bx = batch.x[k2] - batch.x[k], by = batch.y[k2] - batch.y[k], bz = batch.z[k2] - batch.z[k];
+	floatv dot = ax * bx + ay * by + az * bz;
+	floatv lengths = sqrt((ax * ax + ay * ay + az * az) * (bx * bx + by * by + bz * bz));
+	return dot / lengths;
+}
+
+// Adds the weighted normals of triangles [first, last) to sums
+static void accumulateNormals(const std::vector<vec3> &positions, const std::vector<GLuint> &indices,
+std::size_t first, std::size_t last, NormalMode mode, vec3 *sums)
+{
+	const int w = floatv::width;
+	TriangleBatch batch;
+	float nx[w], ny[w], nz[w];
+	float cosines[3][w];
+	for(std::size_t t = first; t < last; t += w)
+	{
+		loadBatch(positions, indices, t, int(std::min<std::size_t>(w, last - t)), batch);
+		crossEdges(batch, nx, ny, nz);
+		if(mode == AngleWeightedNormals)
+			for(int k = 0; k < 3; ++k)
+				cornerCosine(batch, k).store(cosines[k]);
+
+		for(int lane = 0; lane < batch.count; ++lane)
+		{
+			vec3 n(nx[lane], ny[lane], nz[lane]);
+			if(mode == AreaWeightedNormals)
+			{
+				for(int k = 0; k < 3; ++k)
+					sums[batch.vertices[k][lane]] += n;
+				continue;
+			}
+
+			float l = length(n);
+			if(l == 0.0f)
+				continue;
+			n /= l;
+			for(int k = 0; k < 3; ++k)
+			{
+				float c = cosines[k][lane];
+				if(c == c) // skips corners with a zero length edge
+					sums[batch.vertices[k][lane]] += n * std::acos(std::max(-1.0f, std::min(1.0f, c)));
+			}
+		}
+	}
+}
+
+// Computes the unit normal of every triangle in [first, last), times sign. Writes them to
+// faceNormals if given, or else straight to the vertices of each triangle
+static void computeFaceNormals(const std::vector<vec3> &positions, const std::vector<GLuint> &indices,
+std::size_t first, std::size_t last, float sign, vec3 *faceNormals, vec3 *normals)
+{
+	const int w = floatv::width;
+	TriangleBatch batch;
+	float nx[w], ny[w], nz[w];
+	for(std::size_t t = first; t < last; t += w)
+	{
+		loadBatch(positions, indices, t, int(std::min<std::size_t>(w, last - t)), batch);
+		crossEdges(batch, nx, ny, nz);
+		for(int lane = 0; lane < batch.count; ++lane)
+		{
+			vec3 n(nx[lane], ny[lane], nz[lane]);
+			float l = length(n);
+			n = l > 0.0f ? n * (sign / l) : vec3(0.0f);
+			if(faceNormals)
+				faceNormals[t + lane] = n;
+			else
+				for(int k = 0; k < 3; ++k)
+					normals[batch.vertices[k][lane]] = n;
+		}
+	}
+}
+
+void computeNormals(const std::vector<vec3> &positions, const std::vector<GLuint> &indices,
+std::vector<vec3> &normals, NormalMode mode, bool flip)
+{
+	normals.assign(positions.size(), vec3(0.0f));
+	std::size_t triangleCount = indices.size() / 3;
+	if(triangleCount == 0)
+		return;
+
+	// One contiguous range of whole batches per worker, small meshes are not worth splitting
+	const std::size_t minTriangles = 4096;
+	int ranges = int(std::min<std::size_t>(getWorkerCount(), (triangleCount + minTriangles - 1) / minTriangles));
+	std::size_t batches = (triangleCount + floatv::width - 1) / floatv::width;
+	auto rangeStart = [&](int r) { return std::min(triangleCount, batches * r / ranges * floatv::width); };
+	float sign = flip ? -1.0f : 1.0f;
+
+	// Scattered in order, so a shared vertex gets the normal of the last triangle using it
+	if(mode == FlatNormals && ranges == 1)
+	{
+		computeFaceNormals(positions, indices, 0, triangleCount, sign, NULL, &normals[0]);
+		return;
+	}
+	if(mode == FlatNormals)
+	{
+		std::vector<vec3> faceNormals(triangleCount);
+		parallelFor(ranges, [&](int r)
+		{
+			computeFaceNormals(positions, indices, rangeStart(r), rangeStart(r + 1), sign, &faceNormals[0], NULL);
+		});
+		for(std::size_t t = 0; t < triangleCount; ++t)
+			for(int k = 0; k < 3; ++k)
+				normals[indices[3 * t + k]] = faceNormals[t];
+		return;
+	}
+
+	// The first range sums into normals, the others into their own buffers
+	std::vector<std::vector<vec3> > partial(ranges - 1);
+	parallelFor(ranges, [&](int r)
+	{
+		vec3 *sums = &normals[0];
+		if(r > 0)
+		{
+			partial[r - 1].assign(positions.size(), vec3(0.0f));
+			sums = &partial[r - 1][0];
+		}
+		accumulateNormals(positions, indices, rangeStart(r), rangeStart(r + 1), mode, sums);
+	});
+
+	const std::size_t block = 16384;
+	parallelFor(int((positions.size() + block - 1) / block), [&](int b)
+	{
+		std::size_t end = std::min(positions.size(), (b + 1) * block);
+		for(std::size_t i = b * block; i < end; ++i)
+		{
+			vec3 n = normals[i];
+			for(std::size_t p = 0; p < partial.size(); ++p)
+				n += partial[p][i];
+			float l = length(n);
+			normals[i] = l > 0.0f ? n * (sign / l) : vec3(0.0f);
+		}
+	});
+}
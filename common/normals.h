@@ -0,0 +1,36 @@
+/*
+OpenGL examples - Normals
+
+Per vertex normals of indexed triangle meshes.
+	computeNormals(positions, indices, normals, mode, flip)
+supports three modes:
+	FlatNormals				every vertex takes the normal of the last triangle that uses it,
+							which is exact for meshes whose triangles do not share vertices
+	AreaWeightedNormals		the sum of the normals of the triangles around the vertex,
+							weighted by their area
+	AngleWeightedNormals	the same, weighted by the angle of each triangle at the vertex,
+							which does not depend on how the surface around it is triangulated
+The triangles are processed floatv::width at a time (see simd.h) and split into one
+range per worker thread (see parallel.h). For the smooth modes each worker sums into
+its own buffer and the buffers are added up afterwards, so the workers never write to
+the same memory.
+*/
+
+#ifndef NORMALS_H
+#define NORMALS_H
+#include "glutils.h"
+#include <vector>
+
+enum NormalMode
+{
+	FlatNormals,
+	AreaWeightedNormals,
+	AngleWeightedNormals
+};
+
+/* normals of counterclockwise triangles point to the side they are seen counterclockwise from,
+	flip reverses them for clockwise meshes. Vertices without triangles get a zero normal */
+void computeNormals(const std::vector<glm::vec3> &positions, const std::vector<GLuint> &indices,
+	std::vector<glm::vec3> &normals, NormalMode mode, bool flip = false);
+
+#endif
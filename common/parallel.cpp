@@ -0,0 +1,16 @@
+#include "parallel.h"
+
+static int workerCount = 0;
+
+int getWorkerCount()
+{
+	if(workerCount > 0)
+		return workerCount;
+	int hw = int(std::thread::hardware_concurrency());
+	return hw > 0 ? hw : 1;
+}
+
+void setWorkerCount(int count)
+{
+	workerCount = count > 0 ? count : 0;
+}
@@ -0,0 +1,76 @@
+/*
+OpenGL examples - Parallel
+
+A minimal worker pool for splitting loops across the available cores.
+	parallelFor(count, body)
+calls body(i) for every i in [0, count) from a set of worker threads.
+Items are handed out one at a time, so unevenly sized items still balance,
+and the call returns once every item has been processed.
+Each call must write its results to storage owned by item i only.
+	parallelTiles(width, y0, y1, tileSize, body)
+does the same for the squares of an image, calling body(x0, y0, x1, y1) for each tile of
+the rows [y0, y1) and adding up what it returns, such as the iterations of a fractal.
+*/
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+/* returns the number of threads used by parallelFor (at least 1) */
+int getWorkerCount();
+
+/* overrides the number of threads used by parallelFor.
+	a count of 0 restores the default (one per hardware thread) */
+void setWorkerCount(int count);
+
+template <typename Body>
+void parallelFor(int count, const Body &body)
+{
+	int workers = std::min(getWorkerCount(), count);
+	if(workers <= 1)
+	{
+		for(int i = 0; i < count; ++i)
+			body(i);
+		return;
+	}
+
+	std::atomic<int> next(0);
+	auto work = [&]()
+	{
+		for(int i = next++; i < count; i = next++)
+			body(i);
+	};
+
+	// The calling thread works as well, so spawn one less
+	std::vector<std::thread> threads;
+	for(int t = 1; t < workers; ++t)
+		threads.push_back(std::thread(work));
+	work();
+	for(std::size_t t = 0; t < threads.size(); ++t)
+		threads[t].join();
+}
+
+template <typename Body>
+std::uint64_t parallelTiles(int width, int y0, int y1, int tileSize, const Body &body)
+{
+	int tilesX = (width + tileSize - 1) / tileSize;
+	int tilesY = (y1 - y0 + tileSize - 1) / tileSize;
+	std::vector<std::uint64_t> sums(std::max(tilesX * tilesY, 0));
+	parallelFor(int(sums.size()), [&](int t)
+	{
+		int x = t % tilesX * tileSize;
+		int y = y0 + t / tilesX * tileSize;
+		sums[t] = body(x, y, std::min(width, x + tileSize), std::min(y1, y + tileSize));
+	});
+
+	std::uint64_t sum = 0;
+	for(std::size_t t = 0; t < sums.size(); ++t)
+		sum += sums[t];
+	return sum;
+}
+
+#endif
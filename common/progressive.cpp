@@ -0,0 +1,180 @@
+#include "progressive.h"
+#include "parallel.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+// Small enough that a tile of deep pixels takes a few milliseconds, so refine can stop
+// close to its time even at high iteration caps
+static const int tileSize = 16;
+
+ProgressiveImage::ProgressiveImage() : width(0), height(0), tilesX(0), tilesY(0), pendingTiles(0), iterations(0)
+{
+}
+
+void ProgressiveImage::resize(int width, int height)
+{
+	this->width = std::max(0, width);
+	this->height = std::max(0, height);
+	tilesX = (this->width + tileSize - 1) / tileSize;
+	tilesY = (this->height + tileSize - 1) / tileSize;
+	iterations = 0;
+	counts.assign(std::size_t(this->width) * this->height, 0);
+	done.assign(counts.size(), 0);
+	pending.assign(tilesX * tilesY, 0);
+
+	order.resize(tilesX * tilesY);
+	for(int t = 0; t < tilesX * tilesY; ++t)
+		order[t] = t;
+	auto distance = [&](int t)
+	{
+		float dx = (float(t % tilesX) + 0.5f) * tileSize - 0.5f * this->width;
+		float dy = (float(t / tilesX) + 0.5f) * tileSize - 0.5f * this->height;
+		return dx * dx + dy * dy;
+	};
+	std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return distance(a) < distance(b); });
+
+	countPending();
+}
+
+void ProgressiveImage::invalidate()
+{
+	std::fill(done.begin(), done.end(), 0);
+	countPending();
+}
+
+void ProgressiveImage::shift(int dx, int dy)
+{
+	if(dx == 0 && dy == 0)
+		return;
+
+	// The pixels that come in repeat the old edge until they are computed
+	scratchCounts = counts;
+	scratchDone = done;
+	for(int y = 0; y < height; ++y)
+	{
+		int sy = y - dy;
+		bool inside = sy >= 0 && sy < height;
+		sy = std::min(std::max(sy, 0), height - 1);
+		for(int x = 0; x < width; ++x)
+		{
+			int sx = x - dx;
+			std::size_t from = std::size_t(sy) * width + std::min(std::max(sx, 0), width - 1);
+			std::size_t to = std::size_t(y) * width + x;
+			counts[to] = scratchCounts[from];
+			done[to] = inside && sx >= 0 && sx < width ? scratchDone[from] : 0;
+		}
+	}
+	countPending();
+}
+
+void ProgressiveImage::zoom(double factor)
+{
+	if(factor == 1.0)
+		return;
+
+	// Nearest neighbour, the preview only has to last until the tiles come in
+	scratchCounts = counts;
+	for(int y = 0; y < height; ++y)
+	{
+		int sy = int(std::floor((double(y) + 0.5 - 0.5 * height) * factor + 0.5 * height));
+		sy = std::min(std::max(sy, 0), height - 1);
+		for(int x = 0; x < width; ++x)
+		{
+			int sx = int(std::floor((double(x) + 0.5 - 0.5 * width) * factor + 0.5 * width));
+			sx = std::min(std::max(sx, 0), width - 1);
+			counts[std::size_t(y) * width + x] = scratchCounts[std::size_t(sy) * width + sx];
+		}
+	}
+	invalidate();
+}
+
+bool ProgressiveImage::refine(const Kernel &kernel, double seconds)
+{
+	if(pendingTiles == 0)
+		return false;
+
+	// A few tiles per worker at a time, then check the clock
+	const int batchSize = 4 * getWorkerCount();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<int> batch;
+	std::vector<std::uint64_t> sums;
+	std::size_t next = 0;
+	while(pendingTiles > 0)
+	{
+		batch.clear();
+		for(; next < order.size() && int(batch.size()) < batchSize; ++next)
+			if(pending[order[next]] > 0)
+				batch.push_back(order[next]);
+
+		sums.assign(batch.size(), 0);
+		parallelFor(int(batch.size()), [&](int i)
+		{
+			sums[i] = refineTile(kernel, batch[i]);
+		});
+		for(std::size_t i = 0; i < sums.size(); ++i)
+			iterations += sums[i];
+		pendingTiles -= int(batch.size());
+
+		if(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= seconds)
+			break;
+	}
+	return true;
+}
+
+void ProgressiveImage::countPending()
+{
+	pendingTiles = 0;
+	for(int t = 0; t < tilesX * tilesY; ++t)
+	{
+		int x0 = t % tilesX * tileSize, x1 = std::min(width, x0 + tileSize);
+		int y0 = t / tilesX * tileSize, y1 = std::min(height, y0 + tileSize);
+		int n = 0;
+		for(int y = y0; y < y1; ++y)
+			for(int x = x0; x < x1; ++x)
+				n += done[std::size_t(y) * width + x] ? 0 : 1;
+		pending[t] = n;
+		pendingTiles += n > 0 ? 1 : 0;
+	}
+}
+
+// Computes the span of each row of the tile that is not done. Rows with the same span,
+// all of them after a zoom, go to the kernel as one rectangle
+std::uint64_t ProgressiveImage::refineTile(const Kernel &kernel, int tile)
+{
+	int x0 = tile % tilesX * tileSize, x1 = std::min(width, x0 + tileSize);
+	int y0 = tile / tilesX * tileSize, y1 = std::min(height, y0 + tileSize);
+	std::uint64_t sum = 0;
+	int spanY = y0, spanX0 = 0, spanX1 = 0;
+	for(int y = y0; y <= y1; ++y)
+	{
+		int a = x1, b = x0;
+		if(y < y1)
+		{
+			const unsigned char *row = &done[std::size_t(y) * width];
+			for(int x = x0; x < x1; ++x)
+			{
+				if(!row[x])
+				{
+					a = std::min(a, x);
+					b = x + 1;
+				}
+			}
+		}
+		if(y < y1 && a == spanX0 && b == spanX1)
+			continue;
+
+		if(spanX0 < spanX1)
+		{
+			sum += kernel(spanX0, spanY, spanX1, y, &counts[std::size_t(spanY) * width + spanX0], width);
+			for(int r = spanY; r < y; ++r)
+				std::memset(&done[std::size_t(r) * width + spanX0], 1, spanX1 - spanX0);
+		}
+		spanY = y;
+		spanX0 = a;
+		spanX1 = b;
+	}
+	pending[tile] = 0;
+	return sum;
+}
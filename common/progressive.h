@@ -0,0 +1,77 @@
+/*
+OpenGL examples - Progressive rendering
+
+An image of iteration counts (see mandelbrot.h and deepzoom.h) that is kept from frame to
+frame, so a moving view only computes what it has not seen yet:
+	image.resize(640, 480);
+	each frame:
+		image.shift(dx, dy) after panning the view by whole pixels
+		image.zoom(factor) after scaling the view about its center
+		if(image.refine(kernel, 0.02)) ... upload image.getCounts()
+A shift keeps the pixels that are still in view and only the strips that come in are
+computed again. A zoom resamples the old pixels as a preview and every pixel is computed
+again, from the center of the image outwards, so the middle sharpens first. refine works
+for a given time and picks up where it stopped on the next call, and once every pixel is
+done it returns at once without touching the image, so a still view costs nothing.
+*/
+
+#ifndef PROGRESSIVE_H
+#define PROGRESSIVE_H
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class ProgressiveImage
+{
+public:
+	/* writes the counts of the pixels [x0, x1) x [y0, y1) to counts, rows stride counts apart,
+		like iterateMandelbrot. called from the workers (see parallel.h) */
+	typedef std::function<std::uint64_t(int x0, int y0, int x1, int y1, int *counts, int stride)> Kernel;
+
+	ProgressiveImage();
+
+	/* clears the image to width x height pixels, none of them computed */
+	void resize(int width, int height);
+
+	/* marks every pixel to be computed again, keeping the old counts as a preview */
+	void invalidate();
+
+	/* moves the pixel (x, y) to (x + dx, y + dy), the pixels that come in are computed again */
+	void shift(int dx, int dy);
+
+	/* resamples the image for a view factor times the size of the old one about the same
+		center, factor < 1 zooms in. every pixel is computed again */
+	void zoom(double factor);
+
+	/* computes the pixels that are not done, tile by tile from the center, until seconds have passed.
+		return true if any pixel changed.
+		return false if the image was already done */
+	bool refine(const Kernel &kernel, double seconds);
+
+	bool isDone() const { return pendingTiles == 0; }
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	const int *getCounts() const { return counts.empty() ? nullptr : &counts[0]; }
+
+	/* the iterations of every refine since the last resize */
+	std::uint64_t getIterations() const { return iterations; }
+
+private:
+	void countPending();
+	std::uint64_t refineTile(const Kernel &kernel, int tile);
+
+	int width;
+	int height;
+	int tilesX;
+	int tilesY;
+	int pendingTiles;
+	std::uint64_t iterations;
+	std::vector<int> counts;
+	std::vector<unsigned char> done; // per pixel
+	std::vector<int> pending; // pixels not done per tile
+	std::vector<int> order; // the tiles by their distance to the center
+	std::vector<int> scratchCounts;
+	std::vector<unsigned char> scratchDone;
+};
+
+#endif
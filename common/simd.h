@@ -0,0 +1,237 @@
+/*
+OpenGL examples - SIMD
+
+floatv holds floatv::width floats and behaves like a float under + - * /, unary minus,
+min, max, abs and sqrt, so formulas written as templates over the number type run on
+SIMD lanes unchanged. Comparisons return masks, every bit set in the lanes where they
+hold, for & | and andNot, select(mask, a, b), any(mask) and maskBits(mask), which has
+bit i set for lane i. doublev is the same for doubles, with half as many lanes. The
+widest instruction set enabled at compile time is used:
+	AVX		8 float lanes, 4 double lanes
+	SSE2	4 float lanes, 2 double lanes
+	none	1 lane (scalar fallback)
+Loads and stores are unaligned.
+*/
+
+#ifndef SIMD_H
+#define SIMD_H
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SIMD_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_SSE
+#endif
+
+#if defined(SIMD_AVX)
+
+struct floatv
+{
+	static const int width = 8;
+	__m256 v;
+
+	floatv() { }
+	floatv(float s) : v(_mm256_set1_ps(s)) { }
+	floatv(__m256 m) : v(m) { }
+
+	static floatv load(const float *p) { return _mm256_loadu_ps(p); }
+	void store(float *p) const { _mm256_storeu_ps(p, v); }
+};
+
+inline floatv operator+(floatv a, floatv b) { return _mm256_add_ps(a.v, b.v); }
+inline floatv operator-(floatv a, floatv b) { return _mm256_sub_ps(a.v, b.v); }
+inline floatv operator*(floatv a, floatv b) { return _mm256_mul_ps(a.v, b.v); }
+inline floatv operator/(floatv a, floatv b) { return _mm256_div_ps(a.v, b.v); }
+inline floatv operator-(floatv a) { return _mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f)); }
+inline floatv min(floatv a, floatv b) { return _mm256_min_ps(a.v, b.v); }
+inline floatv max(floatv a, floatv b) { return _mm256_max_ps(a.v, b.v); }
+inline floatv abs(floatv a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v); }
+inline floatv sqrt(floatv a) { return _mm256_sqrt_ps(a.v); }
+
+inline floatv operator<(floatv a, floatv b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+inline floatv operator<=(floatv a, floatv b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ); }
+inline floatv operator>(floatv a, floatv b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); }
+inline floatv operator>=(floatv a, floatv b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ); }
+inline floatv operator&(floatv a, floatv b) { return _mm256_and_ps(a.v, b.v); }
+inline floatv operator|(floatv a, floatv b) { return _mm256_or_ps(a.v, b.v); }
+inline floatv andNot(floatv mask, floatv a) { return _mm256_andnot_ps(mask.v, a.v); }
+inline floatv select(floatv mask, floatv a, floatv b) { return _mm256_blendv_ps(b.v, a.v, mask.v); }
+inline bool any(floatv mask) { return _mm256_movemask_ps(mask.v) != 0; }
+inline int maskBits(floatv mask) { return _mm256_movemask_ps(mask.v); }
+
+struct doublev
+{
+	static const int width = 4;
+	__m256d v;
+
+	doublev() { }
+	doublev(double s) : v(_mm256_set1_pd(s)) { }
+	doublev(__m256d m) : v(m) { }
+
+	static doublev load(const double *p) { return _mm256_loadu_pd(p); }
+	void store(double *p) const { _mm256_storeu_pd(p, v); }
+};
+
+inline doublev operator+(doublev a, doublev b) { return _mm256_add_pd(a.v, b.v); }
+inline doublev operator-(doublev a, doublev b) { return _mm256_sub_pd(a.v, b.v); }
+inline doublev operator*(doublev a, doublev b) { return _mm256_mul_pd(a.v, b.v); }
+inline doublev operator/(doublev a, doublev b) { return _mm256_div_pd(a.v, b.v); }
+inline doublev operator-(doublev a) { return _mm256_xor_pd(a.v, _mm256_set1_pd(-0.0)); }
+inline doublev abs(doublev a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v); }
+inline doublev operator<(doublev a, doublev b) { return _mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ); }
+inline doublev operator<=(doublev a, doublev b) { return _mm256_cmp_pd(a.v, b.v, _CMP_LE_OQ); }
+inline doublev operator>(doublev a, doublev b) { return _mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ); }
+inline doublev operator>=(doublev a, doublev b) { return _mm256_cmp_pd(a.v, b.v, _CMP_GE_OQ); }
+inline doublev operator&(doublev a, doublev b) { return _mm256_and_pd(a.v, b.v); }
+inline doublev operator|(doublev a, doublev b) { return _mm256_or_pd(a.v, b.v); }
+inline doublev andNot(doublev mask, doublev a) { return _mm256_andnot_pd(mask.v, a.v); }
+inline doublev select(doublev mask, doublev a, doublev b) { return _mm256_blendv_pd(b.v, a.v, mask.v); }
+inline bool any(doublev mask) { return _mm256_movemask_pd(mask.v) != 0; }
+inline int maskBits(doublev mask) { return _mm256_movemask_pd(mask.v); }
+
+#elif defined(SIMD_SSE)
+
+struct floatv
+{
+	static const int width = 4;
+	__m128 v;
+
+	floatv() { }
+	floatv(float s) : v(_mm_set1_ps(s)) { }
+	floatv(__m128 m) : v(m) { }
+
+	static floatv load(const float *p) { return _mm_loadu_ps(p); }
+	void store(float *p) const { _mm_storeu_ps(p, v); }
+};
+
+inline floatv operator+(floatv a, floatv b) { return _mm_add_ps(a.v, b.v); }
+inline floatv operator-(floatv a, floatv b) { return _mm_sub_ps(a.v, b.v); }
+inline floatv operator*(floatv a, floatv b) { return _mm_mul_ps(a.v, b.v); }
+inline floatv operator/(floatv a, floatv b) { return _mm_div_ps(a.v, b.v); }
+inline floatv operator-(floatv a) { return _mm_xor_ps(a.v, _mm_set1_ps(-0.0f)); }
+inline floatv min(floatv a, floatv b) { return _mm_min_ps(a.v, b.v); }
+inline floatv max(floatv a, floatv b) { return _mm_max_ps(a.v, b.v); }
+inline floatv abs(floatv a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); }
+inline floatv sqrt(floatv a) { return _mm_sqrt_ps(a.v); }
+
+inline floatv operator<(floatv a, floatv b) { return _mm_cmplt_ps(a.v, b.v); }
+inline floatv operator<=(floatv a, floatv b) { return _mm_cmple_ps(a.v, b.v); }
+inline floatv operator>(floatv a, floatv b) { return _mm_cmpgt_ps(a.v, b.v); }
+inline floatv operator>=(floatv a, floatv b) { return _mm_cmpge_ps(a.v, b.v); }
+inline floatv operator&(floatv a, floatv b) { return _mm_and_ps(a.v, b.v); }
+inline floatv operator|(floatv a, floatv b) { return _mm_or_ps(a.v, b.v); }
+inline floatv andNot(floatv mask, floatv a) { return _mm_andnot_ps(mask.v, a.v); }
+inline floatv select(floatv mask, floatv a, floatv b) { return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); }
+inline bool any(floatv mask) { return _mm_movemask_ps(mask.v) != 0; }
+inline int maskBits(floatv mask) { return _mm_movemask_ps(mask.v); }
+
+struct doublev
+{
+	static const int width = 2;
+	__m128d v;
+
+	doublev() { }
+	doublev(double s) : v(_mm_set1_pd(s)) { }
+	doublev(__m128d m) : v(m) { }
+
+	static doublev load(const double *p) { return _mm_loadu_pd(p); }
+	void store(double *p) const { _mm_storeu_pd(p, v); }
+};
+
+inline doublev operator+(doublev a, doublev b) { return _mm_add_pd(a.v, b.v); }
+inline doublev operator-(doublev a, doublev b) { return _mm_sub_pd(a.v, b.v); }
+inline doublev operator*(doublev a, doublev b) { return _mm_mul_pd(a.v, b.v); }
+inline doublev operator/(doublev a, doublev b) { return _mm_div_pd(a.v, b.v); }
+inline doublev operator-(doublev a) { return _mm_xor_pd(a.v, _mm_set1_pd(-0.0)); }
+inline doublev abs(doublev a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a.v); }
+inline doublev operator<(doublev a, doublev b) { return _mm_cmplt_pd(a.v, b.v); }
+inline doublev operator<=(doublev a, doublev b) { return _mm_cmple_pd(a.v, b.v); }
+inline doublev operator>(doublev a, doublev b) { return _mm_cmpgt_pd(a.v, b.v); }
+inline doublev operator>=(doublev a, doublev b) { return _mm_cmpge_pd(a.v, b.v); }
+inline doublev operator&(doublev a, doublev b) { return _mm_and_pd(a.v, b.v); }
+inline doublev operator|(doublev a, doublev b) { return _mm_or_pd(a.v, b.v); }
+inline doublev andNot(doublev mask, doublev a) { return _mm_andnot_pd(mask.v, a.v); }
+inline doublev select(doublev mask, doublev a, doublev b) { return _mm_or_pd(_mm_and_pd(mask.v, a.v), _mm_andnot_pd(mask.v, b.v)); }
+inline bool any(doublev mask) { return _mm_movemask_pd(mask.v) != 0; }
+inline int maskBits(doublev mask) { return _mm_movemask_pd(mask.v); }
+
+#else
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+struct floatv
+{
+	static const int width = 1;
+	float v;
+
+	floatv() { }
+	floatv(float s) : v(s) { }
+
+	static floatv load(const float *p) { return *p; }
+	void store(float *p) const { *p = v; }
+};
+
+inline floatv operator+(floatv a, floatv b) { return a.v + b.v; }
+inline floatv operator-(floatv a, floatv b) { return a.v - b.v; }
+inline floatv operator*(floatv a, floatv b) { return a.v * b.v; }
+inline floatv operator/(floatv a, floatv b) { return a.v / b.v; }
+inline floatv operator-(floatv a) { return -a.v; }
+inline floatv min(floatv a, floatv b) { return std::min(a.v, b.v); }
+inline floatv max(floatv a, floatv b) { return std::max(a.v, b.v); }
+inline floatv abs(floatv a) { return std::abs(a.v); }
+inline floatv sqrt(floatv a) { return std::sqrt(a.v); }
+
+// A mask has every bit set, or none
+inline floatv floatMask(bool b) { unsigned int bits = b ? ~0u : 0u; float f; std::memcpy(&f, &bits, sizeof(f)); return f; }
+inline unsigned int toBits(floatv a) { unsigned int bits; std::memcpy(&bits, &a.v, sizeof(bits)); return bits; }
+inline floatv floatFromBits(unsigned int bits) { float f; std::memcpy(&f, &bits, sizeof(f)); return f; }
+
+inline floatv operator<(floatv a, floatv b) { return floatMask(a.v < b.v); }
+inline floatv operator<=(floatv a, floatv b) { return floatMask(a.v <= b.v); }
+inline floatv operator>(floatv a, floatv b) { return floatMask(a.v > b.v); }
+inline floatv operator>=(floatv a, floatv b) { return floatMask(a.v >= b.v); }
+inline floatv operator&(floatv a, floatv b) { return floatFromBits(toBits(a) & toBits(b)); }
+inline floatv operator|(floatv a, floatv b) { return floatFromBits(toBits(a) | toBits(b)); }
+inline floatv andNot(floatv mask, floatv a) { return floatFromBits(~toBits(mask) & toBits(a)); }
+inline floatv select(floatv mask, floatv a, floatv b) { return toBits(mask) ? a : b; }
+inline bool any(floatv mask) { return toBits(mask) != 0; }
+inline int maskBits(floatv mask) { return toBits(mask) != 0 ? 1 : 0; }
+
+struct doublev
+{
+	static const int width = 1;
+	double v;
+
+	doublev() { }
+	doublev(double s) : v(s) { }
+
+	static doublev load(const double *p) { return *p; }
+	void store(double *p) const { *p = v; }
+};
+
+inline doublev doubleMask(bool b) { unsigned long long bits = b ? ~0ull : 0ull; double d; std::memcpy(&d, &bits, sizeof(d)); return d; }
+inline unsigned long long toBits(doublev a) { unsigned long long bits; std::memcpy(&bits, &a.v, sizeof(bits)); return bits; }
+inline doublev doubleFromBits(unsigned long long bits) { double d; std::memcpy(&d, &bits, sizeof(d)); return d; }
+
+inline doublev operator+(doublev a, doublev b) { return a.v + b.v; }
+inline doublev operator-(doublev a, doublev b) { return a.v - b.v; }
+inline doublev operator*(doublev a, doublev b) { return a.v * b.v; }
+inline doublev operator/(doublev a, doublev b) { return a.v / b.v; }
+inline doublev operator-(doublev a) { return -a.v; }
+inline doublev abs(doublev a) { return std::abs(a.v); }
+inline doublev operator<(doublev a, doublev b) { return doubleMask(a.v < b.v); }
+inline doublev operator<=(doublev a, doublev b) { return doubleMask(a.v <= b.v); }
+inline doublev operator>(doublev a, doublev b) { return doubleMask(a.v > b.v); }
+inline doublev operator>=(doublev a, doublev b) { return doubleMask(a.v >= b.v); }
+inline doublev operator&(doublev a, doublev b) { return doubleFromBits(toBits(a) & toBits(b)); }
+inline doublev operator|(doublev a, doublev b) { return doubleFromBits(toBits(a) | toBits(b)); }
+inline doublev andNot(doublev mask, doublev a) { return doubleFromBits(~toBits(mask) & toBits(a)); }
+inline doublev select(doublev mask, doublev a, doublev b) { return toBits(mask) ? a : b; }
+inline bool any(doublev mask) { return toBits(mask) != 0; }
+inline int maskBits(doublev mask) { return toBits(mask) != 0 ? 1 : 0; }
+
+#endif
+
+#endif
@@ -0,0 +1,305 @@
+#include "spherelod.h"
+#include "cubesphere.h"
+#include <algorithm>
+#include <cmath>
+using namespace glm;
+
+static const float PI = 3.1415926535f;
+static const int maxTreeLevel = 20; // the keys have 24 bits for x and y
+
+// The grid index of border vertex k of a patch, on a walk around the border that
+// keeps the patch on its left seen from outside
+static int getBorderVertex(int g, int k)
+{
+	int side = k / g, step = k % g;
+	int i = side == 0 ? step : side == 1 ? g : side == 2 ? g - step : 0;
+	int j = side == 0 ? 0 : side == 1 ? step : side == 2 ? g : g - step;
+	return j * (g + 1) + i;
+}
+
+SphereLod::SphereLod() : radius(1.0f), patchSize(0), vertexCount(0), indexCount(0), slotBytes(0), vbo(0), ibo(0),
+	maxError(16.0f), maxLevel(16), generationBudget(32), horizonAngle(PI), pixelsPerRadian(0.0f), frame(0),
+	generated(0), deepestLevel(0)
+{
+}
+
+void SphereLod::create(float radius, int patchSize, int poolSize)
+{
+	this->radius = radius;
+	this->patchSize = patchSize = std::max(1, std::min(128, patchSize));
+	poolSize = std::max(6, poolSize);
+	const int g = patchSize;
+	const int grid = (g + 1) * (g + 1);
+	vertexCount = grid + 4 * g;
+
+	// The grid, clockwise seen from outside like the cube sphere
+	std::vector<GLushort> indices;
+	indices.reserve(6 * g * g + 24 * g);
+	for(int j = 0; j < g; ++j)
+	{
+		for(int i = 0; i < g; ++i)
+		{
+			GLushort a = GLushort(j * (g + 1) + i);
+			GLushort b = GLushort(a + 1);
+			GLushort c = GLushort(a + g + 2);
+			GLushort d = GLushort(a + g + 1);
+			GLushort quad[6] = { a, d, c, c, b, a };
+			indices.insert(indices.end(), quad, quad + 6);
+		}
+	}
+
+	// The skirt vertices follow the grid, one below each border vertex in the order of the walk
+	for(int k = 0; k < 4 * g; ++k)
+	{
+		GLushort a = GLushort(getBorderVertex(g, k));
+		GLushort b = GLushort(getBorderVertex(g, (k + 1) % (4 * g)));
+		GLushort c = GLushort(grid + (k + 1) % (4 * g));
+		GLushort d = GLushort(grid + k);
+		GLushort quad[6] = { a, b, c, c, d, a };
+		indices.insert(indices.end(), quad, quad + 6);
+	}
+	indexCount = int(indices.size());
+
+	PackedVertexFormat format = getPackedVertexFormat(vec3(-radius), vec3(radius), true, false, false, Directions8);
+	slotBytes = GLsizeiptr(vertexCount) * format.stride;
+
+	if(vbo == 0)
+		glGenBuffers(1, &vbo);
+	if(ibo == 0)
+		glGenBuffers(1, &ibo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, slotBytes * poolSize, NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), &indices[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	Slot free = { 0, format, 0 };
+	slots.assign(poolSize, free);
+	residents.clear();
+	selected.clear();
+
+	// The roots take the first six slots and are never evicted, so there is always something to draw
+	frame = 1;
+	for(int f = 0; f < 6; ++f)
+	{
+		Node root = { f, 0, 0, 0 };
+		buildPatch(root);
+	}
+}
+
+uint64_t SphereLod::getKey(const Node &node)
+{
+	return (uint64_t(node.level + 1) << 51) | (uint64_t(node.face) << 48) | (uint64_t(node.y) << 24) | uint64_t(node.x);
+}
+
+// The direction of the point (s, t) of the patch, with s and t in [0, 1]
+vec3 SphereLod::getPoint(const Node &node, float s, float t) const
+{
+	const CubeFace &c = cubeFaces[node.face];
+	float size = 2.0f / float(1 << node.level);
+	return normalize(c.center + c.u * (size * (float(node.x) + s) - 1.0f) + c.v * (size * (float(node.y) + t) - 1.0f));
+}
+
+SphereLod::Bounds SphereLod::getBounds(const Node &node) const
+{
+	// The edges of a patch are great circles, so its farthest points from the middle are corners.
+	// Angles come from chords, the arc cosine of a dot product near 1 loses the small patches
+	Bounds bounds;
+	vec3 middle = getPoint(node, 0.5f, 0.5f);
+	float chord = 0.0f;
+	for(int corner = 0; corner < 4; ++corner)
+		chord = std::max(chord, length(getPoint(node, float(corner & 1), float(corner >> 1)) - middle));
+	bounds.center = middle * radius;
+	bounds.angle = 2.0f * std::asin(std::min(1.0f, 0.5f * chord));
+	bounds.radius = chord * radius;
+	return bounds;
+}
+
+bool SphereLod::isVisible(const Bounds &bounds) const
+{
+	// Past the horizon when the nearest point of the patch is farther from the eye than the horizon
+	float distance = length(eye);
+	if(distance > 0.0f)
+	{
+		float angle = std::atan2(length(cross(bounds.center, eye)), dot(bounds.center, eye));
+		if(angle - bounds.angle >= horizonAngle)
+			return false;
+	}
+
+	for(int i = 0; i < 6; ++i)
+		if(dot(vec3(planes[i]), bounds.center) + planes[i].w < -bounds.radius)
+			return false;
+	return true;
+}
+
+// The length on screen of an edge of the quads of the patch, seen from its nearest point.
+// The chords of a smooth sphere are much closer to it than that, but a refinement driven by
+// them would leave a handful of huge triangles around the eye near the surface, for the
+// lighting and the texturing to be interpolated over
+float SphereLod::getScreenError(const Node &node, const Bounds &bounds) const
+{
+	float quadSize = radius * 2.0f / float(patchSize << node.level);
+	float distance = std::max(length(bounds.center - eye) - bounds.radius, radius * 1e-7f);
+	return quadSize / distance * pixelsPerRadian;
+}
+
+// The slot of the patch if it is in the pool, marked as used by this update
+int SphereLod::findPatch(const Node &node)
+{
+	std::unordered_map<uint64_t, int>::iterator found = residents.find(getKey(node));
+	if(found == residents.end())
+		return -1;
+	slots[found->second].lastUsed = frame;
+	return found->second;
+}
+
+// Builds the patch into the least recently used slot not used by this update.
+// returns the slot, or -1 if every slot is in use
+int SphereLod::buildPatch(const Node &node)
+{
+	int slot = -1;
+	for(int i = node.level == 0 ? 0 : 6; i < int(slots.size()); ++i)
+		if(slots[i].lastUsed < frame && (slot < 0 || slots[i].lastUsed < slots[slot].lastUsed))
+			slot = i;
+	if(slot < 0)
+		return -1;
+	if(slots[slot].key != 0)
+		residents.erase(slots[slot].key);
+
+	const int g = patchSize;
+	positions.clear();
+	normals.clear();
+	for(int j = 0; j <= g; ++j)
+	{
+		for(int i = 0; i <= g; ++i)
+		{
+			vec3 normal = getPoint(node, float(i) / float(g), float(j) / float(g));
+			positions.push_back(normal * radius);
+			normals.push_back(normal);
+		}
+	}
+
+	// About a quad deep, a patch next to one a few levels coarser leaves a smaller gap
+	float depth = radius * 2.0f / float(g << node.level);
+	for(int k = 0; k < 4 * g; ++k)
+	{
+		vec3 normal = normals[getBorderVertex(g, k)];
+		positions.push_back(normal * (radius - depth));
+		normals.push_back(normal);
+	}
+
+	vec3 boxMin, boxMax;
+	computeBounds(positions, boxMin, boxMax);
+	Slot &s = slots[slot];
+	s.key = getKey(node);
+	s.format = getPackedVertexFormat(boxMin, boxMax, true, false, false, Directions8);
+	s.lastUsed = frame;
+	residents[s.key] = slot;
+	packVertices(s.format, positions, &normals, NULL, NULL, packed);
+
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferSubData(GL_ARRAY_BUFFER, slot * slotBytes, packed.size(), &packed[0]);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	++generated;
+	return slot;
+}
+
+void SphereLod::select(const Node &node, const Bounds &bounds)
+{
+	if(node.level < std::min(maxLevel, maxTreeLevel) && getScreenError(node, bounds) > maxError)
+	{
+		// Split only once every visible child can be drawn, the others are skipped
+		Node children[4];
+		Bounds childBounds[4];
+		bool visible[4];
+		bool ready = true;
+		for(int c = 0; c < 4; ++c)
+		{
+			Node child = { node.face, node.level + 1, 2 * node.x + (c & 1), 2 * node.y + (c >> 1) };
+			children[c] = child;
+			childBounds[c] = getBounds(child);
+			visible[c] = isVisible(childBounds[c]);
+			if(!visible[c] || findPatch(child) >= 0)
+				continue;
+			if(generated >= generationBudget || buildPatch(child) < 0)
+				ready = false;
+		}
+
+		if(ready)
+		{
+			for(int c = 0; c < 4; ++c)
+				if(visible[c])
+					select(children[c], childBounds[c]);
+			return;
+		}
+	}
+
+	int slot = findPatch(node);
+	if(slot < 0)
+		slot = buildPatch(node);
+	if(slot < 0)
+		return;
+	selected.push_back(slot);
+	deepestLevel = std::max(deepestLevel, node.level);
+}
+
+void SphereLod::update(const vec3 &eye, const mat4 &viewProjection, float pixelsPerRadian)
+{
+	++frame;
+	generated = 0;
+	deepestLevel = 0;
+	selected.clear();
+	this->eye = eye;
+	this->pixelsPerRadian = pixelsPerRadian;
+	float distance = length(eye);
+	horizonAngle = distance > radius ? std::atan2(std::sqrt((distance - radius) * (distance + radius)), radius) : PI;
+
+	// The planes of the frustum from the rows of the matrix, pointing inside
+	vec4 rows[4];
+	for(int i = 0; i < 4; ++i)
+		rows[i] = vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	for(int i = 0; i < 3; ++i)
+	{
+		planes[2 * i] = rows[3] + rows[i];
+		planes[2 * i + 1] = rows[3] - rows[i];
+	}
+	for(int i = 0; i < 6; ++i)
+		planes[i] /= length(vec3(planes[i]));
+
+	for(int f = 0; f < 6; ++f)
+	{
+		Node root = { f, 0, 0, 0 };
+		Bounds bounds = getBounds(root);
+		if(isVisible(bounds))
+			select(root, bounds);
+	}
+}
+
+void SphereLod::bindBuffers()
+{
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+}
+
+void SphereLod::draw(GLint positionAttrib, GLint normalAttrib, GLint scaleUniform, GLint offsetUniform) const
+{
+	for(std::size_t i = 0; i < selected.size(); ++i)
+	{
+		const Slot &slot = slots[selected[i]];
+		slot.format.apply(positionAttrib, normalAttrib, -1, -1, selected[i] * slotBytes);
+		slot.format.setPositionUniforms(scaleUniform, offsetUniform);
+		glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_SHORT, 0);
+	}
+}
+
+void SphereLod::destroy()
+{
+	glDeleteBuffers(1, &vbo);
+	glDeleteBuffers(1, &ibo);
+	vbo = 0;
+	ibo = 0;
+	slots.clear();
+	residents.clear();
+	selected.clear();
+}
@@ -0,0 +1,128 @@
+/*
+OpenGL examples - Sphere LOD
+
+A cube sphere (see cubesphere.h) drawn at the level of detail the view needs, as
+chunked LOD. Every cube face is the root of a quadtree whose nodes, patches, are
+grids of patchSize x patchSize quads, so each level halves the size of the quads.
+	update(eye, viewProjection, pixelsPerRadian)
+walks the trees from the roots and refines a patch while its quads, seen from the
+nearest point of the patch, would be more than maxError pixels across. Patches beyond
+the horizon seen from the eye, or outside the view frustum, are skipped with their
+subtrees. The number of triangles then depends on the screen rather than on the
+distance to the surface, and stays about the same from orbit down to the ground.
+
+Patches of different levels do not share the vertices along their edges, which would
+leave cracks where a finer patch meets a coarser one. Each patch hangs a skirt from its
+border, a strip of triangles down towards the center of the sphere deep enough to hide
+the gap. Skirts never reach outside the silhouette of the sphere, so they are not seen.
+
+The meshes of the patches are kept in a pool of fixed size slots in a single vertex
+buffer, all sharing one index buffer. A patch stays in the pool after it is no longer
+drawn, so zooming back out costs nothing, and the least recently used slot is reused
+when a new patch is needed. A patch is only split once its four children are in the
+pool, and at most generationBudget patches are built per update, so refining spreads
+over a few frames instead of stalling one. Vertices are packed (see vertexpack.h) to
+the bounds of their patch, so they keep their precision however deep the tree goes,
+and the positionScale and positionOffset uniforms are set for every patch drawn.
+*/
+
+#ifndef SPHERE_LOD_H
+#define SPHERE_LOD_H
+#include "vertexpack.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+class SphereLod
+{
+public:
+	SphereLod();
+
+	/* allocates the pool and builds the six root patches.
+		patchSize must be at most 128, poolSize at least 6 */
+	void create(float radius, int patchSize, int poolSize);
+
+	/* selects the patches to draw from eye, building the missing ones */
+	void update(const glm::vec3 &eye, const glm::mat4 &viewProjection, float pixelsPerRadian);
+
+	/* binds the buffers of the pool, the vertex array object they are used with must be bound */
+	void bindBuffers();
+
+	/* draws the patches selected by the last update, with the program using scaleUniform and offsetUniform.
+		the buffers must be bound */
+	void draw(GLint positionAttrib, GLint normalAttrib, GLint scaleUniform, GLint offsetUniform) const;
+
+	void destroy();
+
+	/* the largest quads allowed on screen, in pixels */
+	void setMaxError(float pixels) { maxError = pixels; }
+	void setMaxLevel(int level) { maxLevel = level; }
+	void setGenerationBudget(int patches) { generationBudget = patches; }
+
+	/* statistics of the last update */
+	int getPatchCount() const { return int(selected.size()); }
+	int getGeneratedCount() const { return generated; }
+	int getDeepestLevel() const { return deepestLevel; }
+	std::size_t getTriangleCount() const { return selected.size() * std::size_t(indexCount / 3); }
+	int getResidentCount() const { return int(residents.size()); }
+private:
+	struct Node
+	{
+		int face;
+		int level;
+		int x; // of 2^level patches along each edge of the face
+		int y;
+	};
+
+	struct Bounds
+	{
+		glm::vec3 center; // on the sphere, in the middle of the patch
+		float radius;
+		float angle; // from the center of the patch to its farthest corner, seen from the center of the sphere
+	};
+
+	struct Slot
+	{
+		uint64_t key; // of the patch stored, 0 if free
+		PackedVertexFormat format;
+		unsigned int lastUsed;
+	};
+
+	static uint64_t getKey(const Node &node);
+	glm::vec3 getPoint(const Node &node, float s, float t) const;
+	Bounds getBounds(const Node &node) const;
+	bool isVisible(const Bounds &bounds) const;
+	float getScreenError(const Node &node, const Bounds &bounds) const;
+	int findPatch(const Node &node);
+	int buildPatch(const Node &node);
+	void select(const Node &node, const Bounds &bounds);
+
+	float radius;
+	int patchSize;
+	int vertexCount; // per patch, skirts included
+	int indexCount;
+	GLsizeiptr slotBytes;
+	std::vector<Slot> slots;
+	std::unordered_map<uint64_t, int> residents;
+	std::vector<int> selected;
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<unsigned char> packed;
+	GLuint vbo;
+	GLuint ibo;
+
+	float maxError;
+	int maxLevel;
+	int generationBudget;
+
+	// State of the current update
+	glm::vec3 eye;
+	glm::vec4 planes[6];
+	float horizonAngle;
+	float pixelsPerRadian;
+	unsigned int frame;
+	int generated;
+	int deepestLevel;
+};
+
+#endif
@@ -0,0 +1,127 @@
+#include "tangents.h"
+#include "parallel.h"
+using namespace glm;
+
+// Tangents are summed separately for corners with a right handed (side 0) and a left
+// handed (side 1) mapping, the w of a sum counts the corners added to it
+static const int sides = 2;
+
+// Adds the tangents of triangles [first, last) to the sums of their corners, and
+// stores the side of every corner
+static void accumulateTangents(const IndexedVertexArray &iva, std::size_t first, std::size_t last,
+vec4 *sums, unsigned char *cornerSides)
+{
+	for(std::size_t t = first; t < last; ++t)
+	{
+		const GLuint *corners = &iva.indices[3 * t];
+		vec3 deltaPos1 = iva.positions[corners[1]] - iva.positions[corners[0]];
+		vec3 deltaPos2 = iva.positions[corners[2]] - iva.positions[corners[0]];
+		vec2 deltaUv1 = iva.texels[corners[1]] - iva.texels[corners[0]];
+		vec2 deltaUv2 = iva.texels[corners[2]] - iva.texels[corners[0]];
+
+		// Solve for the directions of increasing u and v, skipping triangles without area in uv
+		float det = deltaUv1.x * deltaUv2.y - deltaUv1.y * deltaUv2.x;
+		if(det == 0.0f)
+		{
+			for(int k = 0; k < 3; ++k)
+				cornerSides[3 * t + k] = 0;
+			continue;
+		}
+		float r = 1.0f / det;
+		vec3 tangent = (deltaPos1 * deltaUv2.y - deltaPos2 * deltaUv1.y) * r;
+		vec3 bitangent = (deltaPos2 * deltaUv1.x - deltaPos1 * deltaUv2.x) * r;
+
+		for(int k = 0; k < 3; ++k)
+		{
+			GLuint v = corners[k];
+			int side = dot(cross(iva.normals[v], tangent), bitangent) < 0.0f ? 1 : 0;
+			cornerSides[3 * t + k] = (unsigned char)side;
+			sums[sides * v + side] += vec4(tangent, 1.0f);
+		}
+	}
+}
+
+// Gram-Schmidt of tangent against normal, or any vector orthogonal to normal if tangent is parallel to it
+static vec3 orthonormalize(const vec3 &normal, const vec3 &tangent)
+{
+	vec3 t = tangent - normal * dot(normal, tangent);
+	float l = length(t);
+	if(l > 1e-6f * length(tangent))
+		return t / l;
+
+	vec3 axis = std::abs(normal.x) < 0.9f ? vec3(1.0f, 0.0f, 0.0f) : vec3(0.0f, 1.0f, 0.0f);
+	t = axis - normal * dot(normal, axis);
+	return normalize(t);
+}
+
+void computeTangents(IndexedVertexArray &iva, std::vector<vec4> &tangents)
+{
+	std::size_t vertexCount = iva.positions.size();
+	std::size_t triangleCount = iva.indices.size() / 3;
+	std::vector<vec4> sums(sides * vertexCount, vec4(0.0f));
+	std::vector<unsigned char> cornerSides(3 * triangleCount);
+
+	// One contiguous range per worker, small meshes are not worth splitting
+	const std::size_t minTriangles = 4096;
+	int ranges = int(std::min<std::size_t>(getWorkerCount(), (triangleCount + minTriangles - 1) / minTriangles));
+	auto rangeStart = [&](int r) { return triangleCount * r / ranges; };
+
+	// The first range sums into sums, the others into their own buffers
+	std::vector<std::vector<vec4> > partial(std::max(ranges - 1, 0));
+	parallelFor(ranges, [&](int r)
+	{
+		vec4 *rangeSums = &sums[0];
+		if(r > 0)
+		{
+			partial[r - 1].assign(sides * vertexCount, vec4(0.0f));
+			rangeSums = &partial[r - 1][0];
+		}
+		accumulateTangents(iva, rangeStart(r), rangeStart(r + 1), rangeSums, &cornerSides[0]);
+	});
+
+	if(!partial.empty())
+	{
+		const std::size_t block = 16384;
+		parallelFor(int((sums.size() + block - 1) / block), [&](int b)
+		{
+			std::size_t end = std::min(sums.size(), (b + 1) * block);
+			for(std::size_t i = b * block; i < end; ++i)
+				for(std::size_t p = 0; p < partial.size(); ++p)
+					sums[i] += partial[p][i];
+		});
+	}
+
+	// Split the vertices used from both sides, the copy takes the left handed corners
+	std::vector<GLuint> leftHanded(vertexCount);
+	for(std::size_t v = 0; v < vertexCount; ++v)
+	{
+		leftHanded[v] = GLuint(v);
+		if(sums[sides * v].w > 0.0f && sums[sides * v + 1].w > 0.0f)
+		{
+			leftHanded[v] = GLuint(iva.positions.size());
+			iva.positions.push_back(iva.positions[v]);
+			iva.normals.push_back(iva.normals[v]);
+			iva.texels.push_back(iva.texels[v]);
+		}
+	}
+	for(std::size_t i = 0; i < cornerSides.size(); ++i)
+		if(cornerSides[i] == 1)
+			iva.indices[i] = leftHanded[iva.indices[i]];
+
+	tangents.resize(iva.positions.size());
+	for(std::size_t v = 0; v < vertexCount; ++v)
+	{
+		const vec4 &right = sums[sides * v];
+		const vec4 &left = sums[sides * v + 1];
+		const vec3 &normal = iva.normals[v];
+		if(left.w == 0.0f)
+			tangents[v] = vec4(orthonormalize(normal, vec3(right)), 1.0f);
+		else if(right.w == 0.0f)
+			tangents[v] = vec4(orthonormalize(normal, vec3(left)), -1.0f);
+		else
+		{
+			tangents[v] = vec4(orthonormalize(normal, vec3(right)), 1.0f);
+			tangents[leftHanded[v]] = vec4(orthonormalize(normal, vec3(left)), -1.0f);
+		}
+	}
+}
@@ -0,0 +1,27 @@
+/*
+OpenGL examples - Tangents
+
+Per vertex tangent space for normal mapping indexed triangle meshes.
+	computeTangents(iva, tangents)
+gives every vertex of iva a unit tangent along the direction of increasing u,
+orthogonal to its normal, and the handedness of its texture mapping in w, so the
+bitangent is cross(normal, tangent.xyz) * tangent.w. The tangents of the triangles
+around a vertex are added up before they are orthonormalized, so vertices shared
+between triangles get one smooth basis. Where the triangles around a vertex disagree
+on the handedness, as along the seam of a mirrored texture, the vertex is split in
+two, one for each side. The triangles are split into one range per worker thread
+(see parallel.h), each summing into its own buffer.
+*/
+
+#ifndef TANGENTS_H
+#define TANGENTS_H
+#include "globj.h"
+#include <vector>
+
+/* fills tangents with one tangent per vertex of iva. Vertices whose triangles
+	disagree on the handedness are duplicated, appending to the vertices of iva
+	and remapping its indices. Vertices without a usable tangent get an arbitrary
+	one orthogonal to their normal */
+void computeTangents(IndexedVertexArray &iva, std::vector<glm::vec4> &tangents);
+
+#endif
@@ -0,0 +1,288 @@
+#include "tilecache.h"
+#include "parallel.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// The level 0 tile, as in deepzoom.cpp
+static const double rootLeft = -2.5;
+static const double rootTop = 1.0;
+static const double rootWidth = 3.5;
+static const double rootHeight = 2.0;
+
+// The index of the ancestor levels up, rounding down for the tiles left of or above the root
+static std::int64_t getAncestorIndex(std::int64_t i, int levels)
+{
+	std::int64_t size = std::int64_t(1) << levels;
+	return i >= 0 ? i / size : -((-i + size - 1) / size);
+}
+
+TileKey::TileKey(const DeepView &view, int level, std::int64_t x, std::int64_t y) :
+	level(level), x(x), y(y), maxIteration(getDeepIterationLimit(std::ldexp(1.0, -level))),
+	interiorChecks(view.interiorChecks), subdivide(view.subdivide)
+{
+}
+
+std::size_t TileKeyHash::operator()(const TileKey &key) const
+{
+	std::uint64_t h = std::uint64_t(key.level) * 0x9E3779B97F4A7C15ULL;
+	h ^= std::uint64_t(key.x) + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+	h ^= std::uint64_t(key.y) + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+	h ^= std::uint64_t(key.maxIteration) + (h << 6) + (h >> 2);
+	h ^= (std::uint64_t(key.interiorChecks) << 1 | std::uint64_t(key.subdivide)) + (h << 6) + (h >> 2);
+	return std::size_t(h);
+}
+
+TileCache::TileCache(std::size_t maxBytes, const std::string &spillDirectory) :
+	maxBytes(maxBytes), bytes(0), spillDirectory(spillDirectory), hits(0), misses(0)
+{
+}
+
+TileCache::~TileCache()
+{
+	if(spilled.empty())
+		return;
+	for(auto i = spilled.begin(); i != spilled.end(); ++i)
+		std::remove(getFilename(*i).c_str());
+#ifdef _WIN32
+	_rmdir(spillDirectory.c_str());
+#else
+	rmdir(spillDirectory.c_str());
+#endif
+}
+
+const std::vector<int> *TileCache::find(const TileKey &key)
+{
+	auto found = index.find(key);
+	if(found != index.end())
+	{
+		entries.splice(entries.begin(), entries, found->second);
+		++hits;
+		return &found->second->counts;
+	}
+
+	std::vector<int> counts;
+	if(spilled.count(key) == 0 || !unspill(key, counts))
+	{
+		++misses;
+		return nullptr;
+	}
+	++hits;
+	insert(key, counts);
+	return &entries.front().counts;
+}
+
+void TileCache::insert(const TileKey &key, std::vector<int> &counts)
+{
+	auto found = index.find(key);
+	if(found != index.end())
+	{
+		bytes -= found->second->counts.size() * sizeof(int);
+		entries.erase(found->second);
+	}
+
+	entries.push_front(Entry());
+	entries.front().key = key;
+	entries.front().counts.swap(counts);
+	index[key] = entries.begin();
+	bytes += entries.front().counts.size() * sizeof(int);
+
+	// Never the tile just added, even over the limit
+	while(bytes > maxBytes && entries.size() > 1)
+	{
+		const Entry &last = entries.back();
+		if(!spillDirectory.empty() && spilled.count(last.key) == 0 && spill(last))
+			spilled.insert(last.key);
+		bytes -= last.counts.size() * sizeof(int);
+		index.erase(last.key);
+		entries.pop_back();
+	}
+}
+
+std::string TileCache::getFilename(const TileKey &key) const
+{
+	char name[112];
+	std::snprintf(name, sizeof(name), "/%d_%lld_%lld_%d_%d%d.tile", key.level, (long long)key.x, (long long)key.y,
+		key.maxIteration, int(key.interiorChecks), int(key.subdivide));
+	return spillDirectory + name;
+}
+
+bool TileCache::spill(const Entry &entry)
+{
+#ifdef _WIN32
+	_mkdir(spillDirectory.c_str());
+#else
+	mkdir(spillDirectory.c_str(), 0755);
+#endif
+	std::FILE *file = std::fopen(getFilename(entry.key).c_str(), "wb");
+	if(!file)
+		return false;
+	bool written = std::fwrite(&entry.counts[0], sizeof(int), entry.counts.size(), file) == entry.counts.size();
+	return std::fclose(file) == 0 && written;
+}
+
+bool TileCache::unspill(const TileKey &key, std::vector<int> &counts) const
+{
+	std::FILE *file = std::fopen(getFilename(key).c_str(), "rb");
+	if(!file)
+		return false;
+	counts.resize(std::size_t(tileWidth) * tileHeight);
+	bool read = std::fread(&counts[0], sizeof(int), counts.size(), file) == counts.size();
+	std::fclose(file);
+	return read;
+}
+
+int getTileLevel(double scale, int width)
+{
+	// A little slack, so a scale of exactly a power of two does not round up
+	double level = std::ceil(std::log2(double(width) / (double(tileWidth) * scale)) - 1e-9);
+	return int(std::min(std::max(level, 0.0), double(maxTileLevel)));
+}
+
+// Where the columns or rows of a view fall in the tiles of the level: the tile of each and
+// the pixel within it. The tile positions are measured from the left and top of the root
+static void locatePixels(double start, double step, int count, int pixels,
+std::vector<std::int64_t> &tiles, std::vector<int> &offsets)
+{
+	tiles.resize(count);
+	offsets.resize(count);
+	for(int i = 0; i < count; ++i)
+	{
+		double t = start + (double(i) + 0.5) * step;
+		double tile = std::floor(t);
+		tiles[i] = std::int64_t(tile);
+		offsets[i] = std::min(int((t - tile) * pixels), pixels - 1);
+	}
+}
+
+void getVisibleTiles(const DeepView &view, int width, std::vector<TileKey> &tiles)
+{
+	int level = getTileLevel(view.scale, width);
+	double tw = std::ldexp(rootWidth, -level);
+	double th = std::ldexp(rootHeight, -level);
+
+	// The center of the view and its corners in tiles
+	double cx = (view.x.toDouble() - rootLeft) / tw;
+	double cy = (rootTop - view.y.toDouble()) / th;
+	double hw = 0.5 * rootWidth * view.scale / tw;
+	double hh = 0.5 * rootHeight * view.scale / th;
+	std::int64_t x0 = std::int64_t(std::floor(cx - hw)), x1 = std::int64_t(std::floor(cx + hw));
+	std::int64_t y0 = std::int64_t(std::floor(cy - hh)), y1 = std::int64_t(std::floor(cy + hh));
+
+	tiles.clear();
+	for(std::int64_t y = y0; y <= y1; ++y)
+		for(std::int64_t x = x0; x <= x1; ++x)
+			tiles.push_back(TileKey(view, level, x, y));
+
+	auto distance = [&](const TileKey &key)
+	{
+		double dx = double(key.x - x0) + 0.5 - (cx - double(x0));
+		double dy = double(key.y - y0) + 0.5 - (cy - double(y0));
+		return dx * dx + dy * dy;
+	};
+	std::stable_sort(tiles.begin(), tiles.end(), [&](const TileKey &a, const TileKey &b)
+	{
+		return distance(a) < distance(b);
+	});
+}
+
+void computeTile(const TileKey &key, std::vector<int> &counts)
+{
+	// The centers are exact in doubles down to maxTileLevel, so the tiles meet without gaps
+	DeepView view;
+	view.scale = std::ldexp(1.0, -key.level);
+	view.maxIteration = key.maxIteration;
+	view.interiorChecks = key.interiorChecks;
+	view.subdivide = key.subdivide;
+	view.x = BigFixed(rootLeft + (double(key.x) + 0.5) * rootWidth * view.scale, view.getPrecision());
+	view.y = BigFixed(rootTop - (double(key.y) + 0.5) * rootHeight * view.scale, view.getPrecision());
+
+	std::vector<double> orbit;
+	computeReferenceOrbit(view, orbit);
+	counts.resize(std::size_t(tileWidth) * tileHeight);
+	getDeepKernel(view, orbit, tileWidth, tileHeight)(0, 0, tileWidth, tileHeight, &counts[0], tileWidth);
+}
+
+bool requestTiles(TileCache &cache, const std::vector<TileKey> &tiles, double seconds)
+{
+	std::vector<TileKey> missing;
+	for(std::size_t i = 0; i < tiles.size(); ++i)
+		if(!cache.find(tiles[i]))
+			missing.push_back(tiles[i]);
+	if(missing.empty())
+		return false;
+
+	// One tile per worker at a time, then check the clock
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<std::vector<int> > results;
+	for(std::size_t next = 0; next < missing.size();)
+	{
+		int count = int(std::min(std::size_t(getWorkerCount()), missing.size() - next));
+		results.resize(count);
+		parallelFor(count, [&](int i)
+		{
+			computeTile(missing[next + i], results[i]);
+		});
+		for(int i = 0; i < count; ++i)
+			cache.insert(missing[next + i], results[i]);
+		next += count;
+
+		if(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= seconds)
+			break;
+	}
+	return true;
+}
+
+bool drawTiles(TileCache &cache, const DeepView &view, int width, int height, int *counts)
+{
+	int level = getTileLevel(view.scale, width);
+	double tw = std::ldexp(rootWidth, -level);
+	double th = std::ldexp(rootHeight, -level);
+
+	std::vector<std::int64_t> tileX, tileY;
+	std::vector<int> pixelX, pixelY;
+	double left = (view.x.toDouble() - rootLeft - 0.5 * rootWidth * view.scale) / tw;
+	double top = (rootTop - view.y.toDouble() - 0.5 * rootHeight * view.scale) / th;
+	locatePixels(left, rootWidth * view.scale / tw / width, width, tileWidth, tileX, pixelX);
+	locatePixels(top, rootHeight * view.scale / th / height, height, tileHeight, tileY, pixelY);
+
+	// The columns and rows of a tile are runs, since they only grow
+	bool complete = true;
+	for(int y0 = 0, y1 = 0; y0 < height; y0 = y1)
+	{
+		while(y1 < height && tileY[y1] == tileY[y0])
+			++y1;
+		for(int x0 = 0, x1 = 0; x0 < width; x0 = x1)
+		{
+			while(x1 < width && tileX[x1] == tileX[x0])
+				++x1;
+
+			const std::vector<int> *tile = nullptr;
+			int up = 0;
+			for(; up <= level && !tile; ++up)
+				tile = cache.find(TileKey(view, level - up, getAncestorIndex(tileX[x0], up), getAncestorIndex(tileY[y0], up)));
+			--up;
+			complete = complete && tile && up == 0;
+
+			// Within an ancestor up levels above, the tile is one of 2^up x 2^up
+			std::int64_t size = std::int64_t(1) << up;
+			std::int64_t offsetX = (tileX[x0] - getAncestorIndex(tileX[x0], up) * size) * tileWidth;
+			std::int64_t offsetY = (tileY[y0] - getAncestorIndex(tileY[y0], up) * size) * tileHeight;
+			for(int y = y0; y < y1; ++y)
+			{
+				int *row = counts + std::size_t(y) * width;
+				int ty = int((offsetY + pixelY[y]) >> up);
+				for(int x = x0; x < x1; ++x)
+					row[x] = tile ? (*tile)[std::size_t(ty) * tileWidth + int((offsetX + pixelX[x]) >> up)] : 0;
+			}
+		}
+	}
+	return complete;
+}
@@ -0,0 +1,132 @@
+/*
+OpenGL examples - Tile cache
+
+The plane of the Mandelbrot set cut into a quadtree of tiles, so that a view that comes
+back to a region finds its pixels already computed. The tile at level 0 is the rectangle
+of data/fractal.fs at zoom 0, 3.5 x 2 around (-0.75, 0), and every level halves the
+tiles of the one above:
+	tile (level, x, y) covers [-2.5 + 3.5 x / 2^level, -2.5 + 3.5 (x + 1) / 2^level) wide
+	and [1 - 2 (y + 1) / 2^level, 1 - 2 y / 2^level) high, rows from the top
+with tileWidth x tileHeight pixels, the aspect of the 640 x 480 window. The indices are
+not limited to the root, so views can leave it.
+
+A view (see deepzoom.h) is drawn from the level whose pixels are at least as small as
+the screen's:
+	getVisibleTiles(view, width, tiles);
+	requestTiles(cache, tiles, 0.02);
+	drawTiles(cache, view, width, height, counts);
+requestTiles computes the missing tiles nearest the center first for a given time, and
+drawTiles stands in for the missing ones with their nearest cached ancestor, scaled up.
+
+The cache keeps the most recently used tiles up to a number of bytes. Given a directory,
+the tiles it pushes out are written there and read back when they are needed again, so
+only the memory is bounded. The files only last as long as the cache. Tiles are computed
+by perturbation around their center (see deepzoom.h), in doubles, which places them
+exactly down to maxTileLevel, with the early exits of the view that asks for them. A key
+holds those too, so turning them off never shows tiles computed with them.
+*/
+
+#ifndef TILE_CACHE_H
+#define TILE_CACHE_H
+#include "deepzoom.h"
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+static const int tileWidth = 128;
+static const int tileHeight = 96;
+static const int maxTileLevel = 36;
+
+struct TileKey
+{
+	TileKey() : level(0), x(0), y(0), maxIteration(0), interiorChecks(true), subdivide(true) { }
+
+	/* the tile of a view with the early exits of the view */
+	TileKey(const DeepView &view, int level, std::int64_t x, std::int64_t y);
+
+	bool operator==(const TileKey &key) const
+	{
+		return level == key.level && x == key.x && y == key.y && maxIteration == key.maxIteration &&
+			interiorChecks == key.interiorChecks && subdivide == key.subdivide;
+	}
+
+	int level;
+	std::int64_t x;
+	std::int64_t y;
+	int maxIteration; // getDeepIterationLimit of the level, so zooming within it keeps the tiles
+	bool interiorChecks; // as in DeepView, tiles computed with and without them are kept apart
+	bool subdivide;
+};
+
+struct TileKeyHash
+{
+	std::size_t operator()(const TileKey &key) const;
+};
+
+class TileCache
+{
+public:
+	/* keeps up to maxBytes of tiles in memory.
+		with a spill directory, tiles pushed out of memory are kept there */
+	explicit TileCache(std::size_t maxBytes = 64 << 20, const std::string &spillDirectory = "");
+
+	/* deletes the tiles it spilled, and the directory once it is empty */
+	~TileCache();
+
+	/* the counts of the tile, tileWidth x tileHeight row by row, and marks it as recently used.
+		return nullptr if the tile was not computed yet */
+	const std::vector<int> *find(const TileKey &key);
+
+	/* adds the tile, taking the counts, and pushes out the least recently used ones over the limit */
+	void insert(const TileKey &key, std::vector<int> &counts);
+
+	std::size_t getTileCount() const { return entries.size(); }
+	std::size_t getSpilledCount() const { return spilled.size(); }
+	std::uint64_t getHits() const { return hits; }
+	std::uint64_t getMisses() const { return misses; }
+
+private:
+	TileCache(const TileCache &);
+	TileCache &operator=(const TileCache &);
+
+	struct Entry
+	{
+		TileKey key;
+		std::vector<int> counts;
+	};
+
+	std::string getFilename(const TileKey &key) const;
+	bool spill(const Entry &entry);
+	bool unspill(const TileKey &key, std::vector<int> &counts) const;
+
+	std::size_t maxBytes;
+	std::size_t bytes;
+	std::string spillDirectory;
+	std::list<Entry> entries; // the most recently used first
+	std::unordered_map<TileKey, std::list<Entry>::iterator, TileKeyHash> index;
+	std::unordered_set<TileKey, TileKeyHash> spilled;
+	std::uint64_t hits;
+	std::uint64_t misses;
+};
+
+/* the level whose pixels are no larger than those of a width pixels wide view at scale */
+int getTileLevel(double scale, int width);
+
+/* the tiles a view width pixels wide covers, at getTileLevel, the ones nearest its center first */
+void getVisibleTiles(const DeepView &view, int width, std::vector<TileKey> &tiles);
+
+/* the counts of the tile, tileWidth x tileHeight row by row */
+void computeTile(const TileKey &key, std::vector<int> &counts);
+
+/* computes the tiles missing from the cache, in order, on all the workers until seconds have passed.
+	return true if any tile was added */
+bool requestTiles(TileCache &cache, const std::vector<TileKey> &tiles, double seconds);
+
+/* writes the view to counts, width x height row by row, from the visible tiles in the cache.
+	return true if every tile was found at its level */
+bool drawTiles(TileCache &cache, const DeepView &view, int width, int height, int *counts);
+
+#endif
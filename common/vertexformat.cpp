@@ -0,0 +1,160 @@
+#include "vertexformat.h"
+#include "vertexpack.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+GLsizei getTypeSize(GLenum type)
+{
+	switch(type)
+	{
+	case GL_BYTE:
+	case GL_UNSIGNED_BYTE:
+		return 1;
+	case GL_SHORT:
+	case GL_UNSIGNED_SHORT:
+	case GL_HALF_FLOAT:
+		return 2;
+	default:
+		return 4;
+	}
+}
+
+VertexFormat::VertexFormat() : stride(0)
+{
+
+}
+
+VertexFormat &VertexFormat::add(const std::string &name, GLint size, GLenum type, GLboolean normalized)
+{
+	VertexAttribute a;
+	a.name = name;
+	a.size = size;
+	a.type = type;
+	a.normalized = normalized;
+	a.offset = (stride + 3) & ~3;
+	attributes.push_back(a);
+	stride = (a.offset + size * getTypeSize(type) + 3) & ~3;
+	return *this;
+}
+
+VertexFormat &VertexFormat::add(const VertexAttribute &attribute)
+{
+	attributes.push_back(attribute);
+	stride = std::max(stride, (attribute.offset + attribute.size * getTypeSize(attribute.type) + 3) & ~3);
+	return *this;
+}
+
+int VertexFormat::find(const std::string &name) const
+{
+	for(std::size_t i = 0; i < attributes.size(); ++i)
+		if(attributes[i].name == name)
+			return int(i);
+	return -1;
+}
+
+void VertexFormat::apply(const std::unordered_map<std::string, GLint> &locations, GLsizeiptr baseOffset) const
+{
+	for(std::size_t i = 0; i < attributes.size(); ++i)
+	{
+		std::unordered_map<std::string, GLint>::const_iterator location = locations.find(attributes[i].name);
+		if(location != locations.end())
+			applyVertexAttribute(attributes[i], location->second, stride, baseOffset);
+	}
+}
+
+void applyVertexAttribute(const VertexAttribute &attribute, GLint location, GLsizei stride, GLsizeiptr baseOffset)
+{
+	if(location < 0)
+		return;
+	glEnableVertexAttribArray(location);
+	glVertexAttribPointer(location, attribute.size, attribute.type, attribute.normalized, stride,
+		(void*)(baseOffset + attribute.offset));
+}
+
+VertexBuilder::VertexBuilder(const VertexFormat &format) : format(format)
+{
+	Source none = { NULL, 0 };
+	sources.assign(format.getAttributeCount(), none);
+}
+
+VertexBuilder &VertexBuilder::source(const std::string &name, const float *data, std::size_t stride)
+{
+	int i = format.find(name);
+	if(i < 0)
+	{
+		std::cerr<<"Vertex format has no attribute "<<name<<std::endl;
+		return *this;
+	}
+	sources[i].data = data;
+	sources[i].stride = stride == 0 ? std::size_t(format.getAttribute(i).size) : stride;
+	return *this;
+}
+
+// Converts a component to an integer type, scaling it to the range of the type if normalized
+template <typename T>
+static void storeInteger(float f, bool normalized, float maxValue, float minValue, unsigned char *out)
+{
+	if(normalized)
+		f *= maxValue;
+	T value = T(std::max(minValue, std::min(maxValue, std::floor(f + 0.5f))));
+	std::memcpy(out, &value, sizeof(value));
+}
+
+static void storeComponent(float f, const VertexAttribute &a, unsigned char *out)
+{
+	bool n = a.normalized == GL_TRUE;
+	switch(a.type)
+	{
+	case GL_HALF_FLOAT:
+		{
+			GLushort h = packHalf(f);
+			std::memcpy(out, &h, sizeof(h));
+		}
+		break;
+	case GL_BYTE: storeInteger<GLbyte>(f, n, 127.0f, -127.0f, out); break;
+	case GL_UNSIGNED_BYTE: storeInteger<GLubyte>(f, n, 255.0f, 0.0f, out); break;
+	case GL_SHORT: storeInteger<GLshort>(f, n, 32767.0f, -32767.0f, out); break;
+	case GL_UNSIGNED_SHORT: storeInteger<GLushort>(f, n, 65535.0f, 0.0f, out); break;
+	case GL_INT:
+		{
+			GLint i = GLint(std::floor((n ? f * 2147483647.0 : double(f)) + 0.5));
+			std::memcpy(out, &i, sizeof(i));
+		}
+		break;
+	case GL_UNSIGNED_INT:
+		{
+			GLuint u = GLuint(std::max(0.0, std::floor((n ? f * 4294967295.0 : double(f)) + 0.5)));
+			std::memcpy(out, &u, sizeof(u));
+		}
+		break;
+	default:
+		std::memcpy(out, &f, sizeof(f));
+		break;
+	}
+}
+
+void VertexBuilder::build(std::size_t vertexCount, std::vector<unsigned char> &vertices) const
+{
+	GLsizei stride = format.getStride();
+	vertices.assign(vertexCount * stride, 0);
+	for(std::size_t v = 0; v < vertexCount; ++v)
+	{
+		unsigned char *vertex = &vertices[v * stride];
+		for(int i = 0; i < format.getAttributeCount(); ++i)
+		{
+			const Source &s = sources[i];
+			if(!s.data)
+				continue;
+			const VertexAttribute &a = format.getAttribute(i);
+			const float *in = s.data + v * s.stride;
+			unsigned char *out = vertex + a.offset;
+			if(a.type == GL_FLOAT)
+				std::memcpy(out, in, a.size * sizeof(float));
+			else
+				for(int c = 0; c < a.size; ++c)
+					storeComponent(in[c], a, out + c * getTypeSize(a.type));
+		}
+	}
+}
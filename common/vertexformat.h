@@ -0,0 +1,101 @@
+/*
+OpenGL examples - Vertex format
+
+Declares the attributes of interleaved vertices once, instead of computing strides
+and offsets by hand for every glVertexAttribPointer:
+	VertexFormat format;
+	format.add("position", 3).add("normal", 3).add("texel", 2, GL_HALF_FLOAT);
+	format.apply(program.attribs);
+Each attribute starts at a multiple of 4 bytes, and the stride is rounded up to one.
+Layouts computed elsewhere, such as the packed ones of vertexpack.h, are described by
+adding attributes at their own offsets.
+
+VertexBuilder fills a buffer of such vertices from one float array per attribute,
+converting the components to the type of their attribute, in a single pass over the
+vertices. One interleaved buffer keeps all the attributes of a vertex in the same
+cache lines, where separate blocks per attribute make every vertex fetch touch as
+many distant lines as there are attributes.
+*/
+
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+#include "glutils.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct VertexAttribute
+{
+	std::string name;
+	GLint size;
+	GLenum type; // GL_FLOAT, GL_HALF_FLOAT, or an 8, 16 or 32 bit integer type
+	GLboolean normalized;
+	GLsizei offset;
+};
+
+class VertexFormat
+{
+public:
+	VertexFormat();
+
+	/* appends an attribute of size components after the previous ones */
+	VertexFormat &add(const std::string &name, GLint size, GLenum type = GL_FLOAT, GLboolean normalized = GL_FALSE);
+
+	/* adds an attribute at its own offset, the stride grows to cover it */
+	VertexFormat &add(const VertexAttribute &attribute);
+
+	GLsizei getStride() const { return stride; }
+	int getAttributeCount() const { return int(attributes.size()); }
+	const VertexAttribute &getAttribute(int i) const { return attributes[i]; }
+
+	/* returns the index of the attribute called name, or -1 */
+	int find(const std::string &name) const;
+
+	/* enables the attributes of the bound vertex array object and points them at the bound
+		array buffer, starting baseOffset bytes in. Attributes without a location of at least 0
+		in locations, such as ones the shader does not use, are skipped */
+	void apply(const std::unordered_map<std::string, GLint> &locations, GLsizeiptr baseOffset = 0) const;
+
+private:
+	std::vector<VertexAttribute> attributes;
+	GLsizei stride;
+};
+
+/* returns the size in bytes of one component of the given type */
+GLsizei getTypeSize(GLenum type);
+
+/* enables the attribute at location and points it at the bound array buffer, vertices stride
+	bytes apart from baseOffset bytes in. Skipped if location is less than 0 */
+void applyVertexAttribute(const VertexAttribute &attribute, GLint location, GLsizei stride, GLsizeiptr baseOffset = 0);
+
+class VertexBuilder
+{
+public:
+	VertexBuilder(const VertexFormat &format);
+
+	/* reads attribute name from data, size floats per vertex with stride floats from
+		one vertex to the next (0 for size). Attributes without a source are zeroed */
+	VertexBuilder &source(const std::string &name, const float *data, std::size_t stride = 0);
+
+	/* the same for an array of vectors, such as std::vector<glm::vec3> */
+	template <typename T>
+	VertexBuilder &source(const std::string &name, const std::vector<T> &data)
+	{
+		return source(name, data.empty() ? NULL : (const float*)&data[0], sizeof(T) / sizeof(float));
+	}
+
+	/* writes vertexCount interleaved vertices to vertices */
+	void build(std::size_t vertexCount, std::vector<unsigned char> &vertices) const;
+
+private:
+	struct Source
+	{
+		const float *data;
+		std::size_t stride;
+	};
+
+	VertexFormat format;
+	std::vector<Source> sources;
+};
+
+#endif
@@ -0,0 +1,253 @@
+#include "vertexpack.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+using namespace glm;
+
+static const PackedVertexFormat::Attribute noAttribute = { "", 0, GL_FLOAT, GL_FALSE, 0 };
+
+VertexFormat PackedVertexFormat::getVertexFormat() const
+{
+	const Attribute *attributes[4] = { &position, &normal, &tangent, &texel };
+	VertexFormat format;
+	for(int i = 0; i < 4; ++i)
+		if(attributes[i]->size > 0)
+			format.add(*attributes[i]);
+	return format;
+}
+
+void PackedVertexFormat::apply(GLint positionAttrib, GLint normalAttrib, GLint tangentAttrib, GLint texelAttrib,
+GLsizeiptr baseOffset) const
+{
+	const Attribute *attributes[4] = { &position, &normal, &tangent, &texel };
+	GLint locations[4] = { positionAttrib, normalAttrib, tangentAttrib, texelAttrib };
+	for(int i = 0; i < 4; ++i)
+		if(attributes[i]->size > 0)
+			applyVertexAttribute(*attributes[i], locations[i], stride, baseOffset);
+}
+
+void PackedVertexFormat::setPositionUniforms(GLint scaleUniform, GLint offsetUniform) const
+{
+	glUniform(scaleUniform, positionScale);
+	glUniform(offsetUniform, positionOffset);
+}
+
+PackedVertexFormat getPackedVertexFormat(const vec3 &boxMin, const vec3 &boxMax,
+bool normals, bool tangents, bool texels, DirectionPrecision precision)
+{
+	PackedVertexFormat format;
+	vec3 halfSize = 0.5f * (boxMax - boxMin);
+	for(int i = 0; i < 3; ++i)
+		if(!(halfSize[i] > 0.0f))
+			halfSize[i] = 1.0f;
+	format.positionScale = halfSize / 32767.0f;
+	format.positionOffset = 0.5f * (boxMin + boxMax);
+
+	// w is only needed for the handedness of the tangent space
+	PackedVertexFormat::Attribute position = { "position", tangents ? 4 : 3, GL_SHORT, GL_FALSE, 0 };
+	format.position = position;
+	GLsizei offset = position.size * sizeof(GLshort);
+
+	// With 8 bits the normal and tangent share one 4 byte word
+	GLenum directionType = precision == Directions16 ? GL_SHORT : GL_BYTE;
+	GLsizei directionSize = precision == Directions16 ? 2 * sizeof(GLshort) : 2 * sizeof(GLbyte);
+	format.normal = format.tangent = noAttribute;
+	if(normals)
+	{
+		PackedVertexFormat::Attribute normal = { "normal", 2, directionType, GL_TRUE, offset };
+		format.normal = normal;
+		offset += directionSize;
+	}
+	if(tangents)
+	{
+		PackedVertexFormat::Attribute tangent = { "tangent", 2, directionType, GL_TRUE, offset };
+		format.tangent = tangent;
+		offset += directionSize;
+	}
+	offset = (offset + 3) & ~3;
+
+	format.texel = noAttribute;
+	if(texels)
+	{
+		PackedVertexFormat::Attribute texel = { "texel", 2, GL_HALF_FLOAT, GL_FALSE, offset };
+		format.texel = texel;
+		offset += 2 * sizeof(GLushort);
+	}
+	format.stride = offset;
+	return format;
+}
+
+void computeBounds(const std::vector<vec3> &positions, vec3 &boxMin, vec3 &boxMax)
+{
+	boxMin = boxMax = positions.empty() ? vec3(0.0f) : positions[0];
+	for(std::size_t i = 1; i < positions.size(); ++i)
+	{
+		boxMin = min(boxMin, positions[i]);
+		boxMax = max(boxMax, positions[i]);
+	}
+}
+
+GLushort packHalf(float f)
+{
+	uint32_t x;
+	std::memcpy(&x, &f, sizeof(x));
+	uint32_t sign = (x >> 16) & 0x8000;
+	int exponent = int((x >> 23) & 0xff) - 127 + 15;
+	uint32_t mantissa = x & 0x7fffff;
+
+	if(((x >> 23) & 0xff) == 0xff)
+		return GLushort(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+	if(exponent >= 31)
+		return GLushort(sign | 0x7c00);
+
+	// Round the dropped bits to nearest, ties to even. A carry into the exponent is still correct
+	uint32_t h, rest, halfway;
+	if(exponent <= 0)
+	{
+		if(exponent < -10)
+			return GLushort(sign);
+		mantissa |= 0x800000;
+		int shift = 14 - exponent;
+		h = mantissa >> shift;
+		rest = mantissa & ((1u << shift) - 1);
+		halfway = 1u << (shift - 1);
+	}
+	else
+	{
+		h = (uint32_t(exponent) << 10) | (mantissa >> 13);
+		rest = mantissa & 0x1fff;
+		halfway = 0x1000;
+	}
+	if(rest > halfway || (rest == halfway && (h & 1)))
+		++h;
+	return GLushort(sign | h);
+}
+
+float unpackHalf(GLushort h)
+{
+	uint32_t sign = uint32_t(h & 0x8000) << 16;
+	uint32_t exponent = (h >> 10) & 0x1f;
+	uint32_t mantissa = h & 0x3ff;
+	uint32_t x;
+	if(exponent == 0x1f)
+		x = sign | 0x7f800000 | (mantissa << 13);
+	else if(exponent != 0)
+		x = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+	else if(mantissa == 0)
+		x = sign;
+	else
+	{
+		float f = std::ldexp(float(mantissa), -24);
+		return sign ? -f : f;
+	}
+	float f;
+	std::memcpy(&f, &x, sizeof(f));
+	return f;
+}
+
+static float signNotZero(float f)
+{
+	return f >= 0.0f ? 1.0f : -1.0f;
+}
+
+vec2 octEncode(const vec3 &n)
+{
+	float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+	if(l1 == 0.0f)
+		return vec2(0.0f);
+	vec2 e(n.x / l1, n.y / l1);
+	if(n.z < 0.0f)
+		e = vec2((1.0f - std::abs(e.y)) * signNotZero(e.x), (1.0f - std::abs(e.x)) * signNotZero(e.y));
+	return e;
+}
+
+vec3 octDecode(const vec2 &e)
+{
+	vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+	if(n.z < 0.0f)
+	{
+		float x = n.x;
+		n.x = (1.0f - std::abs(n.y)) * signNotZero(x);
+		n.y = (1.0f - std::abs(x)) * signNotZero(n.y);
+	}
+	float l = length(n);
+	return l > 0.0f ? n / l : n;
+}
+
+// Quantizes the octahedral encoding of n to integers in [-maxValue, maxValue], trying
+// both neighbors on each axis since rounding each one separately is not always closest
+static void quantizeDirection(const vec3 &n, int maxValue, int &qx, int &qy)
+{
+	vec2 e = octEncode(n) * float(maxValue);
+	float bestDot = -2.0f;
+	for(int i = 0; i < 4; ++i)
+	{
+		int x = int(i & 1 ? std::ceil(e.x) : std::floor(e.x));
+		int y = int(i & 2 ? std::ceil(e.y) : std::floor(e.y));
+		x = std::max(-maxValue, std::min(maxValue, x));
+		y = std::max(-maxValue, std::min(maxValue, y));
+		float d = dot(n, octDecode(vec2(float(x), float(y)) / float(maxValue)));
+		if(d > bestDot)
+		{
+			bestDot = d;
+			qx = x;
+			qy = y;
+		}
+	}
+}
+
+static void packDirection(const PackedVertexFormat::Attribute &a, const vec3 &n, unsigned char *out)
+{
+	int x, y;
+	if(a.type == GL_SHORT)
+	{
+		quantizeDirection(n, 32767, x, y);
+		GLshort packed[2] = { GLshort(x), GLshort(y) };
+		std::memcpy(out + a.offset, packed, sizeof(packed));
+	}
+	else
+	{
+		quantizeDirection(n, 127, x, y);
+		GLbyte packed[2] = { GLbyte(x), GLbyte(y) };
+		std::memcpy(out + a.offset, packed, sizeof(packed));
+	}
+}
+
+void packVertex(const PackedVertexFormat &format, const vec3 &position, const vec3 &normal,
+const vec4 &tangent, const vec2 &texel, unsigned char *out)
+{
+	vec3 q = (position - format.positionOffset) / format.positionScale;
+	GLshort packedPosition[4];
+	for(int i = 0; i < 3; ++i)
+		packedPosition[i] = GLshort(std::max(-32767.0f, std::min(32767.0f, std::floor(q[i] + 0.5f))));
+	packedPosition[3] = tangent.w < 0.0f ? -1 : 1;
+	std::memcpy(out + format.position.offset, packedPosition, format.position.size * sizeof(GLshort));
+
+	if(format.normal.size > 0)
+		packDirection(format.normal, normal, out);
+	if(format.tangent.size > 0)
+		packDirection(format.tangent, vec3(tangent.x, tangent.y, tangent.z), out);
+	if(format.texel.size > 0)
+	{
+		GLushort packedTexel[2] = { packHalf(texel.x), packHalf(texel.y) };
+		std::memcpy(out + format.texel.offset, packedTexel, sizeof(packedTexel));
+	}
+}
+
+void packVertices(const PackedVertexFormat &format, const std::vector<vec3> &positions,
+const std::vector<vec3> *normals, const std::vector<vec4> *tangents,
+const std::vector<vec2> *texels, std::vector<unsigned char> &vertices)
+{
+	vertices.assign(positions.size() * format.stride, 0);
+	vec3 noNormal(0.0f);
+	vec4 noTangent(0.0f);
+	vec2 noTexel(0.0f);
+	for(std::size_t i = 0; i < positions.size(); ++i)
+	{
+		packVertex(format, positions[i],
+			format.normal.size > 0 ? (*normals)[i] : noNormal,
+			format.tangent.size > 0 ? (*tangents)[i] : noTangent,
+			format.texel.size > 0 ? (*texels)[i] : noTexel,
+			&vertices[i * format.stride]);
+	}
+}
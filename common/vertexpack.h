@@ -0,0 +1,86 @@
+/*
+OpenGL examples - Vertex packing
+
+Compact vertex formats, so meshes take a third to a half of the memory and bandwidth
+of float vertices. A position and an 8 bit normal take 8 bytes instead of 24:
+	position	3 x 16 bit integers, quantized to the bounding box of the mesh. The vertex
+				shader decodes them as position.xyz * positionScale + positionOffset, with
+				the uniforms set by setPositionUniforms. With tangents a fourth, w, holds
+				the handedness of the tangent space, 1 or -1
+	normal		the octahedral encoding of the unit vector, 2 x 16 or 2 x 8 bit normalized
+	tangent		the same, the bitangent is cross(normal, tangent) * position.w
+	texel		2 x 16 bit half floats
+The octahedral encoding projects the unit sphere onto an octahedron and unfolds it
+into the square [-1, 1]^2, so every direction gets about the same precision. Decode it
+with
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if(n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	n = normalize(n);
+Positions are not normalized, since how OpenGL maps normalized integers to [-1, 1]
+differs between versions. The scale includes the 1 / 32767.
+*/
+
+#ifndef VERTEX_PACK_H
+#define VERTEX_PACK_H
+#include "glutils.h"
+#include "vertexformat.h"
+#include <vector>
+
+enum DirectionPrecision
+{
+	Directions16,
+	Directions8
+};
+
+struct PackedVertexFormat
+{
+	// The size is 0 if the vertices do not have the attribute
+	typedef VertexAttribute Attribute;
+
+	Attribute position;
+	Attribute normal;
+	Attribute tangent;
+	Attribute texel;
+	GLsizei stride;
+	glm::vec3 positionScale;
+	glm::vec3 positionOffset;
+
+	/* the layout as a VertexFormat, of the attributes the vertices have, named position,
+		normal, tangent and texel, for VertexFormat::apply with the locations of a program */
+	VertexFormat getVertexFormat() const;
+
+	/* points the attributes of the bound vertex array object at the bound array buffer,
+		starting baseOffset bytes in, as VertexFormat::apply. Attributes with a location of -1
+		are skipped */
+	void apply(GLint positionAttrib, GLint normalAttrib, GLint tangentAttrib = -1, GLint texelAttrib = -1,
+		GLsizeiptr baseOffset = 0) const;
+
+	/* sets the uniforms positions are decoded with, for the program in use */
+	void setPositionUniforms(GLint scaleUniform, GLint offsetUniform) const;
+};
+
+/* lays out vertices with the given attributes, whose positions lie in the box [boxMin, boxMax] */
+PackedVertexFormat getPackedVertexFormat(const glm::vec3 &boxMin, const glm::vec3 &boxMax,
+	bool normals, bool tangents, bool texels, DirectionPrecision precision = Directions16);
+
+/* the bounding box of the positions, an empty box at the origin if there are none */
+void computeBounds(const std::vector<glm::vec3> &positions, glm::vec3 &boxMin, glm::vec3 &boxMax);
+
+/* writes one vertex of format.stride bytes to out. The attributes the format lacks are ignored */
+void packVertex(const PackedVertexFormat &format, const glm::vec3 &position, const glm::vec3 &normal,
+	const glm::vec4 &tangent, const glm::vec2 &texel, unsigned char *out);
+
+/* packs every vertex into vertices. normals, tangents and texels must be given if the format has them */
+void packVertices(const PackedVertexFormat &format, const std::vector<glm::vec3> &positions,
+	const std::vector<glm::vec3> *normals, const std::vector<glm::vec4> *tangents,
+	const std::vector<glm::vec2> *texels, std::vector<unsigned char> &vertices);
+
+/* IEEE 754 half floats, rounded to nearest */
+GLushort packHalf(float f);
+float unpackHalf(GLushort h);
+
+/* the octahedral encoding of a unit vector, and its inverse */
+glm::vec2 octEncode(const glm::vec3 &n);
+glm::vec3 octDecode(const glm::vec2 &e);
+
+#endif
@@ -0,0 +1,110 @@
+#version 140
+
+// The fractals of common/fractal.h, one variant per set of definitions, which
+// getFractalDefines puts after the version line:
+//	FORMULA_MANDELBROT, FORMULA_MULTIBROT, FORMULA_JULIA or FORMULA_BURNING_SHIP
+//	POWER			the power of z
+//	MAX_ITERATION
+//	JULIA_C			k of the Julia set, a vec2
+//	SMOOTH_COLORING	the count with a fraction
+// Without any it is the Mandelbrot set to 128 iterations.
+
+#if !defined(FORMULA_MULTIBROT) && !defined(FORMULA_JULIA) && !defined(FORMULA_BURNING_SHIP)
+#define FORMULA_MANDELBROT
+#endif
+#ifndef POWER
+#define POWER 2
+#endif
+#ifndef MAX_ITERATION
+#define MAX_ITERATION 128
+#endif
+#ifndef JULIA_C
+#define JULIA_C vec2(-0.8, 0.156)
+#endif
+#ifdef SMOOTH_COLORING
+#define BAILOUT 65536.0
+#else
+#define BAILOUT 4.0
+#endif
+
+in vec2 uv;
+
+uniform float zoom;
+uniform vec2 offset;
+uniform bool interiorChecks;
+
+out vec4 outColor;
+
+// z^POWER, the loop has a constant count for the compiler to unroll
+vec2 power(vec2 z)
+{
+	vec2 w = vec2(z.x * z.x - z.y * z.y, 2.0 * z.x * z.y);
+	for(int k = 2; k < POWER; ++k)
+		w = vec2(w.x * z.x - w.y * z.y, w.x * z.y + w.y * z.x);
+	return w;
+}
+
+void main()
+{
+	float left = -2.5;
+	float right = 1.0;
+	float bottom = -1.0;
+	float top = 1.0;
+
+	vec2 c = vec2(left + (right - left) * uv.x, bottom + (top - bottom) * uv.y) * (1.0f - zoom);
+	c += offset;
+
+#ifdef FORMULA_JULIA
+	vec2 z = c;
+	c = JULIA_C;
+#else
+	vec2 z = vec2(0.0, 0.0);
+#endif
+	int i = 0;
+	int maxIteration = MAX_ITERATION;
+
+#ifdef FORMULA_MANDELBROT
+	// The main cardioid and the period 2 bulb never escape
+	if(interiorChecks)
+	{
+		float q = (c.x - 0.25) * (c.x - 0.25) + c.y * c.y;
+		if(q * (q + c.x - 0.25) <= 0.25 * c.y * c.y || (c.x + 1.0) * (c.x + 1.0) + c.y * c.y <= 0.0625)
+			i = maxIteration;
+	}
+
+	// An orbit back where it was at the last power of two iteration is periodic
+	vec2 saved = z;
+	int checkpoint = 1;
+#endif
+	while(dot(z, z) < BAILOUT && i < maxIteration)
+	{
+#ifdef FORMULA_BURNING_SHIP
+		z = abs(z);
+#endif
+		z = power(z) + c;
+		++i;
+
+#ifdef FORMULA_MANDELBROT
+		if(interiorChecks)
+		{
+			vec2 d = z - saved;
+			if(dot(d, d) < 1e-12)
+				i = maxIteration;
+			if(i == checkpoint)
+			{
+				saved = z;
+				checkpoint *= 2;
+			}
+		}
+#endif
+	}
+
+	float alpha = i / float(maxIteration);
+#ifdef SMOOTH_COLORING
+	// From i + 1 at the bailout radius down to i at its power, as SmoothCount
+	if(i < maxIteration)
+		alpha = clamp(float(i) + 1.0 - log(log(dot(z, z)) / log(BAILOUT)) / log(float(POWER)), 0.0, float(maxIteration)) / float(maxIteration);
+#endif
+	// float alpha = sqrt(i / float(maxIteration));
+	outColor = vec4(alpha * 20.0 / 255.0, alpha * 190.0 / 255.0, alpha * 255.0 / 255.0, 1.0);
+}
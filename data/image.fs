@@ -0,0 +1,13 @@
+#version 140
+
+in vec2 uv;
+
+uniform sampler2D image;
+
+out vec4 outColor;
+
+void main()
+{
+	// The rows of the image start at the top
+	outColor = texture(image, vec2(uv.x, 1.0 - uv.y));
+}
\ No newline at end of file
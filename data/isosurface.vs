@@ -1,18 +1,28 @@
 #version 140
 
-in vec3 position;
-in vec3 normal;
+in vec4 position; // quantized, see common/vertexpack.h
+in vec2 normal; // octahedral encoding
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
 
 out vec4 worldNormal;
 out vec4 worldPos;
 
+vec3 octDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if(n.z < 0.0)
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(n);
+}
+
 void main()
 {
-	worldPos = model * vec4(position, 1.0);
+	worldPos = model * vec4(position.xyz * positionScale + positionOffset, 1.0);
 	gl_Position = projection * view * worldPos;
-	worldNormal = normalize(model * vec4(normal, 0.0));
+	worldNormal = normalize(model * vec4(octDecode(normal), 0.0));
 }
\ No newline at end of file
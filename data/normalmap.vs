@@ -1,30 +1,44 @@
 #version 140
 
-in vec3 position;
-in vec3 normal;
+in vec4 position; // quantized, w is the handedness of the texture mapping, see common/vertexpack.h
+in vec2 normal; // octahedral encoding
 in vec2 texel;
-in vec3 tangent;
-in vec3 bitangent;
+in vec2 tangent; // octahedral encoding
 
 uniform vec3 lightPos;
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
 
 out vec2 vertTexel;
 out vec4 tangentLightDir; // interpolate across vertices
 out vec4 worldNormal;
 
+vec3 octDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if(n.z < 0.0)
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(n);
+}
+
 void main()
 {
+	vec3 vertPosition = position.xyz * positionScale + positionOffset;
+	vec3 vertNormal = octDecode(normal);
+	vec3 vertTangent = octDecode(tangent);
+
 	mat4 modelView = view * model;
-	gl_Position = projection * modelView * vec4(position, 1.0);
+	gl_Position = projection * modelView * vec4(vertPosition, 1.0);
 	vertTexel = texel;
 
-	vec4 vertViewNormal = normalize(modelView * vec4(normal, 0.0));
-	vec4 vertViewTangent = normalize(modelView * vec4(tangent, 0.0));
+	vec4 vertViewNormal = normalize(modelView * vec4(vertNormal, 0.0));
+	vec3 bitangent = cross(vertNormal, vertTangent) * position.w;
+	vec4 vertViewTangent = normalize(modelView * vec4(vertTangent, 0.0));
 	vec4 vertViewBitangent = normalize(modelView * vec4(bitangent, 0.0));
-	vec4 viewDirToLight = view * vec4(normalize(lightPos - position), 0.0);
+	vec4 viewDirToLight = view * vec4(normalize(lightPos - vertPosition), 0.0);
 
 	mat4 TBN = transpose(mat4(
 		vertViewTangent,
@@ -33,5 +47,5 @@ void main()
 		vec4(0, 0, 0, 1)));
 	tangentLightDir = TBN * viewDirToLight;
 
-	worldNormal = model * vec4(normal, 0.0);
+	worldNormal = model * vec4(vertNormal, 0.0);
 }
\ No newline at end of file
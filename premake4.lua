@@ -1,5 +1,10 @@
 -- see http://glsdk.sourceforge.net/docs/html/pg_use.html
 
+newoption {
+	trigger = "avx",
+	description = "Use AVX2 and FMA, for CPUs from 2013 on"
+}
+
 solution "glexamples"
 	configurations {"Debug", "Release"}
 	
@@ -26,6 +31,18 @@ solution "glexamples"
 		configuration "windows"
 			defines "WIN32"
 			links {"opengl32"}
+
+		-- AVX2 and FMA only with --avx, the default SSE2 build runs on any x86-64 (common/simd.h)
+		if _OPTIONS["avx"] then
+			configuration "gmake"
+				buildoptions {"-mavx2", "-mfma"}
+
+			configuration "vs*"
+				buildoptions {"/arch:AVX2"}
+		end
+
+		configuration "linux"
+			links {"pthread"} -- std::thread (common/parallel.h)
 			
 		configuration "Debug"
 			targetsuffix "D"